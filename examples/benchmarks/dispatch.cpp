@@ -0,0 +1,81 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+/*
+   per call overhead of the ArrayFire API
+
+   Every call below does almost no work, so the time per call is mostly the
+   cost of reaching the backend. Compare the binary linked against the
+   unified library (dispatch_unified) with the ones linked directly against
+   a backend (dispatch_cpu, dispatch_cuda, dispatch_opencl).
+*/
+
+#include <arrayfire.h>
+#include <stdio.h>
+#include <cstdlib>
+
+using namespace af;
+
+static const int calls = 100000;
+static array A; // populated before each timing
+
+// Metadata queries, a single API call each
+static void query()
+{
+    for (int i = 0; i < calls; ++i) {
+        unsigned ndims = 0;
+        af_get_numdims(&ndims, A.get());
+    }
+}
+
+// Reference counting, two API calls each
+static void retain()
+{
+    for (int i = 0; i < calls; ++i) {
+        af_array tmp = 0;
+        af_retain_array(&tmp, A.get());
+        af_release_array(tmp);
+    }
+}
+
+// Element wise function on a tiny array, built lazily by the JIT
+static void unary()
+{
+    for (int i = 0; i < calls; ++i) {
+        array B = abs(A);
+    }
+}
+
+static void report(const char *name, void (*fn)(), int per_iter)
+{
+    double time = timeit(fn);
+    printf("%-8s %8.1f ns per call\n", name, time * 1e9 / (calls * per_iter));
+    fflush(stdout);
+}
+
+int main(int argc, char ** argv)
+{
+    try {
+        int device = argc > 1 ? atoi(argv[1]) : 0;
+        setDevice(device);
+        info();
+
+        printf("Benchmark per call overhead on a 4 element array\n");
+        A = randu(4);
+
+        report("query",  query,  1);
+        report("retain", retain, 2);
+        report("unary",  unary,  1);
+    } catch (af::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        throw;
+    }
+
+    return 0;
+}
@@ -351,6 +351,9 @@ namespace af
        \param[in] in is the input array.
        \return linear indices where \p in is non-zero
 
+       \note The indices are of type u32, or of type u64 when \p in has more
+       than 2^32 elements. This holds on every backend.
+
        \ingroup scan_func_where
     */
     AFAPI array where(const array &in);
@@ -810,6 +813,9 @@ extern "C" {
        \param[in] in is the input array.
        \return \ref AF_SUCCESS if the execution completes properly
 
+       \note The indices are of type u32, or of type u64 when \p in has more
+       than 2^32 elements. This holds on every backend.
+
        \ingroup scan_func_where
     */
     AFAPI af_err af_where(af_array *idx, const af_array in);
@@ -166,6 +166,58 @@ namespace af
                        const matProp optLhs = AF_MAT_NONE,
                        const matProp optRhs = AF_MAT_NONE);
 
+#if AF_API_VERSION >= 34
+    /**
+        \brief Dot products along a dimension
+
+        Computes the dot product of every pair of columns of \p lhs and \p rhs
+        along \p dim.
+
+        \code
+        // dot products of the columns of two matrices
+        array x = randu(100, 10), y = randu(100, 10);
+        af_print(dotBatched(x, y));   // 1 x 10
+        \endcode
+
+        \param[in] lhs The array object on the left hand side
+        \param[in] rhs The array object on the right hand side, of the same
+                   size as \p lhs
+        \param[in] dim The dimension along which the dot products are taken,
+                   -1 for the first non singleton dimension
+        \param[in] optLhs Options for lhs, \ref AF_MAT_NONE or \ref AF_MAT_CONJ
+        \param[in] optRhs Options for rhs, \ref AF_MAT_NONE or \ref AF_MAT_CONJ
+        \return The dot products, of the size of \p lhs except along \p dim
+                where it is 1
+
+        \ingroup blas_func_dot
+    */
+    AFAPI array dotBatched(const array &lhs, const array &rhs,
+                           const int dim = -1,
+                           const matProp optLhs = AF_MAT_NONE,
+                           const matProp optRhs = AF_MAT_NONE);
+
+    /**
+        \brief y = alpha * x + y, in place
+
+        \param[in,out] y The array updated in place
+        \param[in] alpha The scale of \p x
+        \param[in] x The array added to \p y, of the same size and type
+
+        \ingroup blas_func_blas1
+    */
+    AFAPI void axpyInPlace(array &y, const double alpha, const array &x);
+
+    /**
+        \brief x = alpha * x, in place
+
+        \param[in,out] x The array scaled in place
+        \param[in] alpha The scale
+
+        \ingroup blas_func_blas1
+    */
+    AFAPI void scalInPlace(array &x, const double alpha);
+#endif
+
     /**
         \brief Transposes a matrix
 
@@ -241,6 +293,50 @@ extern "C" {
                             const af_array lhs, const af_array rhs,
                             const af_mat_prop optLhs, const af_mat_prop optRhs);
 
+#if AF_API_VERSION >= 34
+    /**
+        \brief Dot products along a dimension
+
+        \param[out] out The dot products, of the size of \p lhs except along
+                    \p dim where it is 1
+        \param[in] lhs The array object on the left hand side
+        \param[in] rhs The array object on the right hand side, of the same
+                   size as \p lhs
+        \param[in] dim The dimension along which the dot products are taken
+        \param[in] optLhs Options for lhs, \ref AF_MAT_NONE or \ref AF_MAT_CONJ
+        \param[in] optRhs Options for rhs, \ref AF_MAT_NONE or \ref AF_MAT_CONJ
+
+        \return AF_SUCCESS if the process is successful.
+        \ingroup blas_func_dot
+    */
+    AFAPI af_err af_dot_batched(af_array *out,
+                                const af_array lhs, const af_array rhs, const int dim,
+                                const af_mat_prop optLhs, const af_mat_prop optRhs);
+
+    /**
+        \brief y = alpha * x + y, in place
+
+        \param[in,out] y The array updated in place
+        \param[in] alpha The scale of \p x
+        \param[in] x The array added to \p y, of the same size and type
+
+        \return AF_SUCCESS if the process is successful.
+        \ingroup blas_func_blas1
+    */
+    AFAPI af_err af_axpy_inplace(af_array y, const double alpha, const af_array x);
+
+    /**
+        \brief x = alpha * x, in place
+
+        \param[in,out] x The array scaled in place
+        \param[in] alpha The scale
+
+        \return AF_SUCCESS if the process is successful.
+        \ingroup blas_func_blas1
+    */
+    AFAPI af_err af_scal_inplace(af_array x, const double alpha);
+#endif
+
     /**
         \brief Transposes a matrix
 
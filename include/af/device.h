@@ -205,6 +205,28 @@ namespace af
     AFAPI void deviceMemInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                              size_t *lock_bytes, size_t *lock_buffers);
 
+#if AF_API_VERSION >= 34
+    /// \brief Gets allocation statistics from the memory manager
+    ///
+    /// \param[out] alloc_hits the number of allocations served from the
+    //                         memory manager's cache
+    /// \param[out] alloc_misses the number of allocations that required a
+    //                           native allocation
+    /// \param[out] peak_bytes the largest number of bytes held by the memory
+    //                         manager at any time
+    /// \param[out] requested_bytes the number of bytes requested by the
+    //                              buffers currently in use
+    ///
+    /// \note The difference between lock_bytes from \ref deviceMemInfo and
+    ///       \p requested_bytes is the memory lost to rounding buffer sizes.
+    ///       The difference between alloc_bytes and lock_bytes is the memory
+    ///       held in the cache.
+    ///
+    /// \note This function performs a synchronization operation
+    AFAPI void deviceMemStats(size_t *alloc_hits, size_t *alloc_misses,
+                              size_t *peak_bytes, size_t *requested_bytes);
+#endif
+
 #if AF_API_VERSION >= 33
     ///
     /// Prints buffer details from the ArrayFire Device Manager
@@ -344,6 +366,15 @@ extern "C" {
     AFAPI af_err af_device_mem_info(size_t *alloc_bytes, size_t *alloc_buffers,
                                     size_t *lock_bytes, size_t *lock_buffers);
 
+#if AF_API_VERSION >= 34
+    /**
+       Get allocation statistics from the memory manager
+       \ingroup device_func_mem
+    */
+    AFAPI af_err af_device_mem_stats(size_t *alloc_hits, size_t *alloc_misses,
+                                     size_t *peak_bytes, size_t *requested_bytes);
+#endif
+
 #if AF_API_VERSION >= 33
     ///
     /// Prints buffer details from the ArrayFire Device Manager
@@ -297,6 +297,27 @@ AFAPI array skew(const array& in, const float skew0, const float skew1, const di
 */
 AFAPI array bilateral(const array &in, const float spatial_sigma, const float chromatic_sigma, const bool is_color=false);
 
+#if AF_API_VERSION >= 34
+/**
+    C++ Interface for the bilateral grid approximation of the bilateral filter
+
+    The image is sampled every \p spatial_sigma pixels and \p chromatic_sigma
+    intensities into a 3D grid that is blurred and interpolated back. The cost
+    does not depend on the sigmas, which makes it much faster than
+    \ref bilateral for large sigmas. Backends without a grid implementation
+    compute the exact filter.
+
+    \param[in]  in array is the input image
+    \param[in]  spatial_sigma is the spatial variance parameter that decides the filter window
+    \param[in]  chromatic_sigma is the chromatic variance parameter
+    \param[in]  is_color indicates if the input \p in is color image or grayscale
+    \return     the processed image
+
+    \ingroup image_func_bilateral
+*/
+AFAPI array bilateralGrid(const array &in, const float spatial_sigma, const float chromatic_sigma, const bool is_color=false);
+#endif
+
 /**
    C++ Interface for histogram
 
@@ -1049,6 +1070,25 @@ extern "C" {
     */
     AFAPI af_err af_bilateral(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor);
 
+#if AF_API_VERSION >= 34
+    /**
+        C Interface for the bilateral grid approximation of the bilateral filter
+
+        \param[out] out array is the processed image
+        \param[in]  in array is the input image
+        \param[in]  spatial_sigma is the spatial variance parameter that decides the filter window
+        \param[in]  chromatic_sigma is the chromatic variance parameter
+        \param[in]  isColor indicates if the input \p in is color image or grayscale
+        \return     \ref AF_SUCCESS if the filter is applied successfully,
+        otherwise an appropriate error code is returned.
+
+        \note Backends without a grid implementation compute the exact filter.
+
+        \ingroup image_func_bilateral
+    */
+    AFAPI af_err af_bilateral_grid(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor);
+#endif
+
     /**
         C Interface for mean shift
 
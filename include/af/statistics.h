@@ -109,6 +109,24 @@ AFAPI array cov(const array& X, const array& Y, const bool isbiased=false);
 */
 AFAPI array median(const array& in, const dim_t dim=-1);
 
+#if AF_API_VERSION >= 34
+/**
+   C++ Interface for quantiles
+
+   \param[in] in is the input array
+   \param[in] probs is a vector of probabilities in [0, 1]
+   \param[in] dim the dimension along which the quantiles are extracted
+   \return    the quantiles of the input array along dimension \p dim, one
+              for each element of \p probs
+
+   \ingroup stat_func_quantile
+
+   \note \p dim is -1 by default. -1 denotes the first non-singleton dimension.
+   \note Quantiles are linearly interpolated between the two closest ranks.
+*/
+AFAPI array quantile(const array& in, const array& probs, const dim_t dim=-1);
+#endif
+
 /**
    C++ Interface for mean of all elements
 
@@ -297,6 +315,25 @@ AFAPI af_err af_cov(af_array* out, const af_array X, const af_array Y, const boo
 */
 AFAPI af_err af_median(af_array* out, const af_array in, const dim_t dim);
 
+#if AF_API_VERSION >= 34
+/**
+   C Interface for quantiles
+
+   \param[out] out will contain the quantiles of the input array along
+               dimension \p dim, one for each element of \p probs
+   \param[in] in is the input array
+   \param[in] probs is a vector of probabilities in [0, 1]
+   \param[in] dim the dimension along which the quantiles are extracted
+   \return     \ref AF_SUCCESS if the operation is successful,
+   otherwise an appropriate error code is returned.
+
+   \ingroup stat_func_quantile
+
+   \note Quantiles are linearly interpolated between the two closest ranks.
+*/
+AFAPI af_err af_quantile(af_array* out, const af_array in, const af_array probs, const dim_t dim);
+#endif
+
 /**
    C Interface for mean of all elements
 
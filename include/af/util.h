@@ -92,6 +92,45 @@ namespace af
     AFAPI int readArrayCheck(const char *filename, const char *key);
 #endif
 
+#if AF_API_VERSION >= 34
+    /**
+        Reads an array by memory mapping the file
+
+        On the CPU backend the array uses the mapped file directly and no data is
+        copied. Other backends copy the data from the mapped file to the device.
+        Changes to the array are not written to the file.
+
+        \param[in] filename is the path to the location on disk
+        \param[in] index is the 0-based sequential location of the array to be read
+
+        \returns array read from the index location
+
+        \note The file must not be modified or truncated while the array exists.
+        Files written by older versions of ArrayFire are read without mapping.
+
+        \ingroup stream_func_read
+    */
+    AFAPI array readArrayMapped(const char *filename, const unsigned index);
+#endif
+
+#if AF_API_VERSION >= 34
+    /**
+        Reads an array by memory mapping the file
+
+        \copydetails readArrayMapped(const char *, const unsigned)
+
+        \param[in] filename is the path to the location on disk
+        \param[in] key is the tag/name of the array to be read. The key needs to have an exact match.
+
+        \returns array read by key
+
+        \note This function will throw an exception if the key is not found.
+
+        \ingroup stream_func_read
+    */
+    AFAPI array readArrayMapped(const char *filename, const char *key);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         \param[out] output is the pointer to the c-string that will hold the data. The memory for
@@ -235,6 +274,39 @@ extern "C" {
     AFAPI af_err af_read_array_key_check(int *index, const char *filename, const char* key);
 #endif
 
+#if AF_API_VERSION >= 34
+    /**
+        Reads an array by memory mapping the file. On the CPU backend the array
+        uses the mapped file directly and no data is copied.
+
+        \param[out] out is the array read from index
+        \param[in] filename is the path to the location on disk
+        \param[in] index is the 0-based sequential location of the array to be read
+
+        \note The file must not be modified or truncated while the array exists.
+
+        \ingroup stream_func_read
+    */
+    AFAPI af_err af_read_array_index_mapped(af_array *out, const char *filename, const unsigned index);
+#endif
+
+#if AF_API_VERSION >= 34
+    /**
+        Reads an array by memory mapping the file. On the CPU backend the array
+        uses the mapped file directly and no data is copied.
+
+        \param[out] out is the array read from key
+        \param[in] filename is the path to the location on disk
+        \param[in] key is the tag/name of the array to be read. The key needs to have an exact match.
+
+        \note This function will throw an exception if the key is not found.
+        \note The file must not be modified or truncated while the array exists.
+
+        \ingroup stream_func_read
+    */
+    AFAPI af_err af_read_array_key_mapped(af_array *out, const char *filename, const char* key);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         \param[out] output is the pointer to the c-string that will hold the data. The memory for
@@ -0,0 +1,16 @@
+/*******************************************************
+ * Copyright (c) 2014, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#define AF_VERSION "3.4.0"
+#define AF_VERSION_MAJOR 3
+#define AF_VERSION_MINOR 4
+#define AF_VERSION_PATCH 0
+#define AF_API_VERSION_CURRENT   34
@@ -19,13 +19,18 @@ using af::dim4;
 using namespace detail;
 
 template<typename inType, typename outType, bool isColor>
-static inline af_array bilateral(const af_array &in, const float &sp_sig, const float &chr_sig)
+static inline af_array bilateral(const af_array &in, const float &sp_sig, const float &chr_sig,
+                                 const bool grid)
 {
-    return getHandle(bilateral<inType, outType, isColor>(getArray<inType>(in), sp_sig, chr_sig));
+    if (grid)
+        return getHandle(bilateralGrid<inType, outType, isColor>(getArray<inType>(in), sp_sig, chr_sig));
+    else
+        return getHandle(bilateral<inType, outType, isColor>(getArray<inType>(in), sp_sig, chr_sig));
 }
 
 template<bool isColor>
-static af_err bilateral(af_array *out, const af_array &in, const float &s_sigma, const float &c_sigma)
+static af_err bilateral(af_array *out, const af_array &in, const float &s_sigma, const float &c_sigma,
+                        const bool grid)
 {
     try {
         ArrayInfo info = getInfo(in);
@@ -36,14 +41,14 @@ static af_err bilateral(af_array *out, const af_array &in, const float &s_sigma,
 
         af_array output;
         switch(type) {
-            case f64: output = bilateral<double, double, isColor> (in, s_sigma, c_sigma); break;
-            case f32: output = bilateral<float ,  float, isColor> (in, s_sigma, c_sigma); break;
-            case b8 : output = bilateral<char  ,  float, isColor> (in, s_sigma, c_sigma); break;
-            case s32: output = bilateral<int   ,  float, isColor> (in, s_sigma, c_sigma); break;
-            case u32: output = bilateral<uint  ,  float, isColor> (in, s_sigma, c_sigma); break;
-            case u8 : output = bilateral<uchar ,  float, isColor> (in, s_sigma, c_sigma); break;
-            case s16: output = bilateral<short ,  float, isColor> (in, s_sigma, c_sigma); break;
-            case u16: output = bilateral<ushort,  float, isColor> (in, s_sigma, c_sigma); break;
+            case f64: output = bilateral<double, double, isColor> (in, s_sigma, c_sigma, grid); break;
+            case f32: output = bilateral<float ,  float, isColor> (in, s_sigma, c_sigma, grid); break;
+            case b8 : output = bilateral<char  ,  float, isColor> (in, s_sigma, c_sigma, grid); break;
+            case s32: output = bilateral<int   ,  float, isColor> (in, s_sigma, c_sigma, grid); break;
+            case u32: output = bilateral<uint  ,  float, isColor> (in, s_sigma, c_sigma, grid); break;
+            case u8 : output = bilateral<uchar ,  float, isColor> (in, s_sigma, c_sigma, grid); break;
+            case s16: output = bilateral<short ,  float, isColor> (in, s_sigma, c_sigma, grid); break;
+            case u16: output = bilateral<ushort,  float, isColor> (in, s_sigma, c_sigma, grid); break;
             default : TYPE_ERROR(1, type);
         }
         std::swap(*out,output);
@@ -56,7 +61,15 @@ static af_err bilateral(af_array *out, const af_array &in, const float &s_sigma,
 af_err af_bilateral(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor)
 {
     if (isColor)
-        return bilateral<true>(out,in,spatial_sigma,chromatic_sigma);
+        return bilateral<true>(out,in,spatial_sigma,chromatic_sigma,false);
+    else
+        return bilateral<false>(out,in,spatial_sigma,chromatic_sigma,false);
+}
+
+af_err af_bilateral_grid(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor)
+{
+    if (isColor)
+        return bilateral<true>(out,in,spatial_sigma,chromatic_sigma,true);
     else
-        return bilateral<false>(out,in,spatial_sigma,chromatic_sigma);
+        return bilateral<false>(out,in,spatial_sigma,chromatic_sigma,true);
 }
@@ -18,6 +18,7 @@
 #include <sparse_blas.hpp>
 #include <err_common.hpp>
 #include <backend.hpp>
+#include <copy.hpp>
 
 template<typename T>
 static inline af_array sparseMatmul(const af_array lhs, const af_array rhs,
@@ -41,6 +42,40 @@ static inline af_array dot(const af_array lhs, const af_array rhs,
     return getHandle(detail::dot<T>(getArray<T>(lhs), getArray<T>(rhs), optLhs, optRhs));
 }
 
+template<typename T>
+static inline af_array dot(const af_array lhs, const af_array rhs, const int dim,
+                           af_mat_prop optLhs, af_mat_prop optRhs)
+{
+    return getHandle(detail::dot<T>(getArray<T>(lhs), getArray<T>(rhs), dim, optLhs, optRhs));
+}
+
+// Like af_assign, give the handle its own copy of a buffer that is shared
+// with other arrays, views or pending JIT nodes before writing to it
+template<typename T>
+static inline detail::Array<T> &getInPlaceArray(af_array arr)
+{
+    int count = 0;
+    AF_CHECK(af_get_data_ref_count(&count, arr));
+
+    detail::Array<T> &A = getWritableArray<T>(arr);
+    if (count > 1 || !A.isOwner()) {
+        A = detail::copyArray<T>(A);
+    }
+    return A;
+}
+
+template<typename T>
+static inline void axpy(af_array y, const double alpha, const af_array x)
+{
+    detail::axpy<T>(getInPlaceArray<T>(y), getArray<T>(x), alpha);
+}
+
+template<typename T>
+static inline void scal(af_array x, const double alpha)
+{
+    detail::scal<T>(getInPlaceArray<T>(x), alpha);
+}
+
 af_err af_sparse_matmul(af_array *out,
                         const af_array lhs, const af_array rhs,
                         const af_mat_prop optLhs, const af_mat_prop optRhs)
@@ -125,9 +160,12 @@ af_err af_matmul(af_array *out,
         }
 
 
-        if (lhsInfo.ndims() > 2 ||
-            rhsInfo.ndims() > 2) {
-            AF_ERROR("matmul can not be used in batch mode", AF_ERR_BATCH);
+        // Dims 2 and 3 are batches, a size of 1 being broadcast to the other.
+        // Backends that do not support batches reject them in matmul.
+        for (int d = 2; d < 4; d++) {
+            dim_t ld = lhsInfo.dims()[d];
+            dim_t rd = rhsInfo.dims()[d];
+            DIM_ASSERT(1, ld == rd || ld == 1 || rd == 1);
         }
 
         TYPE_ASSERT(lhs_type == rhs_type);
@@ -197,3 +235,101 @@ af_err af_dot(      af_array *out,
     CATCHALL
         return AF_SUCCESS;
 }
+
+af_err af_dot_batched(af_array *out,
+                      const af_array lhs, const af_array rhs, const int dim,
+                      const af_mat_prop optLhs, const af_mat_prop optRhs)
+{
+    using namespace detail;
+
+    try {
+        ArrayInfo lhsInfo = getInfo(lhs);
+        ArrayInfo rhsInfo = getInfo(rhs);
+
+        if (optLhs != AF_MAT_NONE && optLhs != AF_MAT_CONJ) {
+            AF_ERROR("Using this property is not yet supported in dot", AF_ERR_NOT_SUPPORTED);
+        }
+
+        if (optRhs != AF_MAT_NONE && optRhs != AF_MAT_CONJ) {
+            AF_ERROR("Using this property is not yet supported in dot", AF_ERR_NOT_SUPPORTED);
+        }
+
+        ARG_ASSERT(3, dim >= 0 && dim < 4);
+        DIM_ASSERT(1, lhsInfo.dims() == rhsInfo.dims());
+
+        af_dtype lhs_type = lhsInfo.getType();
+        af_dtype rhs_type = rhsInfo.getType();
+        TYPE_ASSERT(lhs_type == rhs_type);
+
+        if(lhsInfo.ndims() == 0) {
+            return af_retain_array(out, lhs);
+        }
+
+        af_array output = 0;
+
+        switch(lhs_type) {
+        case f32: output = dot<float  >(lhs, rhs, dim, optLhs, optRhs);    break;
+        case c32: output = dot<cfloat >(lhs, rhs, dim, optLhs, optRhs);    break;
+        case f64: output = dot<double >(lhs, rhs, dim, optLhs, optRhs);    break;
+        case c64: output = dot<cdouble>(lhs, rhs, dim, optLhs, optRhs);    break;
+        default:  TYPE_ERROR(1, lhs_type);
+        }
+        std::swap(*out, output);
+    }
+    CATCHALL
+        return AF_SUCCESS;
+}
+
+af_err af_axpy_inplace(af_array y, const double alpha, const af_array x)
+{
+    using namespace detail;
+
+    try {
+        ArrayInfo yInfo = getInfo(y);
+        ArrayInfo xInfo = getInfo(x);
+
+        DIM_ASSERT(2, yInfo.dims() == xInfo.dims());
+
+        af_dtype y_type = yInfo.getType();
+        af_dtype x_type = xInfo.getType();
+        TYPE_ASSERT(y_type == x_type);
+
+        if(yInfo.ndims() == 0) {
+            return AF_SUCCESS;
+        }
+
+        switch(y_type) {
+        case f32: axpy<float  >(y, alpha, x);    break;
+        case c32: axpy<cfloat >(y, alpha, x);    break;
+        case f64: axpy<double >(y, alpha, x);    break;
+        case c64: axpy<cdouble>(y, alpha, x);    break;
+        default:  TYPE_ERROR(0, y_type);
+        }
+    }
+    CATCHALL
+        return AF_SUCCESS;
+}
+
+af_err af_scal_inplace(af_array x, const double alpha)
+{
+    using namespace detail;
+
+    try {
+        ArrayInfo xInfo = getInfo(x);
+        af_dtype x_type = xInfo.getType();
+
+        if(xInfo.ndims() == 0) {
+            return AF_SUCCESS;
+        }
+
+        switch(x_type) {
+        case f32: scal<float  >(x, alpha);    break;
+        case c32: scal<cfloat >(x, alpha);    break;
+        case f64: scal<double >(x, alpha);    break;
+        case c64: scal<cdouble>(x, alpha);    break;
+        default:  TYPE_ERROR(0, x_type);
+        }
+    }
+    CATCHALL
+        return AF_SUCCESS;
+}
@@ -164,23 +164,7 @@ bool isFreqDomain(const af_array &signal, const af_array filter, af_conv_domain
 
     if (kbatch >= 10) return true;
 
-    if (baseDim == 1) {
-        if (fdims[0] > 128) return true;
-    }
-
-    if (baseDim == 2) {
-        // maximum supported size in 2D domain
-        if (fdims[0] > 17 || fdims[1] > 17) return true;
-
-        // Maximum supported non square size
-        if (fdims[0] != fdims[1] && fdims[0] > 5) return true;
-    }
-
-    if (baseDim == 3) {
-        if (fdims[0] > 5 || fdims[1] > 5 || fdims[2] > 5) return true;
-    }
-
-    return false;
+    return isFreqDomainPreferred(sdims, fdims, baseDim);
 }
 
 af_err af_convolve1(af_array *out, const af_array signal, const af_array filter, const af_conv_mode mode, af_conv_domain domain)
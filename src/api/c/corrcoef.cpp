@@ -26,26 +26,23 @@ using namespace detail;
 template<typename Ti, typename To>
 static To corrcoef(const af_array& X, const af_array& Y)
 {
-    Array<To> xIn = cast<To>(getArray<Ti>(X));
-    Array<To> yIn = cast<To>(getArray<Ti>(Y));
+    Array<Ti> xIn = getArray<Ti>(X);
+    Array<Ti> yIn = getArray<Ti>(Y);
+    dim4 flat(xIn.elements());
 
-    dim4 dims = xIn.dims();
-    dim_t n= xIn.elements();
+    Array<To> mx  = createEmptyArray<To>(dim4());
+    Array<To> my  = createEmptyArray<To>(dim4());
+    Array<To> cxx = createEmptyArray<To>(dim4());
+    Array<To> cyy = createEmptyArray<To>(dim4());
+    Array<To> cxy = createEmptyArray<To>(dim4());
+    comoments<Ti, To>(mx, my, cxx, cyy, cxy, modDims(xIn, flat), modDims(yIn, flat));
 
-    To xSum = detail::reduce_all<af_add_t, To, To>(xIn);
-    To ySum = detail::reduce_all<af_add_t, To, To>(yIn);
+    To xSq, ySq, xy;
+    copyData(&xSq, cxx);
+    copyData(&ySq, cyy);
+    copyData(&xy, cxy);
 
-    Array<To> xSq = detail::arithOp<To, af_mul_t>(xIn, xIn, dims);
-    Array<To> ySq = detail::arithOp<To, af_mul_t>(yIn, yIn, dims);
-    Array<To> xy  = detail::arithOp<To, af_mul_t>(xIn, yIn, dims);
-
-    To xSqSum = detail::reduce_all<af_add_t, To, To>(xSq);
-    To ySqSum = detail::reduce_all<af_add_t, To, To>(ySq);
-    To xySum  = detail::reduce_all<af_add_t, To, To>(xy);
-
-    To result = (n*xySum - xSum*ySum)/(sqrt(n*xSqSum-xSum*xSum)*sqrt(n*ySqSum-ySum*ySum));
-
-    return result;
+    return xy / (sqrt(xSq) * sqrt(ySq));
 }
 
 af_err af_corrcoef(double *realVal, double *imagVal, const af_array X, const af_array Y)
@@ -29,22 +29,28 @@ static af_array cov(const af_array& X, const af_array& Y, const bool isbiased)
 {
     Array<T> _x = getArray<T>(X);
     Array<T> _y = getArray<T>(Y);
-    Array<cType> xArr = cast<cType>(_x);
-    Array<cType> yArr = cast<cType>(_y);
+    Array<cType> mx  = createEmptyArray<cType>(dim4());
+    Array<cType> my  = createEmptyArray<cType>(dim4());
+    Array<cType> cxx = createEmptyArray<cType>(dim4());
+    Array<cType> cyy = createEmptyArray<cType>(dim4());
+    Array<cType> cxy = createEmptyArray<cType>(dim4());
+    comoments<T, cType>(mx, my, cxx, cyy, cxy, _x, _y);
 
-    dim4 xDims = xArr.dims();
-    dim_t N = isbiased ? xDims[0] : xDims[0]-1;
+    dim4 oDims = cxy.dims();
+    dim_t rows = _x.dims()[0];
+    dim_t N    = isbiased ? rows : rows - 1;
 
-    Array<cType> xmArr = createValueArray<cType>(xDims, mean<T, cType>(_x));
-    Array<cType> ymArr = createValueArray<cType>(xDims, mean<T, cType>(_y));
-    Array<cType> nArr  = createValueArray<cType>(xDims, scalar<cType>(N));
+    /* the products are taken about the means of all of X and Y, so move
+     * the co-moment of each column from its own means to those */
+    cType xm = division(reduce_all<af_add_t, cType, cType>(mx), oDims.elements());
+    cType ym = division(reduce_all<af_add_t, cType, cType>(my), oDims.elements());
 
-    Array<cType> diffX = detail::arithOp<cType, af_sub_t>(xArr, xmArr, xDims);
-    Array<cType> diffY = detail::arithOp<cType, af_sub_t>(yArr, ymArr, xDims);
-    Array<cType> mulXY = detail::arithOp<cType, af_mul_t>(diffX, diffY, xDims);
-    Array<cType> redArr= detail::reduce<af_add_t, cType, cType>(mulXY, 0);
-    xDims[0] = 1;
-    Array<cType> result= detail::arithOp<cType, af_div_t>(redArr, nArr, xDims);
+    Array<cType> dx    = detail::arithOp<cType, af_sub_t>(mx, createValueArray<cType>(oDims, xm), oDims);
+    Array<cType> dy    = detail::arithOp<cType, af_sub_t>(my, createValueArray<cType>(oDims, ym), oDims);
+    Array<cType> dxy   = detail::arithOp<cType, af_mul_t>(dx, dy, oDims);
+    Array<cType> shift = detail::arithOp<cType, af_mul_t>(dxy, createValueArray<cType>(oDims, scalar<cType>(rows)), oDims);
+    Array<cType> sumXY = detail::arithOp<cType, af_add_t>(cxy, shift, oDims);
+    Array<cType> result= detail::arithOp<cType, af_div_t>(sumXY, createValueArray<cType>(oDims, scalar<cType>(N)), oDims);
 
     return getHandle<cType>(result);
 }
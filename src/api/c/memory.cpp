@@ -16,6 +16,7 @@
 #include <Array.hpp>
 #include <handle.hpp>
 #include <memory.hpp>
+#include <copy.hpp>
 #include "err_common.hpp"
 #include <cstring>
 
@@ -88,13 +89,25 @@ af_err af_get_device_ptr(void **data, const af_array arr)
     return AF_SUCCESS;
 }
 
+template <typename T>
+static inline const Array<T> &getLockableArray(const af_array arr)
+{
+    // The buffer of a non owner, such as an array mapped from a file, need
+    // not come from the memory manager. Copy it first, like device() does.
+    Array<T> &A = getWritableArray<T>(arr);
+    if (!A.isOwner()) {
+        A = copyArray<T>(A);
+    }
+    return A;
+}
+
 template <typename T>
 inline void lockArray(const af_array arr)
 {
     // Ideally we need to use .get(false), i.e. get ptr without offset
     // This is however not supported in opencl
     // Use getData().get() as alternative
-    memLock((void *)getArray<T>(arr).getData().get());
+    memLock((void *)getLockableArray<T>(arr).getData().get());
 }
 
 af_err af_lock_device_ptr(const af_array arr)
@@ -170,7 +183,7 @@ inline void unlockArray(const af_array arr)
     // Ideally we need to use .get(false), i.e. get ptr without offset
     // This is however not supported in opencl
     // Use getData().get() as alternative
-    memUnlock((void *)getArray<T>(arr).getData().get());
+    memUnlock((void *)getLockableArray<T>(arr).getData().get());
 }
 
 af_err af_unlock_device_ptr(const af_array arr)
@@ -288,6 +301,15 @@ af_err af_device_mem_info(size_t *alloc_bytes, size_t *alloc_buffers,
     return AF_SUCCESS;
 }
 
+af_err af_device_mem_stats(size_t *alloc_hits, size_t *alloc_misses,
+                           size_t *peak_bytes, size_t *requested_bytes)
+{
+    try {
+        deviceMemoryStats(alloc_hits, alloc_misses, peak_bytes, requested_bytes);
+    } CATCHALL;
+    return AF_SUCCESS;
+}
+
 af_err af_set_mem_step_size(const size_t step_bytes)
 {
     try{
@@ -21,6 +21,7 @@
 #include <lu.hpp>
 #include <reduce.hpp>
 #include <complex.hpp>
+#include <blas.hpp>
 
 using af::dim4;
 using namespace detail;
@@ -88,6 +89,10 @@ double norm(const af_array a, const af_norm_type type, const double p, const dou
 
     typedef typename af::dtype_traits<T>::base_type BT;
 
+    if (type == AF_NORM_EUCLID || (type == AF_NORM_VECTOR_P && p == 2)) {
+        return nrm2<T>(getArray<T>(a));
+    }
+
     const Array<BT> A = abs<BT, T>(getArray<T>(a));
 
     switch (type) {
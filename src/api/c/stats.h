@@ -8,6 +8,8 @@
  ********************************************************/
 
 #pragma once
+#include <copy.hpp>
+#include <meanvar.hpp>
 
 template<typename T, typename Other>
 struct is_same{
@@ -105,3 +107,39 @@ inline Array<T> mean(const Array<T>& in, const Array<T>& wts, dim_t dim)
 
     return result;
 }
+
+/* Variances from the meanvar of the backend, see meanvar.hpp */
+template<typename Ti, typename To>
+inline Array<To> variance(const Array<Ti>& in, const bool isbiased, const int dim)
+{
+    Array<To> meanArr = createEmptyArray<To>(dim4());
+    Array<To> varArr  = createEmptyArray<To>(dim4());
+    meanvar<Ti, To>(meanArr, varArr, in, isbiased, dim);
+    return varArr;
+}
+
+template<typename Ti, typename To, typename Tw>
+inline Array<To> variance(const Array<Ti>& in, const Array<Tw>& wts, const int dim)
+{
+    Array<To> meanArr = createEmptyArray<To>(dim4());
+    Array<To> varArr  = createEmptyArray<To>(dim4());
+    meanvar<Ti, To, Tw>(meanArr, varArr, in, wts, dim);
+    return varArr;
+}
+
+template<typename Ti, typename To>
+inline To variance(const Array<Ti>& in, const bool isbiased)
+{
+    To result;
+    copyData(&result, variance<Ti, To>(modDims(in, dim4(in.elements())), isbiased, 0));
+    return result;
+}
+
+template<typename Ti, typename To, typename Tw>
+inline To variance(const Array<Ti>& in, const Array<Tw>& wts)
+{
+    To result;
+    copyData(&result, variance<Ti, To, Tw>(modDims(in, dim4(in.elements())),
+                                           modDims(wts, dim4(wts.elements())), 0));
+    return result;
+}
@@ -29,40 +29,14 @@ template<typename inType, typename outType>
 static outType stdev(const af_array& in)
 {
     Array<inType> _in       = getArray<inType>(in);
-    Array<outType> input    = cast<outType>(_in);
-    Array<outType> meanCnst = createValueArray<outType>(input.dims(), mean<inType, outType>(_in));
-    Array<outType> diff     = detail::arithOp<outType, af_sub_t>(input, meanCnst, input.dims());
-    Array<outType> diffSq   = detail::arithOp<outType, af_mul_t>(diff, diff, diff.dims());
-    outType result          = division(reduce_all<af_add_t, outType, outType>(diffSq), input.elements());
-
-    return sqrt(result);
+    return sqrt(variance<inType, outType>(_in, true));
 }
 
 template<typename inType, typename outType>
 static af_array stdev(const af_array& in, int dim)
 {
     Array<inType> _in    = getArray<inType>(in);
-    Array<outType> input = cast<outType>(_in);
-    dim4 iDims = input.dims();
-
-    Array<outType> meanArr = mean<inType, outType>(_in, dim);
-
-    /* now tile meanArr along dim and use it for variance computation */
-    dim4 tileDims(1);
-    tileDims[dim] = iDims[dim];
-    Array<outType> tMeanArr = detail::tile<outType>(meanArr, tileDims);
-    /* now mean array is ready */
-
-    Array<outType> diff    = detail::arithOp<outType, af_sub_t>(input, tMeanArr, tMeanArr.dims());
-    Array<outType> diffSq  = detail::arithOp<outType, af_mul_t>(diff, diff, diff.dims());
-    Array<outType> redDiff = reduce<af_add_t, outType, outType>(diffSq, dim);
-    dim4 oDims = redDiff.dims();
-
-    Array<outType> divArr = createValueArray<outType>(oDims, scalar<outType>(iDims[dim]));
-    Array<outType> varArr = detail::arithOp<outType, af_div_t>(redDiff, divArr, redDiff.dims());
-    Array<outType> result = detail::unaryOp<outType, af_sqrt_t>(varArr);
-
-    return getHandle<outType>(result);
+    return getHandle<outType>(detail::unaryOp<outType, af_sqrt_t>(variance<inType, outType>(_in, true, dim)));
 }
 
 af_err af_stdev_all(double *realVal, double *imagVal, const af_array in)
@@ -7,11 +7,24 @@
  * http://arrayfire.com/licenses/BSD-3-Clause
  ********************************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <memory>
+#include <string>
 #include <vector>
 
+#if defined(OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <af/array.h>
 #include <ArrayInfo.hpp>
 #include <handle.hpp>
@@ -23,21 +36,198 @@
 
 using namespace detail;
 
-#define STREAM_FORMAT_VERSION 0x1
+#define STREAM_FORMAT_VERSION 0x2
 static const char sfv_char = STREAM_FORMAT_VERSION;
+static const char sfv_char_v1 = 0x1;
+
+// Array data in version 2 files starts at multiples of this many bytes so
+// that it can be used in place when the file is memory mapped
+static const intl STREAM_ALIGNMENT = 4096;
+
+// Version 2 layout
+//
+// (char     )   Version (Once)
+// (char x 3 )   Padding (Once)
+// (int      )   No. of Arrays (Once)
+// (intl     )   Offset bytes of the index from the start of the file (Once)
+// (intl     )   Alignment of the array data in bytes (Once)
+// (T        )   data (x elements), for every array, each starting at a
+//               multiple of the alignment
+// Index at the index offset, for every array (appends leave the previous
+// index unused in front of the new data):
+    // (int    )   Length of the key
+    // (cstring)   Key
+    // (char   )   Type
+    // (intl   )   dim4 (x 4)
+    // (intl   )   Offset bytes of the data from the start of the file
+typedef struct
+{
+    std::string key;
+    char type;
+    intl dims[4];
+    intl offset;
+} index_entry;
+
+typedef struct
+{
+    int n_arrays;
+    intl index_offset;
+    intl alignment;
+} header_v2;
+
+static header_v2 readHeaderV2(std::istream &fs)
+{
+    char padding[3];
+    header_v2 header = {0, 0, 0};
+    fs.seekg(sizeof(char), std::ios_base::beg);
+    fs.read(padding, 3);
+    fs.read((char*)&header.n_arrays, sizeof(int));
+    fs.read((char*)&header.index_offset, sizeof(intl));
+    fs.read((char*)&header.alignment, sizeof(intl));
+    if(!fs) AF_ERROR("Invalid array file header", AF_ERR_ARG);
+    return header;
+}
+
+static void writeHeaderV2(std::ostream &fs, const header_v2 &header)
+{
+    const char padding[3] = {0, 0, 0};
+    fs.seekp(0);
+    fs.write(&sfv_char, sizeof(char));
+    fs.write(padding, 3);
+    fs.write((char*)&header.n_arrays, sizeof(int));
+    fs.write((char*)&header.index_offset, sizeof(intl));
+    fs.write((char*)&header.alignment, sizeof(intl));
+}
+
+// Smallest index entry, that of an empty key
+static const intl INDEX_ENTRY_MIN_BYTES = sizeof(int) + sizeof(char) + 5 * sizeof(intl);
+
+static std::vector<index_entry> readIndexV2(std::istream &fs, const header_v2 &header)
+{
+    // Nothing read from the file is trusted until it is checked against the
+    // size of the file
+    fs.seekg(0, std::ios_base::end);
+    const intl fsize = fs.tellg();
+
+    if(header.n_arrays < 0 || header.alignment <= 0 ||
+       header.index_offset < 0 || header.index_offset > fsize ||
+       header.n_arrays > (fsize - header.index_offset) / INDEX_ENTRY_MIN_BYTES) {
+        AF_ERROR("Invalid array file header", AF_ERR_ARG);
+    }
+
+    std::vector<index_entry> index(header.n_arrays);
+    fs.seekg(header.index_offset, std::ios_base::beg);
+    for(int i = 0; i < header.n_arrays; i++) {
+        int klen = -1;
+        fs.read((char*)&klen, sizeof(int));
+        if(!fs || klen < 0 || klen > fsize - (intl)fs.tellg()) {
+            AF_ERROR("Invalid array index", AF_ERR_ARG);
+        }
+        index[i].key.resize(klen);
+        if(klen > 0) fs.read(&index[i].key[0], klen);
+        fs.read(&index[i].type, sizeof(char));
+        fs.read((char*)index[i].dims, 4 * sizeof(intl));
+        fs.read((char*)&index[i].offset, sizeof(intl));
+        if(!fs) AF_ERROR("Failed to read array index", AF_ERR_ARG);
+
+        const af_dtype type = (af_dtype)index[i].type;
+        if(type < f32 || type > u16) AF_ERROR("Invalid array type", AF_ERR_ARG);
+
+        // The data has to fit between its offset and the end of the file
+        const intl offset = index[i].offset;
+        if(offset < 0 || offset > fsize) AF_ERROR("Invalid array offset", AF_ERR_ARG);
+        intl bytes = size_of(type);
+        for(int d = 0; d < 4; d++) {
+            const intl n = index[i].dims[d];
+            if(n < 0) AF_ERROR("Invalid array dimensions", AF_ERR_ARG);
+            if(n > 0 && bytes > (fsize - offset) / n) AF_ERROR("File is truncated", AF_ERR_ARG);
+            bytes *= n;
+        }
+    }
+    return index;
+}
+
+static void writeIndexV2(std::ostream &fs, const std::vector<index_entry> &index)
+{
+    for(const index_entry &entry : index) {
+        int klen = entry.key.size();
+        fs.write((char*)&klen, sizeof(int));
+        fs.write(entry.key.c_str(), klen);
+        fs.write(&entry.type, sizeof(char));
+        fs.write((char*)entry.dims, 4 * sizeof(intl));
+        fs.write((char*)&entry.offset, sizeof(intl));
+    }
+}
+
+// Private, read only view of a whole file. Pages are mapped copy on write, so
+// arrays using the mapping can be modified without changing the file.
+class MappedFile
+{
+    char *ptr;
+    size_t bytes;
+#if defined(OS_WIN)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+    MappedFile(MappedFile const&);
+    void operator=(MappedFile const&);
+
+public:
+    MappedFile(const char *filename) : ptr(NULL), bytes(0)
+    {
+#if defined(OS_WIN)
+        file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE) AF_ERROR("File failed to open", AF_ERR_ARG);
+
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        bytes = size.QuadPart;
+
+        mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if(mapping != NULL) ptr = (char *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        if(ptr == NULL) {
+            if(mapping != NULL) CloseHandle(mapping);
+            CloseHandle(file);
+            AF_ERROR("Failed to map file", AF_ERR_ARG);
+        }
+#else
+        int fd = open(filename, O_RDONLY);
+        if(fd < 0) AF_ERROR("File failed to open", AF_ERR_ARG);
+
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            close(fd);
+            AF_ERROR("Failed to read file size", AF_ERR_ARG);
+        }
+        bytes = st.st_size;
+
+        void *addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(addr == MAP_FAILED) AF_ERROR("Failed to map file", AF_ERR_ARG);
+        ptr = (char *)addr;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#if defined(OS_WIN)
+        UnmapViewOfFile(ptr);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(ptr, bytes);
+#endif
+    }
+
+    char *data() { return ptr; }
+    size_t size() const { return bytes; }
+};
 
 template<typename T>
 static int save(const char *key, const af_array arr, const char *filename, const bool append = false)
 {
-    // (char     )   Version (Once)
-    // (int      )   No. of Arrays (Once)
-        // (int    )   Length of the key
-        // (cstring)   Key
-        // (intl   )   Offset bytes to next array (type + dims + data)
-        // (char   )   Type
-        // (intl   )   dim4 (x 4)
-        // (T      )   data (x elements)
-
     // Setup all the data structures that need to be written to file
     ///////////////////////////////////////////////////////////////////////////
     std::string k(key);
@@ -54,12 +244,12 @@ static int save(const char *key, const af_array arr, const char *filename, const
     for(int i = 0; i < 4; i++) {
         odims[i] = info.dims()[i];
     }
-
-    intl offset = sizeof(char) + 4 * sizeof(intl) + info.elements() * sizeof(T);
     ///////////////////////////////////////////////////////////////////////////
 
     std::fstream fs;
-    int n_arrays = 0;
+    char version = sfv_char;
+    header_v2 header = {0, 0, STREAM_ALIGNMENT};
+    std::vector<index_entry> index;
 
     if(append) {
         std::ifstream checkIfExists(filename);
@@ -74,17 +264,18 @@ static int save(const char *key, const af_array arr, const char *filename, const
         // Throw exception if file is not open
         if(!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
 
-        // Assert Version
         if(fs.peek() == std::fstream::traits_type::eof()) {
             // File is empty
             fs.clear();
         } else {
-            char prev_version = 0;
-            fs.read(&prev_version, sizeof(char));
-
-            AF_ASSERT(prev_version == sfv_char, "ArrayFire data format has changed. Can't append to file");
+            fs.read(&version, sizeof(char));
 
-            fs.read((char*)&n_arrays, sizeof(int));
+            if(version == sfv_char) {
+                header = readHeaderV2(fs);
+                index  = readIndexV2(fs, header);
+            } else {
+                AF_ASSERT(version == sfv_char_v1, "ArrayFire data format has changed. Can't append to file");
+            }
         }
     } else {
         fs.open(filename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
@@ -93,24 +284,70 @@ static int save(const char *key, const af_array arr, const char *filename, const
         if(!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
     }
 
-    n_arrays++;
+    // Keep appending to older files in their own format
+    if(version == sfv_char_v1) {
+        // (char     )   Version (Once)
+        // (int      )   No. of Arrays (Once)
+            // (int    )   Length of the key
+            // (cstring)   Key
+            // (intl   )   Offset bytes to next array (type + dims + data)
+            // (char   )   Type
+            // (intl   )   dim4 (x 4)
+            // (T      )   data (x elements)
+        int n_arrays = 0;
+        fs.read((char*)&n_arrays, sizeof(int));
+        n_arrays++;
 
-    // Write version and n_arrays to top of file
-    fs.seekp(0);
-    fs.write(&sfv_char, 1);
-    fs.write((char*)&n_arrays, sizeof(int));
+        intl offset = sizeof(char) + 4 * sizeof(intl) + info.elements() * sizeof(T);
 
-    // Write array to end of file. Irrespective of new or append
+        fs.seekp(sizeof(char));
+        fs.write((char*)&n_arrays, sizeof(int));
+
+        fs.seekp(0, std::ios_base::end);
+        fs.write((char*)&klen, sizeof(int));
+        fs.write(k.c_str(), klen);
+        fs.write((char*)&offset, sizeof(intl));
+        fs.write(&type, sizeof(char));
+        fs.write((char*)&odims, sizeof(intl) * 4);
+        fs.write((char*)&data.front(), sizeof(T) * data.size());
+        fs.close();
+
+        return n_arrays - 1;
+    }
+
+    // The new array and the updated index go after the end of the file, and
+    // the header pointing to them is written last. An interrupted append
+    // leaves the previous header and index intact.
     fs.seekp(0, std::ios_base::end);
-    fs.write((char*)&klen, sizeof(int));
-    fs.write(k.c_str(), klen);
-    fs.write((char*)&offset, sizeof(intl));
-    fs.write(&type, sizeof(char));
-    fs.write((char*)&odims, sizeof(intl) * 4);
+    intl end = header.n_arrays ? (intl)fs.tellp() : 0;
+    intl alignment = header.alignment;
+
+    index_entry entry;
+    entry.key = k;
+    entry.type = type;
+    for(int i = 0; i < 4; i++) entry.dims[i] = odims[i];
+    entry.offset = std::max(((end + alignment - 1) / alignment) * alignment, alignment);
+    index.push_back(entry);
+
+    header.n_arrays = index.size();
+    header.index_offset = entry.offset + data.size() * sizeof(T);
+
+    intl pos = fs.tellp();
+    if(pos < entry.offset) {
+        std::vector<char> zeros(entry.offset - pos, 0);
+        fs.write(&zeros.front(), zeros.size());
+    }
+
+    fs.seekp(entry.offset);
     fs.write((char*)&data.front(), sizeof(T) * data.size());
+    writeIndexV2(fs, index);
+    fs.flush();
+
+    writeHeaderV2(fs, header);
     fs.close();
+    if(!fs) AF_ERROR("Failed to write array file", AF_ERR_ARG);
 
-    return n_arrays - 1;
+    return header.n_arrays - 1;
 }
 
 af_err af_save_array(int *index, const char *key, const af_array arr, const char *filename, const bool append)
@@ -179,7 +416,7 @@ static af_array readArrayV1(const char *filename, const unsigned index)
     fs.read(&version, sizeof(char));
     fs.read((char*)&n_arrays, sizeof(int));
 
-    AF_ASSERT((int)index < n_arrays, "Index out of bounds");
+    AF_ASSERT(n_arrays >= 0 && index < (unsigned)n_arrays, "Index out of bounds");
 
     for(int i = 0; i < (int)index; i++) {
         // (int    )   Length of the key
@@ -245,7 +482,97 @@ static af_array readArrayV1(const char *filename, const unsigned index)
     return out;
 }
 
-static af_array checkVersionAndRead(const char *filename, const unsigned index)
+template<typename T>
+static af_array readDataToArray(std::fstream &fs, const index_entry &entry)
+{
+    dim4 d;
+    for(int i = 0; i < 4; i++) {
+        d[i] = entry.dims[i];
+    }
+
+    std::vector<T> data(d.elements());
+    fs.seekg(entry.offset, std::ios_base::beg);
+    fs.read((char*)&data.front(), data.size() * sizeof(T));
+    if(!fs) AF_ERROR("File is truncated", AF_ERR_ARG);
+
+    return getHandle(createHostDataArray<T>(d, &data.front()));
+}
+
+template<typename T>
+static af_array mapDataToArray(std::shared_ptr<MappedFile> file, const index_entry &entry)
+{
+    dim4 d;
+    for(int i = 0; i < 4; i++) {
+        d[i] = entry.dims[i];
+    }
+
+    if(entry.offset + d.elements() * (intl)sizeof(T) > (intl)file->size()) {
+        AF_ERROR("File is truncated", AF_ERR_ARG);
+    }
+
+    const T *data = (const T *)(file->data() + entry.offset);
+    return getHandle(createHostMappedArray<T>(d, data, file));
+}
+
+static af_array readArrayV2(const char *filename, const unsigned index, const bool mapped)
+{
+    std::fstream fs(filename, std::fstream::in | std::fstream::binary);
+
+    // Throw exception if file is not open
+    if(!fs.is_open()) AF_ERROR("File failed to open", AF_ERR_ARG);
+
+    header_v2 header = readHeaderV2(fs);
+
+    AF_ASSERT(header.n_arrays >= 0 && index < (unsigned)header.n_arrays, "Index out of bounds");
+
+    std::vector<index_entry> entries = readIndexV2(fs, header);
+    const index_entry &entry = entries[index];
+
+    af_dtype type = (af_dtype)entry.type;
+
+    af_array out;
+    if(mapped) {
+        fs.close();
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(filename);
+        switch(type) {
+            case f32 : out = mapDataToArray<float>  (file, entry);  break;
+            case c32 : out = mapDataToArray<cfloat> (file, entry);  break;
+            case f64 : out = mapDataToArray<double> (file, entry);  break;
+            case c64 : out = mapDataToArray<cdouble>(file, entry);  break;
+            case b8  : out = mapDataToArray<char>   (file, entry);  break;
+            case s32 : out = mapDataToArray<int>    (file, entry);  break;
+            case u32 : out = mapDataToArray<uint>   (file, entry);  break;
+            case u8  : out = mapDataToArray<uchar>  (file, entry);  break;
+            case s64 : out = mapDataToArray<intl>   (file, entry);  break;
+            case u64 : out = mapDataToArray<uintl>  (file, entry);  break;
+            case s16 : out = mapDataToArray<short>  (file, entry);  break;
+            case u16 : out = mapDataToArray<ushort> (file, entry);  break;
+            default:    TYPE_ERROR(1, type);
+        }
+        return out;
+    }
+
+    switch(type) {
+        case f32 : out = readDataToArray<float>  (fs, entry);  break;
+        case c32 : out = readDataToArray<cfloat> (fs, entry);  break;
+        case f64 : out = readDataToArray<double> (fs, entry);  break;
+        case c64 : out = readDataToArray<cdouble>(fs, entry);  break;
+        case b8  : out = readDataToArray<char>   (fs, entry);  break;
+        case s32 : out = readDataToArray<int>    (fs, entry);  break;
+        case u32 : out = readDataToArray<uint>   (fs, entry);  break;
+        case u8  : out = readDataToArray<uchar>  (fs, entry);  break;
+        case s64 : out = readDataToArray<intl>   (fs, entry);  break;
+        case u64 : out = readDataToArray<uintl>  (fs, entry);  break;
+        case s16 : out = readDataToArray<short>  (fs, entry);  break;
+        case u16 : out = readDataToArray<ushort> (fs, entry);  break;
+        default:    TYPE_ERROR(1, type);
+    }
+    fs.close();
+
+    return out;
+}
+
+static af_array checkVersionAndRead(const char *filename, const unsigned index, const bool mapped = false)
 {
     char version = 0;
 
@@ -266,7 +593,9 @@ static af_array checkVersionAndRead(const char *filename, const unsigned index)
     fs.close();
 
     switch(version) {
+        // Data in version 1 files is not aligned and is always copied
         case 1: return readArrayV1(filename, index);
+        case 2: return readArrayV2(filename, index, mapped);
         default: AF_ERROR("Invalid version", AF_ERR_ARG);
     }
 }
@@ -315,6 +644,16 @@ int checkVersionAndFindIndex(const char *filename, const char *k)
                 delete [] readKey;
             }
         }
+    } else if(version == 2) {
+        // The index holds all the keys, no array data is read
+        header_v2 header = readHeaderV2(fs);
+        std::vector<index_entry> entries = readIndexV2(fs, header);
+        for(int i = 0; i < header.n_arrays; i++) {
+            if(entries[i].key == key) {
+                index = i;
+                break;
+            }
+        }
     } else {
         AF_ERROR("Invalid version", AF_ERR_ARG);
     }
@@ -357,6 +696,40 @@ af_err af_read_array_key(af_array *out, const char *filename, const char *key)
     return AF_SUCCESS;
 }
 
+af_err af_read_array_index_mapped(af_array *out, const char *filename, const unsigned index)
+{
+    try {
+        AF_CHECK(af_init());
+
+        ARG_ASSERT(1, filename != NULL);
+
+        af_array output = checkVersionAndRead(filename, index, true);
+        std::swap(*out, output);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
+af_err af_read_array_key_mapped(af_array *out, const char *filename, const char *key)
+{
+    try {
+        AF_CHECK(af_init());
+        ARG_ASSERT(1, filename != NULL);
+        ARG_ASSERT(2, key != NULL);
+
+        // Find index of key. Then call read by index
+        int index = checkVersionAndFindIndex(filename, key);
+
+        if(index == -1)
+            AF_ERROR("Key not found", AF_ERR_INVALID_ARRAY);
+
+        af_array output = checkVersionAndRead(filename, index, true);
+        std::swap(*out, output);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
 af_err af_read_array_key_check(int *index, const char *filename, const char* key)
 {
     try {
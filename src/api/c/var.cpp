@@ -27,18 +27,7 @@ template<typename inType, typename outType>
 static outType varAll(const af_array& in, const bool isbiased)
 {
     Array<inType> inArr = getArray<inType>(in);
-    Array<outType> input = cast<outType>(inArr);
-
-    Array<outType> meanCnst= createValueArray<outType>(input.dims(), mean<inType, outType>(inArr));
-
-    Array<outType> diff    = arithOp<outType, af_sub_t>(input, meanCnst, input.dims());
-
-    Array<outType> diffSq  = arithOp<outType, af_mul_t>(diff, diff, diff.dims());
-
-    outType result = division(reduce_all<af_add_t, outType, outType>(diffSq),
-        isbiased ? input.elements() : input.elements() - 1);
-
-    return result;
+    return variance<inType, outType>(inArr, isbiased);
 }
 
 template<typename inType, typename outType>
@@ -46,47 +35,14 @@ static outType varAll(const af_array& in, const af_array weights)
 {
     typedef typename baseOutType<outType>::type bType;
 
-    Array<outType> input = cast<outType>(getArray<inType>(in));
-    Array<outType> wts   = cast<outType>(getArray<bType>(weights));
-
-    bType wtsSum    = reduce_all<af_add_t, bType, bType>(getArray<bType>(weights));
-    outType wtdMean = mean<outType, bType>(input, getArray<bType>(weights));
-
-    Array<outType> meanArr = createValueArray<outType>(input.dims(), wtdMean);
-    Array<outType> diff    = arithOp<outType, af_sub_t>(input, meanArr, input.dims());
-    Array<outType> diffSq  = arithOp<outType, af_mul_t>(diff, diff, diff.dims());
-
-    Array<outType> accDiffSq = arithOp<outType, af_mul_t>(diffSq, wts, diffSq.dims());
-
-    outType result = division(reduce_all<af_add_t, outType, outType>(accDiffSq), wtsSum);
-
-    return result;
+    return variance<inType, outType, bType>(getArray<inType>(in), castArray<bType>(weights));
 }
 
 template<typename inType, typename outType>
 static af_array var(const af_array& in, const bool isbiased, int dim)
 {
     Array<inType> _in    = getArray<inType>(in);
-    Array<outType> input = cast<outType>(_in);
-    dim4 iDims = input.dims();
-
-    Array<outType> meanArr = mean<inType, outType>(_in, dim);
-
-    /* now tile meanArr along dim and use it for variance computation */
-    dim4 tileDims(1);
-    tileDims[dim] = iDims[dim];
-    Array<outType> tMeanArr = tile<outType>(meanArr, tileDims);
-    /* now mean array is ready */
-
-    Array<outType> diff    = arithOp<outType, af_sub_t>(input, tMeanArr, tMeanArr.dims());
-    Array<outType> diffSq  = arithOp<outType, af_mul_t>(diff, diff, diff.dims());
-    Array<outType> redDiff = reduce<af_add_t, outType, outType>(diffSq, dim);
-    dim4 oDims = redDiff.dims();
-
-    Array<outType> divArr = createValueArray<outType>(oDims, scalar<outType>(isbiased ? iDims[dim] : iDims[dim]-1));
-    Array<outType> result = arithOp<outType, af_div_t>(redDiff, divArr, redDiff.dims());
-
-    return getHandle<outType>(result);
+    return getHandle<outType>(variance<inType, outType>(_in, isbiased, dim));
 }
 
 template<typename inType, typename outType>
@@ -94,26 +50,8 @@ static af_array var(const af_array& in, const af_array& weights, int dim)
 {
     typedef typename baseOutType<outType>::type bType;
 
-    Array<outType> input = cast<outType>(getArray<inType>(in));
-    Array<outType> wts   = cast<outType>(getArray<bType>(weights));
-    dim4 iDims = input.dims();
-
-    Array<outType> meanArr = mean<outType>(input, wts, dim);
-
-    /* now tile meanArr along dim and use it for variance computation */
-    dim4 tileDims(1);
-    tileDims[dim] = iDims[dim];
-    Array<outType> tMeanArr = tile<outType>(meanArr, tileDims);
-    /* now mean array is ready */
-
-    Array<outType> diff    = arithOp<outType, af_sub_t>(input, tMeanArr, tMeanArr.dims());
-    Array<outType> diffSq  = arithOp<outType, af_mul_t>(diff, diff, diff.dims());
-    Array<outType> wDiffSq = arithOp<outType, af_mul_t>(diffSq, wts, diffSq.dims());
-    Array<outType> accWDS  = reduce<af_add_t, outType, outType>(wDiffSq, dim);
-    Array<outType> divArr  = reduce<af_add_t, outType, outType>(wts, dim);
-    Array<outType> result  = arithOp<outType, af_div_t>(accWDS, divArr, accWDS.dims());
-
-    return getHandle<outType>(result);
+    return getHandle<outType>(variance<inType, outType, bType>(getArray<inType>(in),
+                                                               castArray<bType>(weights), dim));
 }
 
 af_err af_var(af_array *out, const af_array in, const bool isbiased, const dim_t dim)
@@ -157,6 +95,7 @@ af_err af_var_weighted(af_array *out, const af_array in, const af_array weights,
         af_dtype wType  = wInfo.getType();
 
         ARG_ASSERT(3, (wType==f32 || wType==f64)); /* verify that weights are non-complex real numbers */
+        ARG_ASSERT(2, (wInfo.dims()==iInfo.dims()));
 
         switch(iType) {
             case f64: output = var<double,  double>(in, weights, dim); break;
@@ -221,6 +160,7 @@ af_err af_var_all_weighted(double *realVal, double *imagVal, const af_array in,
         af_dtype wType  = wInfo.getType();
 
         ARG_ASSERT(3, (wType==f32 || wType==f64)); /* verify that weights are non-complex real numbers */
+        ARG_ASSERT(3, (wInfo.dims()==iInfo.dims()));
 
         switch(iType) {
             case f64: *realVal = varAll<double, double>(in, weights); break;
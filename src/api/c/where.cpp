@@ -8,6 +8,7 @@
  ********************************************************/
 
 #include <complex>
+#include <climits>
 #include <af/dim4.hpp>
 #include <af/algorithm.h>
 #include <err_common.hpp>
@@ -22,6 +23,11 @@ using namespace detail;
 template<typename T>
 static inline af_array where(const af_array in)
 {
+    // Indices past 2^32 need the 64 bit output on every backend
+    if (getInfo(in).elements() > UINT_MAX) {
+        return getHandle<uintl>(where64<T>(getArray<T>(in)));
+    }
+
     // Making it more explicit that the output is uint
     return getHandle<uint>(where<T>(getArray<T>(in)));
 }
@@ -10,6 +10,7 @@
 #include <af/array.h>
 #include <af/blas.h>
 #include "error.hpp"
+#include "common.hpp"
 
 namespace af
 {
@@ -76,4 +77,23 @@ namespace af
         AF_THROW(af_dot(&out, lhs.get(), rhs.get(), optLhs, optRhs));
         return array(out);
     }
+
+    array dotBatched(const array &lhs, const array &rhs, const int dim,
+                     const matProp optLhs, const matProp optRhs)
+    {
+        af_array out = 0;
+        AF_THROW(af_dot_batched(&out, lhs.get(), rhs.get(), getFNSD(dim, lhs.dims()),
+                                optLhs, optRhs));
+        return array(out);
+    }
+
+    void axpyInPlace(array &y, const double alpha, const array &x)
+    {
+        AF_THROW(af_axpy_inplace(y.get(), alpha, x.get()));
+    }
+
+    void scalInPlace(array &x, const double alpha)
+    {
+        AF_THROW(af_scal_inplace(x.get(), alpha));
+    }
 }
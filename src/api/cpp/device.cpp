@@ -174,6 +174,13 @@ namespace af
                                     lock_bytes,  lock_buffers));
     }
 
+    void deviceMemStats(size_t *alloc_hits, size_t *alloc_misses,
+                        size_t *peak_bytes, size_t *requested_bytes)
+    {
+        AF_THROW(af_device_mem_stats(alloc_hits, alloc_misses,
+                                     peak_bytes, requested_bytes));
+    }
+
     void setMemStepSize(const size_t step_bytes)
     {
         AF_THROW(af_set_mem_step_size(step_bytes));
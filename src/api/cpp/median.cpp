@@ -43,4 +43,11 @@ array median(const array& in, const dim_t dim)
     return array(temp);
 }
 
+array quantile(const array& in, const array& probs, const dim_t dim)
+{
+    af_array temp = 0;
+    AF_THROW(af_quantile(&temp, in.get(), probs.get(), getFNSD(dim, in.dims())));
+    return array(temp);
+}
+
 }
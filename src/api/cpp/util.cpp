@@ -49,6 +49,20 @@ namespace af
         return array(out);
     }
 
+    array readArrayMapped(const char *filename, const unsigned index)
+    {
+        af_array out = 0;
+        AF_THROW(af_read_array_index_mapped(&out, filename, index));
+        return array(out);
+    }
+
+    array readArrayMapped(const char *filename, const char *key)
+    {
+        af_array out = 0;
+        AF_THROW(af_read_array_key_mapped(&out, filename, key));
+        return array(out);
+    }
+
     int readArrayCheck(const char *filename, const char *key)
     {
         int out = -1;
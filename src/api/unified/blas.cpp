@@ -27,6 +27,26 @@ af_err af_dot(    af_array *out,
     return CALL(out, lhs, rhs, optLhs, optRhs);
 }
 
+af_err af_dot_batched(af_array *out,
+        const af_array lhs, const af_array rhs, const int dim,
+        const af_mat_prop optLhs, const af_mat_prop optRhs)
+{
+    CHECK_ARRAYS(lhs, rhs);
+    return CALL(out, lhs, rhs, dim, optLhs, optRhs);
+}
+
+af_err af_axpy_inplace(af_array y, const double alpha, const af_array x)
+{
+    CHECK_ARRAYS(y, x);
+    return CALL(y, alpha, x);
+}
+
+af_err af_scal_inplace(af_array x, const double alpha)
+{
+    CHECK_ARRAYS(x);
+    return CALL(x, alpha);
+}
+
 af_err af_transpose(af_array *out, af_array in, const bool conjugate)
 {
     CHECK_ARRAYS(in);
@@ -136,6 +136,12 @@ af_err af_device_mem_info(size_t *alloc_bytes, size_t *alloc_buffers,
     return CALL(alloc_bytes, alloc_buffers, lock_bytes, lock_buffers);
 }
 
+af_err af_device_mem_stats(size_t *alloc_hits, size_t *alloc_misses,
+        size_t *peak_bytes, size_t *requested_bytes)
+{
+    return CALL(alloc_hits, alloc_misses, peak_bytes, requested_bytes);
+}
+
 af_err af_print_mem_info(const char *msg, const int device_id)
 {
     return CALL(msg, device_id);
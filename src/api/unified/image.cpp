@@ -146,6 +146,12 @@ af_err af_bilateral(af_array *out, const af_array in, const float spatial_sigma,
     return CALL(out, in, spatial_sigma, chromatic_sigma, isColor);
 }
 
+af_err af_bilateral_grid(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor)
+{
+    CHECK_ARRAYS(in);
+    return CALL(out, in, spatial_sigma, chromatic_sigma, isColor);
+}
+
 af_err af_mean_shift(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const unsigned iter, const bool is_color)
 {
     CHECK_ARRAYS(in);
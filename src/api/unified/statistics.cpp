@@ -53,6 +53,12 @@ af_err af_median(af_array* out, const af_array in, const dim_t dim)
     return CALL(out, in, dim);
 }
 
+af_err af_quantile(af_array* out, const af_array in, const af_array probs, const dim_t dim)
+{
+    CHECK_ARRAYS(in, probs);
+    return CALL(out, in, probs, dim);
+}
+
 af_err af_mean_all(double *real, double *imag, const af_array in)
 {
     CHECK_ARRAYS(in);
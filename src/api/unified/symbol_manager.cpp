@@ -156,7 +156,8 @@ AFSymbolManager& AFSymbolManager::getInstance()
 }
 
 AFSymbolManager::AFSymbolManager()
-    : activeHandle(NULL), defaultHandle(NULL), numBackends(0), backendsAvailable(0)
+    : activeHandle(NULL), defaultHandle(NULL), activeIndex(0), defaultIndex(0),
+      numBackends(0), backendsAvailable(0)
 {
     // In order of priority.
     static const int order[] = {AF_BACKEND_CUDA,        // 1 -> Most Preferred
@@ -169,6 +170,7 @@ AFSymbolManager::AFSymbolManager()
         bkndHandles[backend] = openDynLibrary(backend);
         if (bkndHandles[backend]) {
             activeHandle = bkndHandles[backend];
+            activeIndex = backend;
             activeBackend = (af_backend)order[i];
             numBackends++;
             backendsAvailable += order[i];
@@ -178,6 +180,7 @@ AFSymbolManager::AFSymbolManager()
     // inorder to use it in ::setBackend when
     // the user passes AF_BACKEND_DEFAULT
     defaultHandle = activeHandle;
+    defaultIndex = activeIndex;
     defaultBackend = activeBackend;
 }
 
@@ -205,6 +208,7 @@ af_err AFSymbolManager::setBackend(af::Backend bknd)
     if (bknd==AF_BACKEND_DEFAULT) {
         if (defaultHandle) {
             activeHandle = defaultHandle;
+            activeIndex = defaultIndex;
             activeBackend = defaultBackend;
             return AF_SUCCESS;
         } else {
@@ -214,6 +218,7 @@ af_err AFSymbolManager::setBackend(af::Backend bknd)
     int idx = bknd >> 1;    // Convert 1, 2, 4 -> 0, 1, 2
     if(bkndHandles[idx]) {
         activeHandle = bkndHandles[idx];
+        activeIndex = idx;
         activeBackend = bknd;
         return AF_SUCCESS;
     } else {
@@ -233,7 +238,8 @@ bool checkArray(af_backend activeBackend, af_array a)
     // AF_ERR_ARG instead of AF_ERR_ARR_BKND_MISMATCH
     if(a == 0) return true;
 
-    unified::AFSymbolManager::getInstance().call("af_get_backend_id", &backend, a);
+    static AFSymbolCache cache;
+    unified::AFSymbolManager::getInstance().call("af_get_backend_id", cache, &backend, a);
     return backend == activeBackend;
 }
 
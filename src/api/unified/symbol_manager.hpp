@@ -9,6 +9,7 @@
 #pragma once
 
 #include <af/defines.h>
+#include <atomic>
 #include <string>
 #include <stdlib.h>
 #include <util.hpp>
@@ -35,6 +36,15 @@ const int NUM_ENV_VARS = 2;
                     AF_ERR_LOAD_LIB)
 
 
+/// Addresses of one API function in every backend library, looked up the
+/// first time the function is called on a backend. CALL keeps one per call
+/// site, so a call is a load and an indirect call instead of a symbol lookup.
+/// Objects of static storage duration start with null entries.
+struct AFSymbolCache
+{
+    std::atomic<void*> funcs[NUM_BACKENDS];
+};
+
 class AFSymbolManager {
     public:
         static AFSymbolManager& getInstance();
@@ -50,25 +60,34 @@ class AFSymbolManager {
         af::Backend getActiveBackend() { return activeBackend; }
 
         template<typename... CalleeArgs>
-        af_err call(const char* symbolName, CalleeArgs... args) {
-            if (!activeHandle) {
+        af_err call(const char* symbolName, AFSymbolCache &cache, CalleeArgs... args) {
+            // The backend is read once, so a concurrent setBackend can not
+            // pair the cache entry of one backend with a symbol of another
+            const int idx = activeIndex.load(std::memory_order_relaxed);
+            LibHandle handle = bkndHandles[idx];
+            if (!handle) {
                 UNIFIED_ERROR_LOAD_LIB();
             }
             typedef af_err(*af_func)(CalleeArgs...);
-            af_func funcHandle;
+            std::atomic<void*> &entry = cache.funcs[idx];
+            void *funcHandle = entry.load(std::memory_order_acquire);
+            if (!funcHandle) {
 #if defined(OS_WIN)
-            funcHandle = (af_func)GetProcAddress(activeHandle, symbolName);
+                funcHandle = (void*)GetProcAddress(handle, symbolName);
 #else
-            funcHandle = (af_func)dlsym(activeHandle, symbolName);
+                funcHandle = dlsym(handle, symbolName);
 #endif
-            if (!funcHandle) {
-                std::string str = "Failed to load symbol: ";
-                str += symbolName;
-                AF_RETURN_ERROR(str.c_str(),
-                                AF_ERR_LOAD_SYM);
+                if (!funcHandle) {
+                    std::string str = "Failed to load symbol: ";
+                    str += symbolName;
+                    AF_RETURN_ERROR(str.c_str(),
+                                    AF_ERR_LOAD_SYM);
+                }
+                // Every thread finds the same address, so racing stores are benign
+                entry.store(funcHandle, std::memory_order_release);
             }
 
-            return funcHandle(args...);
+            return ((af_func)funcHandle)(args...);
         }
 
         LibHandle getHandle() { return activeHandle; }
@@ -89,6 +108,8 @@ class AFSymbolManager {
 
         LibHandle activeHandle;
         LibHandle defaultHandle;
+        std::atomic<int> activeIndex;
+        int defaultIndex;
         unsigned numBackends;
         int backendsAvailable;
         af_backend activeBackend;
@@ -116,12 +137,19 @@ bool checkArrays(af_backend activeBackend, T a, Args... arg)
                             AF_ERR_ARR_BKND_MISMATCH);                  \
     } while(0)
 
+// The symbol cache of the call site, a static local of a lambda defined there
+#define SYMBOL_CACHE()                                                  \
+    ([]() -> unified::AFSymbolCache& {                                  \
+        static unified::AFSymbolCache cache;                            \
+        return cache;                                                   \
+    }())
+
 #if defined(OS_WIN)
-#define CALL(...) unified::AFSymbolManager::getInstance().call(__FUNCTION__, __VA_ARGS__)
-#define CALL_NO_PARAMS() unified::AFSymbolManager::getInstance().call(__FUNCTION__)
+#define CALL(...) unified::AFSymbolManager::getInstance().call(__FUNCTION__, SYMBOL_CACHE(), __VA_ARGS__)
+#define CALL_NO_PARAMS() unified::AFSymbolManager::getInstance().call(__FUNCTION__, SYMBOL_CACHE())
 #else
-#define CALL(...) unified::AFSymbolManager::getInstance().call(__func__, __VA_ARGS__)
-#define CALL_NO_PARAMS() unified::AFSymbolManager::getInstance().call(__func__)
+#define CALL(...) unified::AFSymbolManager::getInstance().call(__func__, SYMBOL_CACHE(), __VA_ARGS__)
+#define CALL_NO_PARAMS() unified::AFSymbolManager::getInstance().call(__func__, SYMBOL_CACHE())
 #endif
 
 #if defined(OS_WIN)
@@ -39,6 +39,16 @@ af_err af_read_array_key(af_array *out, const char *filename, const char* key)
     return CALL(out, filename, key);
 }
 
+af_err af_read_array_index_mapped(af_array *out, const char *filename, const unsigned index)
+{
+    return CALL(out, filename, index);
+}
+
+af_err af_read_array_key_mapped(af_array *out, const char *filename, const char* key)
+{
+    return CALL(out, filename, key);
+}
+
 af_err af_read_array_key_check(int *index, const char *filename, const char* key)
 {
     return CALL(index, filename, key);
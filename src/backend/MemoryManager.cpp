@@ -23,7 +23,8 @@ MemoryManager::MemoryManager(int num_devices, unsigned MAX_BUFFERS, bool debug):
     mem_step_size(1024),
     max_buffers(MAX_BUFFERS),
     memory(num_devices),
-    debug_mode(debug)
+    debug_mode(debug),
+    mode(ALLOCATOR_EXACT)
 {
     lock_guard_t lock(this->memory_mutex);
 
@@ -35,6 +36,10 @@ MemoryManager::MemoryManager(int num_devices, unsigned MAX_BUFFERS, bool debug):
         memory[n].total_buffers = 0;
         memory[n].lock_bytes    = 0;
         memory[n].lock_buffers  = 0;
+        memory[n].alloc_hits    = 0;
+        memory[n].alloc_misses  = 0;
+        memory[n].peak_bytes    = 0;
+        memory[n].requested_bytes = 0;
     }
 
     // Check for environment variables
@@ -53,6 +58,53 @@ MemoryManager::MemoryManager(int num_devices, unsigned MAX_BUFFERS, bool debug):
     if (!env_var.empty()) {
         this->max_buffers = std::max(1, std::stoi(env_var));
     }
+
+    // Allocator mode
+    env_var = getEnvVar("AF_MEM_ALLOCATOR");
+    if (env_var == "sizeclass") {
+        this->mode = ALLOCATOR_SIZECLASS;
+    }
+}
+
+size_t MemoryManager::getAllocSize(const size_t bytes)
+{
+    if (this->debug_mode) return bytes;
+
+    size_t step = mem_step_size;
+    if (this->mode == ALLOCATOR_EXACT || bytes <= step) {
+        return divup(bytes, step) * step;
+    }
+
+    // Four size classes per power of two bounds the internal
+    // fragmentation of a buffer to 25%
+    size_t base = 1;
+    while (base * 2 < bytes) base *= 2;
+    size_t quarter = std::max(base / 4, step);
+    return divup(bytes, quarter) * quarter;
+}
+
+void *MemoryManager::findFreeBuffer(memory_info& current, size_t &alloc_bytes)
+{
+    free_iter iter;
+    if (this->mode == ALLOCATOR_EXACT) {
+        iter = current.free_map.find(alloc_bytes);
+    } else {
+        // Large requests may reuse a cached buffer up to twice their size
+        // instead of going back to the native allocator
+        size_t limit = alloc_bytes >= LARGE_BUFFER_BYTES ? 2 * alloc_bytes : alloc_bytes;
+        iter = current.free_map.lower_bound(alloc_bytes);
+        while (iter != current.free_map.end() && iter->second.empty()) iter++;
+        if (iter != current.free_map.end() && iter->first > limit) {
+            iter = current.free_map.end();
+        }
+    }
+
+    if (iter == current.free_map.end() || iter->second.empty()) return NULL;
+
+    void *ptr = iter->second.back();
+    iter->second.pop_back();
+    alloc_bytes = iter->first;
+    return ptr;
 }
 
 void MemoryManager::setMaxMemorySize()
@@ -119,6 +171,7 @@ void MemoryManager::unlock(void *ptr, bool user_unlock)
     size_t bytes = iter->second.bytes;
     current.lock_bytes -= iter->second.bytes;
     current.lock_buffers--;
+    current.requested_bytes -= iter->second.requested;
 
     current.locked_map.erase(iter);
 
@@ -149,7 +202,7 @@ void *MemoryManager::alloc(const size_t bytes, bool user_lock)
     lock_guard_t lock(this->memory_mutex);
 
     void *ptr = NULL;
-    size_t alloc_bytes = this->debug_mode ? bytes : (divup(bytes, mem_step_size) * mem_step_size);
+    size_t alloc_bytes = this->getAllocSize(bytes);
 
     if (bytes > 0) {
         memory_info& current = this->getCurrentMemoryInfo();
@@ -163,13 +216,7 @@ void *MemoryManager::alloc(const size_t bytes, bool user_lock)
                 this->garbageCollect();
             }
 
-            free_iter iter = current.free_map.find(alloc_bytes);
-
-            if (iter != current.free_map.end() && !iter->second.empty()) {
-                ptr = iter->second.back();
-                iter->second.pop_back();
-            }
-
+            ptr = this->findFreeBuffer(current, alloc_bytes);
         }
 
         // Only comes here if buffer size not found or in debug mode
@@ -186,13 +233,17 @@ void *MemoryManager::alloc(const size_t bytes, bool user_lock)
             // Increment these two only when it succeeds to come here.
             current.total_bytes += alloc_bytes;
             current.total_buffers += 1;
+            current.alloc_misses++;
+            current.peak_bytes = std::max(current.peak_bytes, current.total_bytes);
+        } else {
+            current.alloc_hits++;
         }
 
-
-        locked_info info = {!user_lock, user_lock, alloc_bytes};
+        locked_info info = {!user_lock, user_lock, alloc_bytes, bytes};
         current.locked_map[ptr] = info;
         current.lock_bytes += alloc_bytes;
         current.lock_buffers++;
+        current.requested_bytes += bytes;
     }
     return ptr;
 }
@@ -210,7 +261,8 @@ void MemoryManager::userLock(const void *ptr)
     } else {
         locked_info info = {false,
                             true,
-                            100}; //This number is not relevant
+                            100, //This number is not relevant
+                            0};
 
         current.locked_map[(void *)ptr] = info;
     }
@@ -317,6 +369,22 @@ void MemoryManager::bufferInfo(size_t *alloc_bytes, size_t *alloc_buffers,
     if (lock_buffers  ) *lock_buffers  = current.lock_buffers;
 }
 
+void MemoryManager::bufferStats(size_t *alloc_hits, size_t *alloc_misses,
+                                size_t *peak_bytes, size_t *requested_bytes)
+{
+    lock_guard_t lock(this->memory_mutex);
+    const memory_info& current = this->getCurrentMemoryInfo();
+    if (alloc_hits     ) *alloc_hits      = current.alloc_hits;
+    if (alloc_misses   ) *alloc_misses    = current.alloc_misses;
+    if (peak_bytes     ) *peak_bytes      = current.peak_bytes;
+    if (requested_bytes) *requested_bytes = current.requested_bytes;
+}
+
+allocator_mode MemoryManager::getAllocatorMode()
+{
+    return this->mode;
+}
+
 unsigned MemoryManager::getMaxBuffers()
 {
     return this->max_buffers;
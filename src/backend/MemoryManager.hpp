@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <mutex>
+#include <map>
 #include <unordered_map>
 
 namespace common
@@ -22,6 +23,16 @@ typedef std::lock_guard<mutex_t> lock_guard_t;
 const unsigned MAX_BUFFERS   = 1000;
 const size_t ONE_GB = 1 << 30;
 
+// Buffers at least this large may be served from a cached buffer up to
+// twice the requested size when the size class allocator is active
+const size_t LARGE_BUFFER_BYTES = 1 << 20;
+
+typedef enum
+{
+    ALLOCATOR_EXACT,    // Cache buffers by their step-rounded size (default)
+    ALLOCATOR_SIZECLASS // Cache buffers in geometric size classes
+} allocator_mode;
+
 class MemoryManager
 {
     typedef struct
@@ -29,12 +40,14 @@ class MemoryManager
         bool manager_lock;
         bool user_lock;
         size_t bytes;
+        size_t requested;
     } locked_info;
 
     typedef std::unordered_map<void *, locked_info> locked_t;
     typedef locked_t::iterator locked_iter;
 
-    typedef std::unordered_map<size_t, std::vector<void *> >free_t;
+    // Ordered so that larger cached buffers can be found with lower_bound
+    typedef std::map<size_t, std::vector<void *> >free_t;
     typedef free_t::iterator free_iter;
 
     typedef struct
@@ -47,12 +60,23 @@ class MemoryManager
         size_t total_bytes;
         size_t total_buffers;
         size_t max_bytes;
+
+        // Statistics
+        size_t alloc_hits;
+        size_t alloc_misses;
+        size_t peak_bytes;
+        size_t requested_bytes;
     } memory_info;
 
     size_t mem_step_size;
     unsigned max_buffers;
     std::vector<memory_info> memory;
     bool debug_mode;
+    allocator_mode mode;
+
+    size_t getAllocSize(const size_t bytes);
+
+    void *findFreeBuffer(memory_info& current, size_t &alloc_bytes);
 
     memory_info& getCurrentMemoryInfo()
     {
@@ -85,6 +109,9 @@ public:
     void bufferInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                     size_t *lock_bytes,  size_t *lock_buffers);
 
+    void bufferStats(size_t *alloc_hits, size_t *alloc_misses,
+                     size_t *peak_bytes, size_t *requested_bytes);
+
     void userLock(const void *ptr);
 
     void userUnlock(const void *ptr);
@@ -99,6 +126,8 @@ public:
 
     void setMemStepSize(size_t new_step_size);
 
+    allocator_mode getAllocatorMode();
+
     virtual void *nativeAlloc(const size_t bytes)
     {
         return malloc(bytes);
@@ -51,6 +51,16 @@ Array<T>::Array(dim4 dims, const T * const in_data, bool is_device, bool copy_de
     }
 }
 
+// The data belongs to mapping, so the Array does not own it. Functions
+// that write to the buffer of a non owner make a copy first.
+template<typename T>
+Array<T>::Array(af::dim4 dims, const T * const in_data, std::shared_ptr<void> mapping):
+    info(getActiveDeviceId(), dims, 0, calcStrides(dims), (af_dtype)dtype_traits<T>::af_type),
+    data(mapping, const_cast<T *>(in_data)), data_dims(dims),
+    node(), ready(true), owner(false)
+{
+}
+
 template<typename T>
 Array<T>::Array(af::dim4 dims, TNJ::Node_ptr n) :
     info(getActiveDeviceId(), dims, 0, calcStrides(dims), (af_dtype)dtype_traits<T>::af_type),
@@ -118,10 +128,32 @@ T* Array<T>::device()
 template<typename T>
 void evalMultiple(std::vector<Array<T>*> arrays)
 {
-    //FIXME: implement this correctly
-    //Using fallback for now
+    if (getQueue().is_worker()) AF_ERROR("Array not evaluated", AF_ERR_INTERNAL);
+
+    std::vector<Array<T>> outputs;
+
     for (auto array : arrays) {
-        array->eval();
+        if (array->isReady()) continue;
+
+        // Trees of different sizes can not share a single pass
+        if (!outputs.empty() && array->dims() != outputs[0].dims()) {
+            array->eval();
+            continue;
+        }
+
+        array->setId(getActiveDeviceId());
+        array->data = std::shared_ptr<T>(memAlloc<T>(array->elements()), memFree<T>);
+        outputs.push_back(*array);
+    }
+
+    if (outputs.empty()) return;
+
+    getQueue().enqueue(kernel::evalMultiple<T>, outputs);
+
+    for (auto array : arrays) {
+        if (array->isReady()) continue;
+        array->node.reset();
+        array->ready = true;
     }
     return;
 }
@@ -160,6 +192,14 @@ createDeviceDataArray(const dim4 &size, const void *data)
     return Array<T>(size, (const T * const) data, true);
 }
 
+template<typename T>
+Array<T>
+createHostMappedArray(const dim4 &size, const T * const data,
+                      std::shared_ptr<void> mapping)
+{
+    return Array<T>(size, data, mapping);
+}
+
 template<typename T>
 Array<T>
 createValueArray(const dim4 &size, const T& value)
@@ -284,6 +324,8 @@ writeDeviceDataArray(Array<T> &arr, const void * const data, const size_t bytes)
 #define INSTANTIATE(T)                                                  \
     template       Array<T>  createHostDataArray<T>   (const dim4 &size, const T * const data); \
     template       Array<T>  createDeviceDataArray<T> (const dim4 &size, const void *data); \
+    template       Array<T>  createHostMappedArray<T> (const dim4 &size, const T * const data, \
+                                                       std::shared_ptr<void> mapping); \
     template       Array<T>  createValueArray<T>      (const dim4 &size, const T &value); \
     template       Array<T>  createEmptyArray<T>      (const dim4 &size); \
     template       Array<T>  *initArray<T      >      ();               \
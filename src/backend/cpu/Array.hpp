@@ -30,6 +30,7 @@ template<typename T> class Array;
 namespace kernel
 {
 template<typename T> void evalArray(cpu::Array<T> in);
+template<typename T> void evalMultiple(std::vector<cpu::Array<T>> arrays);
 }
 }
 
@@ -59,6 +60,12 @@ namespace cpu
     template<typename T>
     Array<T> createDeviceDataArray(const af::dim4 &size, const void *data);
 
+    // Creates an Array from host memory that is kept alive by mapping.
+    // The CPU backend uses the memory directly, other backends copy it.
+    template<typename T>
+    Array<T> createHostMappedArray(const af::dim4 &size, const T * const data,
+                                   std::shared_ptr<void> mapping);
+
     // Copies data to an existing Array object from a host pointer
     template<typename T>
     void writeHostDataArray(Array<T> &arr, const T * const data, const size_t bytes);
@@ -119,6 +126,7 @@ namespace cpu
         explicit Array(dim4 dims, const T * const in_data, bool is_device, bool copy_device=false);
         Array(const Array<T>& parnt, const dim4 &dims, const dim_t &offset, const dim4 &stride);
         explicit Array(af::dim4 dims, TNJ::Node_ptr n);
+        explicit Array(af::dim4 dims, const T * const in_data, std::shared_ptr<void> mapping);
 
     public:
 
@@ -219,6 +227,8 @@ namespace cpu
         friend Array<T> createValueArray<T>(const af::dim4 &size, const T& value);
         friend Array<T> createHostDataArray<T>(const af::dim4 &size, const T * const data);
         friend Array<T> createDeviceDataArray<T>(const af::dim4 &size, const void *data);
+        friend Array<T> createHostMappedArray<T>(const af::dim4 &size, const T * const data,
+                                                 std::shared_ptr<void> mapping);
 
         friend Array<T> *initArray<T>();
         friend Array<T> createEmptyArray<T>(const af::dim4 &size);
@@ -229,6 +239,7 @@ namespace cpu
                                           bool copy);
 
         friend void kernel::evalArray<T>(Array<T> in);
+        friend void kernel::evalMultiple<T>(std::vector<Array<T>> arrays);
 
         friend void destroyArray<T>(Array<T> *arr);
         friend void *getDevicePtr<T>(const Array<T>& arr);
@@ -36,34 +36,47 @@ namespace TNJ
         Node_ptr m_lhs;
         Node_ptr m_rhs;
         BinOp<To, Ti, op> m_op;
-        To m_val;
+
+        void eval(void **vals, int lim)
+        {
+            To *out = (To *)vals[m_id];
+            const Ti *lhs = (const Ti *)vals[m_lhs->getId()];
+            const Ti *rhs = (const Ti *)vals[m_rhs->getId()];
+            for (int i = 0; i < lim; i++) {
+                out[i] = m_op.eval(lhs[i], rhs[i]);
+            }
+        }
 
     public:
         BinaryNode(Node_ptr lhs, Node_ptr rhs) :
             Node(),
             m_lhs(lhs),
-            m_rhs(rhs),
-            m_val(0)
+            m_rhs(rhs)
         {
             m_height = std::max(m_lhs->getHeight(), m_rhs->getHeight()) + 1;
         }
 
-        void *calc(int x, int y, int z, int w)
+        unsigned getTypeSize() { return sizeof(To); }
+
+        void calc(void **vals, int x, int y, int z, int w, int lim)
         {
-            if (calcCurrent(x, y, z, w)) {
-                m_val = m_op.eval(*(Ti *)m_lhs->calc(x, y, z, w),
-                                  *(Ti *)m_rhs->calc(x, y, z, w));
-            }
-            return  (void *)&m_val;
+            eval(vals, lim);
         }
 
-        void *calc(int idx)
+        void calc(void **vals, dim_t idx, int lim)
         {
-            if (calcCurrent(idx)) {
-                m_val = m_op.eval(*(Ti *)m_lhs->calc(idx),
-                                  *(Ti *)m_rhs->calc(idx));
-            }
-            return (void *)&m_val;
+            eval(vals, lim);
+        }
+
+        void getNodes(std::vector<Node *> &nodes)
+        {
+            if (m_is_eval) return;
+
+            m_lhs->getNodes(nodes);
+            m_rhs->getNodes(nodes);
+            addNode(nodes);
+
+            m_is_eval = true;
         }
 
         void getInfo(unsigned &len, unsigned &buf_count, unsigned &bytes)
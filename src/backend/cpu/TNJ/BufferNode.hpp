@@ -30,7 +30,6 @@ namespace TNJ
         dim_t m_off;
         dim_t m_strides[4];
         dim_t m_dims[4];
-        T m_val;
     public:
 
         BufferNode(shared_ptr<T> data,
@@ -43,8 +42,7 @@ namespace TNJ
             ptr(data),
             m_bytes(bytes),
             m_linear_buffer(is_linear),
-            m_off(data_off),
-            m_val(0)
+            m_off(data_off)
         {
             for (int i = 0; i < 4; i++) {
                 m_strides[i] = strs[i];
@@ -53,25 +51,31 @@ namespace TNJ
             m_height = 0;
         }
 
-        void *calc(int x, int y, int z, int w)
+        unsigned getTypeSize() { return sizeof(T); }
+
+        void calc(void **vals, int x, int y, int z, int w, int lim)
         {
-            if (calcCurrent(x, y, z, w)) {
-                dim_t l_off = 0;
-                l_off += (w < (int)m_dims[3]) * w * m_strides[3];
-                l_off += (z < (int)m_dims[2]) * z * m_strides[2];
-                l_off += (y < (int)m_dims[1]) * y * m_strides[1];
-                l_off += (x < (int)m_dims[0]) * x;
-                m_val = *(ptr.get() + m_off + l_off);
+            dim_t l_off = 0;
+            l_off += (w < (int)m_dims[3]) * w * m_strides[3];
+            l_off += (z < (int)m_dims[2]) * z * m_strides[2];
+            l_off += (y < (int)m_dims[1]) * y * m_strides[1];
+            T *in = ptr.get() + m_off + l_off;
+
+            if (m_strides[0] == 1 && x + lim <= (int)m_dims[0]) {
+                // Contiguous block, read directly from the buffer
+                vals[m_id] = (void *)(in + x);
+            } else {
+                T *out = (T *)vals[m_id];
+                for (int i = 0; i < lim; i++) {
+                    int xc = x + i;
+                    out[i] = in[(xc < (int)m_dims[0]) * xc * m_strides[0]];
+                }
             }
-            return (void *)&m_val;
         }
 
-        void *calc(int idx)
+        void calc(void **vals, dim_t idx, int lim)
         {
-            if (calcCurrent(idx)) {
-                m_val = *(ptr.get() + idx + m_off);
-            }
-            return (void *)&m_val;
+            vals[m_id] = (void *)(ptr.get() + m_off + idx);
         }
 
         void getInfo(unsigned &len, unsigned &buf_count, unsigned &bytes)
@@ -18,54 +18,40 @@ namespace cpu
 namespace TNJ
 {
 
+    // Number of elements evaluated by each node in a single block
+    const int VECTOR_LENGTH = 1024;
+
     class Node
     {
 
     protected:
 
         int m_height;
-        int x, y, z, w;
+        int m_id;
         bool m_is_eval;
         bool m_linear;
         bool m_set_is_linear;
 
-
         void resetCommonFlags()
         {
             m_height = 0;
-            x = -1;
-            y = -1;
-            z = -1;
-            w = -1;
+            m_id = -1;
             m_is_eval = false;
             m_linear = false;
             m_set_is_linear = false;
         }
 
-        bool calcCurrent(int xc)
-        {
-            bool res = (x == xc);
-            x = xc;
-            return !res;
-        }
-
-        bool calcCurrent(int xc, int yc, int zc, int wc)
+        // Appends the current node to the evaluation order and assigns its id
+        void addNode(std::vector<Node *> &nodes)
         {
-            bool res = (xc == x) && (yc == y) && (zc == z) && (wc == w);
-            x = xc;
-            y = yc;
-            z = zc;
-            w = wc;
-            return !res;
+            m_id = (int)nodes.size();
+            nodes.push_back(this);
         }
 
     public:
         Node() :
             m_height(0),
-            x(-1),
-            y(-1),
-            z(-1),
-            w(-1),
+            m_id(-1),
             m_is_eval(false),
             m_linear(false),
             m_set_is_linear(false)
@@ -73,16 +59,27 @@ namespace TNJ
 
         int getHeight() { return m_height; }
 
-        virtual void *calc(int x, int y, int z, int w)
-        {
-            m_is_eval = true;
-            return NULL;
-        }
+        int getId() { return m_id; }
+
+        // Size in bytes of a single output element
+        virtual unsigned getTypeSize() { return 0; }
+
+        // Evaluates lim consecutive elements starting at linear index idx.
+        // On entry, vals[getId()] points to scratch space for VECTOR_LENGTH
+        // elements. On exit, it points to the computed values. The values of
+        // the children are available at vals[child->getId()].
+        virtual void calc(void **vals, dim_t idx, int lim) {}
+
+        // Evaluates lim elements along the first dimension starting at (x, y, z, w)
+        virtual void calc(void **vals, int x, int y, int z, int w, int lim) {}
 
-        virtual void *calc(int idx)
+        // Collects the nodes of the tree in evaluation order (children first).
+        // Shared nodes are added only once.
+        virtual void getNodes(std::vector<Node *> &nodes)
         {
+            if (m_is_eval) return;
+            addNode(nodes);
             m_is_eval = true;
-            return NULL;
         }
 
         virtual void getInfo(unsigned &len, unsigned &buf_count, unsigned &bytes)
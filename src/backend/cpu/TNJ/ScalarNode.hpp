@@ -10,6 +10,7 @@
 #pragma once
 #include <optypes.hpp>
 #include <vector>
+#include <algorithm>
 #include "Node.hpp"
 
 namespace cpu
@@ -31,14 +32,16 @@ namespace TNJ
             m_height = 0;
         }
 
-        void *calc(int x, int y, int z, int w)
+        unsigned getTypeSize() { return sizeof(T); }
+
+        void calc(void **vals, int x, int y, int z, int w, int lim)
         {
-            return (void *)(&m_val);
+            std::fill((T *)vals[m_id], (T *)vals[m_id] + lim, m_val);
         }
 
-        void *calc(int idx)
+        void calc(void **vals, dim_t idx, int lim)
         {
-            return (void *)&m_val;
+            std::fill((T *)vals[m_id], (T *)vals[m_id] + lim, m_val);
         }
 
         void getInfo(unsigned &len, unsigned &buf_count, unsigned &bytes)
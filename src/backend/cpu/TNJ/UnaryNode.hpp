@@ -35,31 +35,44 @@ namespace TNJ
     protected:
         Node_ptr m_child;
         UnOp <To, Ti, op> m_op;
-        To m_val;
+
+        void eval(void **vals, int lim)
+        {
+            To *out = (To *)vals[m_id];
+            const Ti *in = (const Ti *)vals[m_child->getId()];
+            for (int i = 0; i < lim; i++) {
+                out[i] = m_op.eval(in[i]);
+            }
+        }
 
     public:
         UnaryNode(Node_ptr in) :
             Node(),
-            m_child(in),
-            m_val(0)
+            m_child(in)
         {
             m_height = m_child->getHeight() + 1;
         }
 
-        void *calc(int x, int y, int z, int w)
+        unsigned getTypeSize() { return sizeof(To); }
+
+        void calc(void **vals, int x, int y, int z, int w, int lim)
         {
-            if (calcCurrent(x, y, z, w)) {
-                m_val = m_op.eval(*(Ti *)m_child->calc(x, y, z, w));
-            }
-            return (void *)(&m_val);
+            eval(vals, lim);
         }
 
-        void *calc(int idx)
+        void calc(void **vals, dim_t idx, int lim)
         {
-            if (calcCurrent(idx)) {
-                m_val = m_op.eval(*(Ti *)m_child->calc(idx));
-            }
-            return (void *)&m_val;
+            eval(vals, lim);
+        }
+
+        void getNodes(std::vector<Node *> &nodes)
+        {
+            if (m_is_eval) return;
+
+            m_child->getNodes(nodes);
+            addNode(nodes);
+
+            m_is_eval = true;
         }
 
         void getInfo(unsigned &len, unsigned &buf_count, unsigned &bytes)
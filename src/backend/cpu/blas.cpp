@@ -11,9 +11,18 @@
 #include <af/dim4.hpp>
 #include <cassert>
 #include <err_common.hpp>
+#include <kernel/blas1.hpp>
 #include <kernel/dot.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
+#include <util.hpp>
+#include <algorithm>
+#include <vector>
+
+#ifdef USE_MKL
+#include <mkl_service.h>
+#endif
 
 namespace cpu
 {
@@ -117,6 +126,22 @@ BLAS_FUNC(gemv , double  , d)
 BLAS_FUNC(gemv , cfloat  , c)
 BLAS_FUNC(gemv , cdouble , z)
 
+#ifdef USE_MKL
+template<typename T>
+using gemm_batch_func_def = void (*)( const CBLAS_ORDER, const CBLAS_TRANSPOSE *, const CBLAS_TRANSPOSE *,
+                                      const MKL_INT *, const MKL_INT *, const MKL_INT *,
+                                      cptr_type<T>, cptr_type<T> *, const MKL_INT *,
+                                      cptr_type<T> *, const MKL_INT *,
+                                      cptr_type<T>, ptr_type<T> *, const MKL_INT *,
+                                      const MKL_INT, const MKL_INT *);
+
+BLAS_FUNC_DEF(gemm_batch)
+BLAS_FUNC(gemm_batch , float   , s)
+BLAS_FUNC(gemm_batch , double  , d)
+BLAS_FUNC(gemm_batch , cfloat  , c)
+BLAS_FUNC(gemm_batch , cdouble , z)
+#endif
+
 template<typename T, int value>
 typename enable_if<is_floating_point<T>::value, scale_type<T>>::type
 getScale() { return T(value); }
@@ -142,6 +167,49 @@ toCblasTranspose(af_mat_prop opt)
     return out;
 }
 
+// Batches whose product has at most this many multiply-adds are run in
+// parallel, one per thread. Larger ones are run in order and left to the
+// threads of the BLAS library.
+static const dim_t MATMUL_BATCH_PARALLEL_MAX = 1 << 21;
+
+// Batches run in parallel limit the BLAS library to a single thread, so
+// that its threads do not multiply with those of the pool. Accelerate can
+// not be limited, so its batches are always run in order.
+#ifdef __APPLE__
+static const bool MATMUL_BATCH_PARALLEL = false;
+#else
+static const bool MATMUL_BATCH_PARALLEL = true;
+#endif
+
+// OpenBLAS has a single thread count for the process. It is set by the
+// thread that starts the parallel batches and restored once they are done.
+struct blas_run_single_thread
+{
+#ifdef IS_OPENBLAS
+    int prev;
+    blas_run_single_thread() : prev(openblas_get_num_threads()) { openblas_set_num_threads(1); }
+    ~blas_run_single_thread() { openblas_set_num_threads(prev); }
+#else
+    // Non trivial so that unused variable warnings do not fire
+    blas_run_single_thread() {}
+    ~blas_run_single_thread() {}
+#endif
+};
+
+// MKL has a thread count for each calling thread. It is set by every task
+// of the parallel batches.
+struct blas_task_single_thread
+{
+#ifdef USE_MKL
+    int prev;
+    blas_task_single_thread() : prev(mkl_set_num_threads_local(1)) {}
+    ~blas_task_single_thread() { mkl_set_num_threads_local(prev); }
+#else
+    blas_task_single_thread() {}
+    ~blas_task_single_thread() {}
+#endif
+};
+
 template<typename T>
 Array<T> matmul(const Array<T> &lhs, const Array<T> &rhs,
                 af_mat_prop optLhs, af_mat_prop optRhs)
@@ -162,35 +230,99 @@ Array<T> matmul(const Array<T> &lhs, const Array<T> &rhs,
     int N = rDims[bColDim];
     int K = lDims[aColDim];
 
+    // Batches along dims 2 and 3, a single matrix being used for all of them
+    dim4 oDims(M, N, std::max(lDims[2], rDims[2]), std::max(lDims[3], rDims[3]));
+
     using BT  =       typename blas_base<T>::type;
     using CBT = const typename blas_base<T>::type;
 
-    Array<T> out = createEmptyArray<T>(af::dim4(M, N, 1, 1));
+    Array<T> out = createEmptyArray<T>(oDims);
     auto func = [=] (Array<T> output, const Array<T> left, const Array<T> right) {
         auto alpha = getScale<T, 1>();
         auto beta  = getScale<T, 0>();
 
         dim4 lStrides = left.strides();
         dim4 rStrides = right.strides();
+        dim4 oStrides = output.strides();
+
+        const dim_t batches = oDims[2] * oDims[3];
+
+        auto lPtr = [&](dim_t b) {
+            dim_t b2 = b % oDims[2], b3 = b / oDims[2];
+            return left.get() + (lDims[2] == 1 ? 0 : b2) * lStrides[2]
+                              + (lDims[3] == 1 ? 0 : b3) * lStrides[3];
+        };
+        auto rPtr = [&](dim_t b) {
+            dim_t b2 = b % oDims[2], b3 = b / oDims[2];
+            return right.get() + (rDims[2] == 1 ? 0 : b2) * rStrides[2]
+                               + (rDims[3] == 1 ? 0 : b3) * rStrides[3];
+        };
+        auto oPtr = [&](dim_t b) {
+            return output.get() + (b % oDims[2]) * oStrides[2] + (b / oDims[2]) * oStrides[3];
+        };
+
+        auto multiply = [&](dim_t lo, dim_t hi) {
+            for (dim_t b = lo; b < hi; b++) {
+                if(rDims[bColDim] == 1) {
+                    gemv_func<T>()(
+                        CblasColMajor, lOpts,
+                        lDims[0], lDims[1],
+                        alpha,
+                        reinterpret_cast<CBT*>(lPtr(b)), lStrides[1],
+                        reinterpret_cast<CBT*>(rPtr(b)), rStrides[0],
+                        beta,
+                        reinterpret_cast<BT*>(oPtr(b)), 1);
+                } else {
+                    gemm_func<T>()(
+                        CblasColMajor, lOpts, rOpts,
+                        M, N, K,
+                        alpha,
+                        reinterpret_cast<CBT*>(lPtr(b)), lStrides[1],
+                        reinterpret_cast<CBT*>(rPtr(b)), rStrides[1],
+                        beta,
+                        reinterpret_cast<BT*>(oPtr(b)), oStrides[1]);
+                }
+            }
+        };
+
+        if (batches == 1) {
+            multiply(0, 1);
+            return;
+        }
+
+#ifdef USE_MKL
+        // MKL multiplies all the batches in a single call
+        if(rDims[bColDim] != 1) {
+            std::vector<CBT*> lPtrs(batches), rPtrs(batches);
+            std::vector<BT*>  oPtrs(batches);
+            for (dim_t b = 0; b < batches; b++) {
+                lPtrs[b] = reinterpret_cast<CBT*>(lPtr(b));
+                rPtrs[b] = reinterpret_cast<CBT*>(rPtr(b));
+                oPtrs[b] = reinterpret_cast<BT*>(oPtr(b));
+            }
+            T one(1), zero(0);
+            MKL_INT m = M, n = N, k = K, size = batches;
+            MKL_INT lda = lStrides[1], ldb = rStrides[1], ldc = oStrides[1];
+            gemm_batch_func<T>()(
+                CblasColMajor, &lOpts, &rOpts, &m, &n, &k,
+                reinterpret_cast<CBT*>(&one), lPtrs.data(), &lda,
+                rPtrs.data(), &ldb,
+                reinterpret_cast<CBT*>(&zero), oPtrs.data(), &ldc,
+                1, &size);
+            return;
+        }
+#endif
 
-        if(rDims[bColDim] == 1) {
-            gemv_func<T>()(
-                CblasColMajor, lOpts,
-                lDims[0], lDims[1],
-                alpha,
-                reinterpret_cast<CBT*>(left.get()), lStrides[1],
-                reinterpret_cast<CBT*>(right.get()), rStrides[0],
-                beta,
-                reinterpret_cast<BT*>(output.get()), 1);
+        const dim_t work = std::max<dim_t>((dim_t)M * N * K, 1);
+        if (MATMUL_BATCH_PARALLEL && work <= MATMUL_BATCH_PARALLEL_MAX) {
+            blas_run_single_thread single;
+            parallel_for(0, batches, (MIN_TASK_WORK + work - 1) / work,
+                         [&](dim_t lo, dim_t hi) {
+                             blas_task_single_thread task_single;
+                             multiply(lo, hi);
+                         });
         } else {
-            gemm_func<T>()(
-                CblasColMajor, lOpts, rOpts,
-                M, N, K,
-                alpha,
-                reinterpret_cast<CBT*>(left.get()), lStrides[1],
-                reinterpret_cast<CBT*>(right.get()), rStrides[1],
-                beta,
-                reinterpret_cast<BT*>(output.get()), output.dims()[0]);
+            multiply(0, batches);
         }
     };
     getQueue().enqueue(func, out, lhs, rhs);
@@ -199,25 +331,84 @@ Array<T> matmul(const Array<T> &lhs, const Array<T> &rhs,
 }
 
 template<typename T>
-Array<T> dot(const Array<T> &lhs, const Array<T> &rhs,
+void gemm(bool transA, bool transB, int M, int N, int K,
+          const T *A, int lda, const T *B, int ldb, T *C, int ldc)
+{
+    using BT  =       typename blas_base<T>::type;
+    using CBT = const typename blas_base<T>::type;
+
+    gemm_func<T>()(CblasColMajor,
+                   transA ? CblasTrans : CblasNoTrans,
+                   transB ? CblasTrans : CblasNoTrans,
+                   M, N, K,
+                   getScale<T, 1>(),
+                   reinterpret_cast<CBT*>(A), lda,
+                   reinterpret_cast<CBT*>(B), ldb,
+                   getScale<T, 0>(),
+                   reinterpret_cast<BT*>(C), ldc);
+}
+
+/// Dot products use Kahan summation when AF_CPU_COMPENSATED_DOT is set to 1
+static bool compensatedDot()
+{
+    static const bool compensated = getEnvVar("AF_CPU_COMPENSATED_DOT") == "1";
+    return compensated;
+}
+
+template<typename T>
+Array<T> dot(const Array<T> &lhs, const Array<T> &rhs, const int dim,
              af_mat_prop optLhs, af_mat_prop optRhs)
 {
     lhs.eval();
     rhs.eval();
 
-    Array<T> out = createEmptyArray<T>(af::dim4(1));
+    af::dim4 odims = lhs.dims();
+    odims[dim] = 1;
+    Array<T> out = createEmptyArray<T>(odims);
+
+    const bool compensated = compensatedDot();
     if(optLhs == AF_MAT_CONJ && optRhs == AF_MAT_CONJ) {
-        getQueue().enqueue(kernel::dot<T, false, true>, out, lhs, rhs, optLhs, optRhs);
+        getQueue().enqueue(kernel::dot<T, false, true>, out, lhs, rhs, dim, compensated);
     } else if (optLhs == AF_MAT_CONJ && optRhs == AF_MAT_NONE) {
-        getQueue().enqueue(kernel::dot<T, true, false>,out, lhs, rhs, optLhs, optRhs);
+        getQueue().enqueue(kernel::dot<T, true, false>,out, lhs, rhs, dim, compensated);
     } else if (optLhs == AF_MAT_NONE && optRhs == AF_MAT_CONJ) {
-        getQueue().enqueue(kernel::dot<T, true, false>,out, rhs, lhs, optRhs, optLhs);
+        getQueue().enqueue(kernel::dot<T, true, false>,out, rhs, lhs, dim, compensated);
     } else {
-        getQueue().enqueue(kernel::dot<T, false, false>,out, lhs, rhs, optLhs, optRhs);
+        getQueue().enqueue(kernel::dot<T, false, false>,out, lhs, rhs, dim, compensated);
     }
     return out;
 }
 
+template<typename T>
+Array<T> dot(const Array<T> &lhs, const Array<T> &rhs,
+             af_mat_prop optLhs, af_mat_prop optRhs)
+{
+    return dot<T>(lhs, rhs, 0, optLhs, optRhs);
+}
+
+template<typename T>
+void axpy(Array<T> &y, const Array<T> &x, const double alpha)
+{
+    y.eval();
+    x.eval();
+    getQueue().enqueue(kernel::axpy<T>, y, x, alpha);
+}
+
+template<typename T>
+void scal(Array<T> &x, const double alpha)
+{
+    x.eval();
+    getQueue().enqueue(kernel::scal<T>, x, alpha);
+}
+
+template<typename T>
+double nrm2(const Array<T> &in)
+{
+    in.eval();
+    getQueue().sync();
+    return kernel::nrm2<T>(in);
+}
+
 #undef BT
 #undef REINTEPRET_CAST
 
@@ -230,9 +421,24 @@ INSTANTIATE_BLAS(cfloat)
 INSTANTIATE_BLAS(double)
 INSTANTIATE_BLAS(cdouble)
 
+#define INSTANTIATE_GEMM(TYPE)                                                      \
+    template void gemm<TYPE>(bool transA, bool transB, int M, int N, int K,         \
+                             const TYPE *A, int lda, const TYPE *B, int ldb,        \
+                             TYPE *C, int ldc);
+
+INSTANTIATE_GEMM(float)
+INSTANTIATE_GEMM(cfloat)
+INSTANTIATE_GEMM(double)
+INSTANTIATE_GEMM(cdouble)
+
 #define INSTANTIATE_DOT(TYPE)                                                               \
     template Array<TYPE> dot<TYPE>(const Array<TYPE> &lhs, const Array<TYPE> &rhs,          \
-                                   af_mat_prop optLhs, af_mat_prop optRhs);
+                                   af_mat_prop optLhs, af_mat_prop optRhs);                 \
+    template Array<TYPE> dot<TYPE>(const Array<TYPE> &lhs, const Array<TYPE> &rhs,          \
+                                   const int dim, af_mat_prop optLhs, af_mat_prop optRhs);  \
+    template void axpy<TYPE>(Array<TYPE> &y, const Array<TYPE> &x, const double alpha);     \
+    template void scal<TYPE>(Array<TYPE> &x, const double alpha);                           \
+    template double nrm2<TYPE>(const Array<TYPE> &in);
 
 INSTANTIATE_DOT(float)
 INSTANTIATE_DOT(double)
@@ -7,6 +7,7 @@
  * http://arrayfire.com/licenses/BSD-3-Clause
  ********************************************************/
 
+#pragma once
 #include <Array.hpp>
 #include <types.hpp>
 
@@ -44,4 +45,27 @@ template<typename T>
 Array<T> dot(const Array<T> &lhs, const Array<T> &rhs,
              af_mat_prop optLhs, af_mat_prop optRhs);
 
+/// Dot products of the columns of lhs and rhs along dim
+template<typename T>
+Array<T> dot(const Array<T> &lhs, const Array<T> &rhs, const int dim,
+             af_mat_prop optLhs, af_mat_prop optRhs);
+
+/// y = alpha * x + y, in place
+template<typename T>
+void axpy(Array<T> &y, const Array<T> &x, const double alpha);
+
+/// x = alpha * x, in place
+template<typename T>
+void scal(Array<T> &x, const double alpha);
+
+/// Euclidean norm of all the elements of in
+template<typename T>
+double nrm2(const Array<T> &in);
+
+/// C = op(A) * op(B) on column major host buffers, run right away on the
+/// calling thread. Meant for kernels that multiply blocks of their inputs.
+template<typename T>
+void gemm(bool transA, bool transB, int M, int N, int K,
+          const T *A, int lda, const T *B, int ldb, T *C, int ldc);
+
 }
@@ -21,6 +21,8 @@
 #include <lapack_helper.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <kernel/lapack_batch.hpp>
+#include <vector>
 
 namespace cpu
 {
@@ -71,11 +73,25 @@ int cholesky_inplace(Array<T> &in, const bool is_upper)
         uplo = 'U';
 
     int info = 0;
-    auto func = [&] (int& info, Array<T>& in) {
-        info = potrf_func<T>()(AF_LAPACK_COL_MAJOR, uplo, N, in.get(), in.strides()[1]);
+    auto func = [&] (Array<T> in) {
+        dim4 iStrides = in.strides();
+        dim_t batches = kernel::batch_count(iDims);
+        std::vector<int> infos(batches);
+
+        kernel::batch_for(batches, N, [&](dim_t b) {
+            T *a = in.get() + kernel::batch_offset(iDims, iStrides, b);
+            if (N <= kernel::SMALL_LAPACK_MAX) {
+                infos[b] = kernel::small_lapack<kernel::small_potrf, T>(N, a, iStrides[1], is_upper);
+            } else {
+                infos[b] = potrf_func<T>()(AF_LAPACK_COL_MAJOR, uplo, N, a, iStrides[1]);
+            }
+        });
+
+        // The first matrix that is not positive definite is reported
+        for (dim_t b = 0; b < batches && info == 0; b++) info = infos[b];
     };
 
-    getQueue().enqueue(func, info, in);
+    getQueue().enqueue(func, in);
     getQueue().sync();
 
     return info;
@@ -10,11 +10,13 @@
 #include <af/dim4.hpp>
 #include <Array.hpp>
 #include <convolve.hpp>
+#include <dispatch.hpp>
 #include <err_cpu.hpp>
 #include <math.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
 #include <kernel/convolve.hpp>
+#include <cmath>
 
 using af::dim4;
 
@@ -84,6 +86,25 @@ Array<T> convolve2(Array<T> const& signal, Array<accT> const& c_filter, Array<ac
     return out;
 }
 
+// Cost of a single point of a padded FFT relative to a multiply-add of the
+// spatial kernels, counting the forward, pointwise and inverse steps
+static const double FFT_POINT_COST = 12.0;
+
+bool isFreqDomainPreferred(const dim4 &sDims, const dim4 &fDims, const int baseDim)
+{
+    // The kernels take filters of any size, so pick the cheaper path.
+    // Batches scale both sides alike and are left out
+    double direct = 1, padded = 1;
+    for (int i = 0; i < baseDim; i++) {
+        direct *= (double)sDims[i] * (double)fDims[i];
+        padded *= nextpow2((unsigned)(sDims[i] + fDims[i] - 1));
+    }
+
+    // Separable filters make the spatial path cheaper still, but that needs
+    // the filter values and is left to convolve2
+    return FFT_POINT_COST * padded * std::log2(padded) < direct;
+}
+
 #define INSTANTIATE(T, accT)                                            \
     template Array<T> convolve <T, accT, 1, true >(Array<T> const& signal, Array<accT> const& filter, AF_BATCH_KIND kind); \
     template Array<T> convolve <T, accT, 1, false>(Array<T> const& signal, Array<accT> const& filter, AF_BATCH_KIND kind); \
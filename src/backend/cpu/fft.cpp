@@ -23,6 +23,8 @@ namespace cpu
 
 void setFFTPlanCacheSize(size_t numPlans)
 {
+    kernel::FFTWPlanner<fftwf_plan>::getInstance().setMaxCacheSize(numPlans);
+    kernel::FFTWPlanner<fftw_plan >::getInstance().setMaxCacheSize(numPlans);
 }
 
 template<typename T, int rank, bool direction>
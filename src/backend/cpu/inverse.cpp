@@ -25,6 +25,7 @@
 #include <solve.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <kernel/lapack_batch.hpp>
 
 namespace cpu
 {
@@ -61,12 +62,31 @@ Array<T> inverse(const Array<T> &in)
     }
 
     Array<T> A = copyArray<T>(in);
+
+    if (M <= kernel::SMALL_LAPACK_MAX) {
+        auto func = [=] (Array<T> A, int M) {
+            dim4 aDims = A.dims();
+            dim4 aStrides = A.strides();
+            kernel::batch_for(kernel::batch_count(aDims), M, [&](dim_t b) {
+                T *a = A.get() + kernel::batch_offset(aDims, aStrides, b);
+                kernel::small_lapack<kernel::small_getri, T>(M, a, aStrides[1]);
+            });
+        };
+        getQueue().enqueue(func, A, M);
+        return A;
+    }
+
     Array<int> pivot = lu_inplace<T>(A, false);
 
     auto func = [=] (Array<T> A, Array<int> pivot, int M) {
-        getri_func<T>()(AF_LAPACK_COL_MAJOR, M,
-                A.get(), A.strides()[1],
-                pivot.get());
+        dim4 aDims = A.dims();
+        dim4 aStrides = A.strides();
+        dim4 pStrides = pivot.strides();
+        kernel::batch_for(kernel::batch_count(aDims), M, [&](dim_t b) {
+            getri_func<T>()(AF_LAPACK_COL_MAJOR, M,
+                    A.get() + kernel::batch_offset(aDims, aStrides, b), aStrides[1],
+                    pivot.get() + kernel::batch_offset(aDims, pStrides, b));
+        });
     };
     getQueue().enqueue(func, A, pivot, M);
 
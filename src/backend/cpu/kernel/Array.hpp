@@ -10,50 +10,177 @@
 #pragma once
 #include <Array.hpp>
 #include <platform.hpp>
+#include <thread_pool.hpp>
+#include <TNJ/Node.hpp>
+#include <algorithm>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
+// Minimum number of blocks handled by a single task
+const dim_t MIN_BLOCKS_PER_TASK = MIN_TASK_WORK / TNJ::VECTOR_LENGTH;
+
+// Scratch space for evaluating one block of every node on a single thread
+class BlockScratch
+{
+    std::vector<char> data;
+    std::vector<char *> scratch;
+
+public:
+    std::vector<void *> vals;
+
+    BlockScratch(const std::vector<TNJ::Node *> &nodes) :
+        scratch(nodes.size()), vals(nodes.size())
+    {
+        const size_t align = 64;
+        std::vector<size_t> offsets(nodes.size());
+        size_t bytes = 0;
+        for (int n = 0; n < (int)nodes.size(); n++) {
+            offsets[n] = bytes;
+            size_t node_bytes = nodes[n]->getTypeSize() * TNJ::VECTOR_LENGTH;
+            bytes += ((node_bytes + align - 1) / align) * align;
+        }
+
+        data.resize(bytes + align);
+        char *base = data.data();
+        base += (align - (size_t)base % align) % align;
+
+        for (int n = 0; n < (int)nodes.size(); n++) {
+            scratch[n] = base + offsets[n];
+        }
+    }
+
+    void *get(int n) const { return scratch[n]; }
+};
+
+// Evaluates the nodes for a single block of lim elements.
+// The values of the root nodes are written to the matching outputs.
+template<typename T, typename... Args>
+void evalBlock(const std::vector<TNJ::Node *> &nodes,
+               const std::vector<int> &out_ids, T **outs,
+               BlockScratch &block, int lim, Args... args)
+{
+    std::vector<void *> &vals = block.vals;
+    int num = (int)nodes.size();
+    for (int n = 0; n < num; n++) {
+        int id = out_ids[n];
+        vals[n] = id < 0 ? block.get(n) : outs[id];
+        nodes[n]->calc(vals.data(), args..., lim);
+        if (id >= 0 && vals[n] != outs[id]) {
+            std::copy((T *)vals[n], (T *)vals[n] + lim, outs[id]);
+        }
+    }
+}
+
+// Evaluates several trees of the same size in a single pass.
+// Nodes shared between the trees are evaluated only once per block.
 template<typename T>
-void evalArray(Array<T> in)
+void evalNodes(std::vector<T *> ptrs, std::vector<TNJ::Node *> roots,
+               af::dim4 odims, af::dim4 ostrs)
 {
-    in.setId(cpu::getActiveDeviceId());
-    T *ptr = in.data.get();
+    int num_outs = (int)roots.size();
 
-    af::dim4 odims = in.dims();
-    af::dim4 ostrs = in.strides();
+    bool is_linear = true;
+    for (auto root : roots) {
+        is_linear &= root->isLinear(odims.get());
+    }
 
-    bool is_linear = in.node->isLinear(odims.get());
+    // Order the nodes so that children are evaluated before their parents
+    std::vector<TNJ::Node *> nodes;
+    for (auto root : roots) {
+        root->getNodes(nodes);
+    }
 
-    if (is_linear) {
-        int num = in.elements();
-        for (int i = 0; i < num; i++) {
-            ptr[i] = *(T *)in.node->calc(i);
+    // Map the root nodes to their outputs
+    std::vector<int> out_ids(nodes.size(), -1);
+    std::vector<int> dup_outs;
+    for (int i = 0; i < num_outs; i++) {
+        int id = roots[i]->getId();
+        if (out_ids[id] < 0) out_ids[id] = i;
+        else dup_outs.push_back(i);
+    }
+
+    // Outputs sharing a root with an earlier output are copied from it
+    auto copyDuplicates = [&](T **outs, int lim) {
+        for (int i : dup_outs) {
+            T *src = outs[out_ids[roots[i]->getId()]];
+            std::copy(src, src + lim, outs[i]);
         }
-    } else {
-        for (int w = 0; w < (int)odims[3]; w++) {
-            dim_t offw = w * ostrs[3];
+    };
+
+    if (is_linear) {
+        dim_t num = odims.elements();
+        dim_t num_blocks = (num + TNJ::VECTOR_LENGTH - 1) / TNJ::VECTOR_LENGTH;
 
-            for (int z = 0; z < (int)odims[2]; z++) {
-                dim_t offz = z * ostrs[2] + offw;
+        parallel_for(0, num_blocks, MIN_BLOCKS_PER_TASK, [&](dim_t b0, dim_t b1) {
+            BlockScratch block(nodes);
+            std::vector<T *> outs(num_outs);
+
+            for (dim_t b = b0; b < b1; b++) {
+                dim_t i = b * TNJ::VECTOR_LENGTH;
+                int lim = (int)std::min<dim_t>(TNJ::VECTOR_LENGTH, num - i);
+                for (int k = 0; k < num_outs; k++) outs[k] = ptrs[k] + i;
+                evalBlock(nodes, out_ids, outs.data(), block, lim, i);
+                copyDuplicates(outs.data(), lim);
+            }
+        });
+    } else {
+        // Blocks run along the first dimension of every row
+        dim_t blocks_x = (odims[0] + TNJ::VECTOR_LENGTH - 1) / TNJ::VECTOR_LENGTH;
+        dim_t num_blocks = blocks_x * odims[1] * odims[2] * odims[3];
 
-                for (int y = 0; y < (int)odims[1]; y++) {
-                    dim_t offy = y * ostrs[1] + offz;
+        parallel_for(0, num_blocks, MIN_BLOCKS_PER_TASK, [&](dim_t b0, dim_t b1) {
+            BlockScratch block(nodes);
+            std::vector<T *> outs(num_outs);
 
-                    for (int x = 0; x < (int)odims[0]; x++) {
-                        dim_t id = x + offy;
+            for (dim_t b = b0; b < b1; b++) {
+                dim_t row = b / blocks_x;
+                int x = (int)(b - row * blocks_x) * TNJ::VECTOR_LENGTH;
+                int y = (int)(row % odims[1]);
+                int z = (int)((row / odims[1]) % odims[2]);
+                int w = (int)(row / (odims[1] * odims[2]));
+                int lim = std::min<int>(TNJ::VECTOR_LENGTH, (int)odims[0] - x);
 
-                        ptr[id] = *(T *)in.node->calc(x, y, z, w);
-                    }
-                }
+                dim_t off = w * ostrs[3] + z * ostrs[2] + y * ostrs[1] + x;
+                for (int k = 0; k < num_outs; k++) outs[k] = ptrs[k] + off;
+                evalBlock(nodes, out_ids, outs.data(), block, lim, x, y, z, w);
+                copyDuplicates(outs.data(), lim);
             }
-        }
+        });
     }
 
     // Reset TNJ flags
-    in.node->reset();
+    for (auto root : roots) {
+        root->reset();
+    }
+}
+
+template<typename T>
+void evalArray(Array<T> in)
+{
+    in.setId(cpu::getActiveDeviceId());
+
+    std::vector<T *> ptrs(1, in.data.get());
+    std::vector<TNJ::Node *> roots(1, in.node.get());
+    evalNodes(ptrs, roots, in.dims(), in.strides());
+}
+
+template<typename T>
+void evalMultiple(std::vector<Array<T>> arrays)
+{
+    std::vector<T *> ptrs;
+    std::vector<TNJ::Node *> roots;
+
+    for (auto &array : arrays) {
+        array.setId(cpu::getActiveDeviceId());
+        ptrs.push_back(array.data.get());
+        roots.push_back(array.node.get());
+    }
+
+    evalNodes(ptrs, roots, arrays[0].dims(), arrays[0].strides());
 }
 
 }
@@ -10,13 +10,53 @@
 #pragma once
 #include <Array.hpp>
 #include <utility.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
+// The range weight exp(-t) is read from a table of RANGE_LUT_SIZE samples
+// over [0, RANGE_LUT_MAX) with linear interpolation. Larger t give 0.
+static const int   RANGE_LUT_SIZE = 4096;
+static const float RANGE_LUT_MAX  = 24.f;
+
+template<typename T>
+class RangeLUT
+{
+    std::vector<T> table;
+    T scale;
+
+public:
+    RangeLUT() : table(RANGE_LUT_SIZE + 2), scale(RANGE_LUT_SIZE / RANGE_LUT_MAX)
+    {
+        for (int k = 0; k < (int)table.size(); k++) table[k] = std::exp(-k / scale);
+    }
+
+    T operator()(T t) const
+    {
+        // NaN is passed through like std::exp does
+        if (!(t < RANGE_LUT_MAX)) return (t >= RANGE_LUT_MAX) ? T(0) : t;
+        T x = t * scale;
+        int k = (int)x;
+        T frac = x - k;
+        return table[k] + frac * (table[k + 1] - table[k]);
+    }
+};
+
+// The interpolated table is only accurate to about 1e-6, so double precision
+// output evaluates the exponential
+template<>
+class RangeLUT<double>
+{
+public:
+    double operator()(double t) const { return std::exp(-t); }
+};
+
 template<typename OutT, typename InT, bool IsColor>
 void bilateral(Array<OutT> out, Array<InT> const in, float const s_sigma, float const c_sigma)
 {
@@ -33,48 +73,250 @@ void bilateral(Array<OutT> out, Array<InT> const in, float const s_sigma, float
     dim_t const radius = std::max((dim_t)(space_ * 1.5f), (dim_t)1);
     float const svar   = space_*space_;
     float const cvar   = color_*color_;
+    dim_t const width  = 2 * radius + 1;
+
+    // Spatial weights do not depend on the pixel
+    std::vector<OutT> spatial(width * width);
+    for(dim_t wj=-radius; wj<=radius; ++wj) {
+        for(dim_t wi=-radius; wi<=radius; ++wi) {
+            spatial[(wj + radius) * width + (wi + radius)] = std::exp((wi*wi+wj*wj)/(-2.0*svar));
+        }
+    }
+    RangeLUT<OutT> const range;
+    OutT const rscale = OutT(1) / (2.0 * cvar);
+
+    // b3 handles gfor and input based batch for color images
+    // b2 handles channels and input based batch for grayscale images
+    dim_t const rows = dims[1] * dims[2] * dims[3];
+    parallel_for(0, rows, std::max<dim_t>(1, MIN_TASK_WORK / (dims[0] * width * width + 1)),
+                 [&](dim_t lo, dim_t hi) {
+        for(dim_t r=lo; r<hi; ++r) {
+            dim_t const j  = r % dims[1];
+            dim_t const b2 = (r / dims[1]) % dims[2];
+            dim_t const b3 = r / (dims[1] * dims[2]);
+
+            InT const * src = inData  + b2 * istrides[2] + b3 * istrides[3];
+                  OutT * dst = outData + b2 * ostrides[2] + b3 * ostrides[3];
+
+            // rows of the window with clamped offsets
+            std::vector<InT const *> wrows(width);
+            for(dim_t wj=-radius; wj<=radius; ++wj) {
+                wrows[wj + radius] = src + clamp(j+wj, 0, dims[1]-1) * istrides[1];
+            }
+
+            for(dim_t i=0; i<dims[0]; ++i) {
+                // i steps along 1st dimension
+                OutT norm = 0.0;
+                OutT res  = 0.0;
+                OutT const center = (OutT)src[getIdx(istrides, i, j)];
+                OutT const *sw = spatial.data();
+                bool const interior = (i >= radius && i + radius < dims[0]);
+                for(dim_t wj=0; wj<width; ++wj) {
+                    InT const * row = wrows[wj];
+                    for(dim_t wi=-radius; wi<=radius; ++wi, ++sw) {
+                        // clamps offsets near the borders
+                        dim_t ti = interior ? i+wi : clamp(i+wi, 0, dims[0]-1);
+                        OutT const val    = (OutT)row[ti * istrides[0]];
+                        OutT const weight = *sw * range((center-val)*(center-val)*rscale);
+                        norm += weight;
+                        res += val*weight;
+                    }
+                } // filter loop ends here
 
-    for(dim_t b3=0; b3<dims[3]; ++b3) {
-        // b3 for loop handles following batch configurations
-        //  - gfor
-        //  - input based batch
-        //      - when input is 4d array for color images
-        for(dim_t b2=0; b2<dims[2]; ++b2) {
-            // b2 for loop handles following batch configurations
-            //  - channels
-            //  - input based batch
-            //      - when input is 3d array for grayscale images
-            for(dim_t j=0; j<dims[1]; ++j) {
-                // j steps along 2nd dimension
+                dst[getIdx(ostrides, i, j)] = res/norm;
+            } //1st dimension loop ends here
+        }
+    });
+}
+
+// Number of empty cells around the data in the bilateral grid
+static const dim_t GRID_PAD = 2;
+
+// Range cells of the bilateral grid are widened to keep at most this many
+static const dim_t GRID_MAX_RANGE = 256;
+
+// Grids with more cells than this many per pixel, or GRID_MIN_CELLS for small
+// images, are not built and the exact filter is used instead
+static const dim_t GRID_CELLS_PER_PIXEL = 4;
+static const dim_t GRID_MIN_CELLS       = 1 << 16;
+
+// Blurs the (weighted sum, weight) pairs of the grid with [1 4 6 4 1] / 16
+// along dimension d of gdims
+template<typename T>
+void blurGrid(std::vector<T> &grid, const dim_t *gdims, const int d)
+{
+    const dim_t stride = (d == 0) ? 1 : (d == 1) ? gdims[0] : gdims[0] * gdims[1];
+    const dim_t n      = gdims[d];
+    const dim_t lines  = gdims[0] * gdims[1] * gdims[2] / n;
+
+    parallel_for(0, lines, std::max<dim_t>(1, MIN_TASK_WORK / n), [&](dim_t lo, dim_t hi) {
+        std::vector<T> line(2 * n);
+        for (dim_t l = lo; l < hi; l++) {
+            // Start of line l: all cells with index 0 along d
+            const dim_t base = (l % stride) + (l / stride) * stride * n;
+            T *g = grid.data() + 2 * base;
+
+            for (dim_t k = 0; k < n; k++) {
+                line[2 * k + 0] = g[2 * k * stride + 0];
+                line[2 * k + 1] = g[2 * k * stride + 1];
+            }
+
+            for (dim_t k = 0; k < n; k++) {
+                T acc[2] = {0, 0};
+                for (int o = -2; o <= 2; o++) {
+                    const dim_t q = k + o;
+                    if (q < 0 || q >= n) continue;
+                    const T c = (o == 0) ? T(6) : (o == 1 || o == -1) ? T(4) : T(1);
+                    acc[0] += c * line[2 * q + 0];
+                    acc[1] += c * line[2 * q + 1];
+                }
+                g[2 * k * stride + 0] = acc[0] / T(16);
+                g[2 * k * stride + 1] = acc[1] / T(16);
+            }
+        }
+    });
+}
+
+// Bilateral grid approximation. Every image of the batch is splatted into a
+// 3D grid sampled every s_sigma pixels and c_sigma intensities, blurred with a
+// Gaussian of one cell and sliced with trilinear interpolation. The cost does
+// not depend on the sigmas. When the grid would be much larger than the image
+// (small s_sigma or c_sigma) the exact filter is used instead.
+template<typename OutT, typename InT, bool IsColor>
+void bilateralGrid(Array<OutT> out, Array<InT> const in, float const s_sigma, float const c_sigma)
+{
+    af::dim4 const dims     = in.dims();
+    af::dim4 const istrides = in.strides();
+    af::dim4 const ostrides = out.strides();
+
+          OutT *outData = out.get();
+    InT const * inData  = in.get();
+
+    if (dims.elements() == 0) return;
+
+    // clamp spatical and chromatic sigma's like the exact filter
+    OutT const ss = std::max(std::min(11.5f, std::max(s_sigma, 0.f)), 1.f);
+    OutT const cs = std::max(c_sigma, 0.f);
+
+    dim_t const images = dims[2] * dims[3];
+
+    // Intensity range of every image
+    std::vector<OutT> vmins(images), vmaxs(images);
+    for(dim_t b=0; b<images; ++b) {
+        InT const * src = inData + (b % dims[2]) * istrides[2] + (b / dims[2]) * istrides[3];
+        std::vector<OutT> rmin(dims[1]), rmax(dims[1]);
+        parallel_for(0, dims[1], std::max<dim_t>(1, MIN_TASK_WORK / dims[0]),
+                     [&](dim_t lo, dim_t hi) {
+            for(dim_t j=lo; j<hi; ++j) {
+                OutT vmin = (OutT)src[getIdx(istrides, 0, j)], vmax = vmin;
+                for(dim_t i=1; i<dims[0]; ++i) {
+                    OutT const val = (OutT)src[getIdx(istrides, i, j)];
+                    vmin = std::min(vmin, val);
+                    vmax = std::max(vmax, val);
+                }
+                rmin[j] = vmin;
+                rmax[j] = vmax;
+            }
+        });
+        vmins[b] = *std::min_element(rmin.begin(), rmin.end());
+        vmaxs[b] = *std::max_element(rmax.begin(), rmax.end());
+    }
+
+    auto rangeCell = [&](dim_t b) {
+        return std::max(cs, (vmaxs[b] - vmins[b]) / OutT(GRID_MAX_RANGE - 1));
+    };
+
+    dim_t gdims[3];
+    gdims[0] = (dim_t)((dims[0] - 1) / ss) + 1 + 2 * GRID_PAD;
+    gdims[1] = (dim_t)((dims[1] - 1) / ss) + 1 + 2 * GRID_PAD;
+
+    dim_t const maxCells = std::max(GRID_MIN_CELLS, GRID_CELLS_PER_PIXEL * dims[0] * dims[1]);
+    for(dim_t b=0; b<images; ++b) {
+        OutT  const rs = rangeCell(b);
+        dim_t const gz = (rs > 0 ? (dim_t)((vmaxs[b] - vmins[b]) / rs) : 0) + 1 + 2 * GRID_PAD;
+        if (gdims[0] * gdims[1] * gz > maxCells) {
+            bilateral<OutT, InT, IsColor>(out, in, s_sigma, c_sigma);
+            return;
+        }
+    }
+
+    auto cellOf = [](OutT pos) { return (dim_t)(pos + OutT(0.5)); };
+
+    // Rows first[cy] to first[cy + 1] are splatted to the grid cells with y
+    // index cy. Those cells are not shared, so the rows of different y
+    // indices are splatted in parallel.
+    std::vector<dim_t> first(gdims[1] + 1, dims[1]);
+    for(dim_t j=dims[1]-1; j>=0; --j) first[cellOf(j / ss + GRID_PAD)] = j;
+    for(dim_t cy=gdims[1]-1; cy>=0; --cy) first[cy] = std::min(first[cy], first[cy + 1]);
+
+    for(dim_t b=0; b<images; ++b) {
+        dim_t const b2 = b % dims[2];
+        dim_t const b3 = b / dims[2];
+        InT const * src = inData  + b2 * istrides[2] + b3 * istrides[3];
+              OutT * dst = outData + b2 * ostrides[2] + b3 * ostrides[3];
+
+        OutT const vmin = vmins[b];
+        OutT const rs   = rangeCell(b);
+        gdims[2] = (rs > 0 ? (dim_t)((vmaxs[b] - vmin) / rs) : 0) + 1 + 2 * GRID_PAD;
+
+        std::vector<OutT> grid(2 * gdims[0] * gdims[1] * gdims[2], OutT(0));
+
+        auto position = [&](dim_t i, dim_t j, OutT val, OutT *pos) {
+            pos[0] = i / ss + GRID_PAD;
+            pos[1] = j / ss + GRID_PAD;
+            pos[2] = (rs > 0 ? (val - vmin) / rs : OutT(0)) + GRID_PAD;
+        };
+
+        parallel_for(0, gdims[1], std::max<dim_t>(1, MIN_TASK_WORK / (dims[0] * (dim_t)ss)),
+                     [&](dim_t lo, dim_t hi) {
+            for(dim_t j=first[lo]; j<first[hi]; ++j) {
                 for(dim_t i=0; i<dims[0]; ++i) {
-                    // i steps along 1st dimension
-                    OutT norm = 0.0;
-                    OutT res  = 0.0;
-                    OutT const center = (OutT)inData[getIdx(istrides, i, j)];
-                    for(dim_t wj=-radius; wj<=radius; ++wj) {
-                        // clamps offsets
-                        dim_t tj = clamp(j+wj, 0, dims[1]-1);
-                        for(dim_t wi=-radius; wi<=radius; ++wi) {
-                            // clamps offsets
-                            dim_t ti = clamp(i+wi, 0, dims[0]-1);
-                            // proceed
-                            OutT const val= (OutT)inData[getIdx(istrides, ti, tj)];
-                            OutT const gauss_space = (wi*wi+wj*wj)/(-2.0*svar);
-                            OutT const gauss_range = ((center-val)*(center-val))/(-2.0*cvar);
-                            OutT const weight = std::exp(gauss_space+gauss_range);
-                            norm += weight;
-                            res += val*weight;
+                    OutT const val = (OutT)src[getIdx(istrides, i, j)];
+                    OutT pos[3];
+                    position(i, j, val, pos);
+                    dim_t const cell = cellOf(pos[0]) +
+                                       gdims[0] * (cellOf(pos[1]) + gdims[1] * cellOf(pos[2]));
+                    grid[2 * cell + 0] += val;
+                    grid[2 * cell + 1] += 1;
+                }
+            }
+        });
+
+        for (int d = 0; d < 3; d++) blurGrid(grid, gdims, d);
+
+        parallel_for(0, dims[1], std::max<dim_t>(1, MIN_TASK_WORK / dims[0]),
+                     [&](dim_t lo, dim_t hi) {
+            for(dim_t j=lo; j<hi; ++j) {
+                for(dim_t i=0; i<dims[0]; ++i) {
+                    OutT const val = (OutT)src[getIdx(istrides, i, j)];
+                    OutT pos[3];
+                    position(i, j, val, pos);
+
+                    dim_t c[3];
+                    OutT  f[3];
+                    for (int d = 0; d < 3; d++) {
+                        c[d] = std::min((dim_t)pos[d], gdims[d] - 2);
+                        f[d] = pos[d] - c[d];
+                    }
+
+                    OutT acc[2] = {0, 0};
+                    for (int k = 0; k < 8; k++) {
+                        OutT w = 1;
+                        dim_t cell = 0;
+                        for (int d = 2; d >= 0; d--) {
+                            const int bit = (k >> d) & 1;
+                            w *= bit ? f[d] : 1 - f[d];
+                            cell = cell * gdims[d] + c[d] + bit;
                         }
-                    } // filter loop ends here
+                        acc[0] += w * grid[2 * cell + 0];
+                        acc[1] += w * grid[2 * cell + 1];
+                    }
 
-                    outData[getIdx(ostrides, i, j)] = res/norm;
-                } //1st dimension loop ends here
-            } //2nd dimension loop ends here
-            outData += ostrides[2];
-            inData  += istrides[2];
-        }
+                    dst[getIdx(ostrides, i, j)] = (acc[1] > 0) ? acc[0] / acc[1] : val;
+                }
+            }
+        });
     }
 }
-
 }
 }
@@ -0,0 +1,200 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <vector>
+
+namespace cpu
+{
+namespace kernel
+{
+
+/// Elements of a single run of a linear array
+static const dim_t BLAS1_CHUNK = 1 << 15;
+
+/// Splits the elements of an array in runs read with a constant stride,
+/// fixed size chunks when the array is linear and its columns otherwise. The
+/// runs do not depend on the number of threads.
+struct blas1_runs
+{
+    af::dim4 dims, strides;
+    bool linear;
+    dim_t elements, count, grain;
+
+    template<typename T>
+    explicit blas1_runs(const Array<T> &arr)
+        : dims(arr.dims()), strides(arr.strides()), linear(arr.isLinear()),
+          elements(arr.elements())
+    {
+        if (linear) {
+            count = (elements + BLAS1_CHUNK - 1) / BLAS1_CHUNK;
+            grain = 1;
+        } else {
+            count = dims[1] * dims[2] * dims[3];
+            grain = (MIN_TASK_WORK + dims[0] - 1) / std::max<dim_t>(dims[0], 1);
+        }
+    }
+
+    void get(const dim_t r, dim_t &off, dim_t &stride, dim_t &len) const
+    {
+        if (linear) {
+            off    = r * BLAS1_CHUNK;
+            stride = 1;
+            len    = std::min(BLAS1_CHUNK, elements - off);
+        } else {
+            const dim_t c0 = r % dims[1];
+            const dim_t c1 = (r / dims[1]) % dims[2];
+            const dim_t c2 = r / (dims[1] * dims[2]);
+            off    = c0 * strides[1] + c1 * strides[2] + c2 * strides[3];
+            stride = strides[0];
+            len    = dims[0];
+        }
+    }
+};
+
+/// Calls func(run, offset, stride, len) on every run of arr
+template<typename Func>
+void blas1_for(const blas1_runs &runs, Func func)
+{
+    parallel_for(0, runs.count, runs.grain, [&](dim_t b, dim_t e) {
+        for (dim_t r = b; r < e; ++r) {
+            dim_t off, stride, len;
+            runs.get(r, off, stride, len);
+            func(r, off, stride, len);
+        }
+    });
+}
+
+/// y = alpha * x + y, in place
+template<typename T>
+void axpy(Array<T> y, const Array<T> x, const double alpha)
+{
+    const T a = T(alpha);
+    const T *xptr = x.get();
+    T       *yptr = y.get();
+
+    if (y.isLinear() && x.isLinear()) {
+        parallel_for(0, y.elements(), MIN_TASK_WORK, [&](dim_t b, dim_t e) {
+            for (dim_t i = b; i < e; ++i) yptr[i] += a * xptr[i];
+        });
+        return;
+    }
+
+    const af::dim4 dims     = y.dims();
+    const af::dim4 ystrides = y.strides();
+    const af::dim4 xstrides = x.strides();
+    const dim_t cols = dims[1] * dims[2] * dims[3];
+    parallel_for(0, cols, (MIN_TASK_WORK + dims[0] - 1) / std::max<dim_t>(dims[0], 1),
+                 [&](dim_t b, dim_t e) {
+        for (dim_t c = b; c < e; ++c) {
+            const dim_t c0 = c % dims[1];
+            const dim_t c1 = (c / dims[1]) % dims[2];
+            const dim_t c2 = c / (dims[1] * dims[2]);
+            T       *yc = yptr + c0 * ystrides[1] + c1 * ystrides[2] + c2 * ystrides[3];
+            const T *xc = xptr + c0 * xstrides[1] + c1 * xstrides[2] + c2 * xstrides[3];
+            for (dim_t i = 0; i < dims[0]; ++i) yc[i * ystrides[0]] += a * xc[i * xstrides[0]];
+        }
+    });
+}
+
+/// x = alpha * x, in place
+template<typename T>
+void scal(Array<T> x, const double alpha)
+{
+    const T a = T(alpha);
+    T *xptr = x.get();
+    blas1_for(blas1_runs(x), [&](dim_t, dim_t off, dim_t stride, dim_t len) {
+        T *xc = xptr + off;
+        for (dim_t i = 0; i < len; ++i) xc[i * stride] *= a;
+    });
+}
+
+/// Squared magnitude of v * scale
+template<typename T>
+double nrm2_sq(const T v, const double scale)
+{
+    const double d = double(v) * scale;
+    return d * d;
+}
+
+template<typename T>
+double nrm2_sq(const std::complex<T> v, const double scale)
+{
+    const double re = double(v.real()) * scale;
+    const double im = double(v.imag()) * scale;
+    return re * re + im * im;
+}
+
+template<typename T>
+double nrm2_abs(const T v) { return std::abs(double(v)); }
+
+template<typename T>
+double nrm2_abs(const std::complex<T> v)
+{
+    return std::max(std::abs(double(v.real())), std::abs(double(v.imag())));
+}
+
+/// Sum of the squared magnitudes of in * scale, in double precision with 4
+/// partial sums per run
+template<typename T>
+double nrm2_sum(const Array<T> &in, const blas1_runs &runs, const double scale)
+{
+    const T *iptr = in.get();
+    std::vector<double> partial(runs.count);
+    blas1_for(runs, [&](dim_t r, dim_t off, dim_t stride, dim_t len) {
+        const T *p = iptr + off;
+        double s[4] = {0, 0, 0, 0};
+        const dim_t nv = len - len % 4;
+        for (dim_t i = 0; i < nv; i += 4)
+            for (int k = 0; k < 4; ++k) s[k] += nrm2_sq(p[(i + k) * stride], scale);
+        for (dim_t i = nv; i < len; ++i) s[0] += nrm2_sq(p[i * stride], scale);
+        partial[r] = (s[0] + s[1]) + (s[2] + s[3]);
+    });
+
+    double sum = 0;
+    for (dim_t r = 0; r < runs.count; ++r) sum += partial[r];
+    return sum;
+}
+
+/// Euclidean norm of all the elements of in. The squares are summed in a
+/// single pass, and only when that sum overflows or underflows are the
+/// elements scaled by the largest magnitude and summed again.
+template<typename T>
+double nrm2(const Array<T> &in)
+{
+    const blas1_runs runs(in);
+    const double sum = nrm2_sum(in, runs, 1.0);
+    if (std::isnan(sum) || (sum >= std::numeric_limits<double>::min() &&
+                            sum <= std::numeric_limits<double>::max()))
+        return std::sqrt(sum);
+
+    const T *iptr = in.get();
+    std::vector<double> peak(runs.count);
+    blas1_for(runs, [&](dim_t r, dim_t off, dim_t stride, dim_t len) {
+        const T *p = iptr + off;
+        double m = 0;
+        for (dim_t i = 0; i < len; ++i) m = std::max(m, nrm2_abs(p[i * stride]));
+        peak[r] = m;
+    });
+
+    double scale = 0;
+    for (dim_t r = 0; r < runs.count; ++r) scale = std::max(scale, peak[r]);
+    if (scale == 0 || std::isinf(scale)) return scale;
+
+    return scale * std::sqrt(nrm2_sum(in, runs, 1.0 / scale));
+}
+
+}
+}
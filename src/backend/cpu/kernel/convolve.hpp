@@ -9,116 +9,175 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
-template<typename InT, typename AccT, bool Expand>
-void one2one_1d(InT *optr, InT const * const iptr, AccT const * const fptr, af::dim4 const & oDims,
-                af::dim4 const & sDims, af::dim4 const & fDims, af::dim4 const & sStrides)
+/// Outputs computed per pass over the filter taps, small enough for the
+/// accumulators to stay in the L1 cache
+static const dim_t CONV_TILE = 512;
+
+/// acc[i - lo] += src[(i - w) * sStride] * filt[w * fStride] for every output
+/// i in [lo, hi) and every tap w whose source index lies in [0, sLen). Taps
+/// are added in order, and zero padding is skipped instead of read, so the
+/// inner loop has no bounds checks and is vectorized.
+template<typename SrcT, typename AccT>
+void conv_taps(AccT *acc, dim_t lo, dim_t hi,
+               SrcT const *src, dim_t sLen, dim_t sStride,
+               AccT const *filt, dim_t fLen, dim_t fStride)
 {
-    dim_t start = (Expand ? 0 : fDims[0]/2);
-    dim_t end   = (Expand ? oDims[0] : start + sDims[0]);
-    for(dim_t i=start; i<end; ++i) {
-        AccT accum = 0.0;
-        for(dim_t f=0; f<fDims[0]; ++f) {
-            dim_t iIdx = i-f;
-            InT s_val = ((iIdx>=0 &&iIdx<sDims[0])? iptr[iIdx*sStrides[0]] : InT(0));
-            accum += AccT(s_val * fptr[f]);
+    for (dim_t w = 0; w < fLen; ++w) {
+        AccT const f = filt[w * fStride];
+        dim_t b = std::max(lo, w);
+        dim_t e = std::min(hi, w + sLen);
+        if (b >= e) continue;
+
+        SrcT const *s = src + (b - w) * sStride;
+        AccT *a = acc + (b - lo);
+        dim_t n = e - b;
+        if (sStride == 1) {
+            for (dim_t i = 0; i < n; ++i) a[i] += AccT(s[i] * f);
+        } else {
+            for (dim_t i = 0; i < n; ++i) a[i] += AccT(s[i * sStride] * f);
         }
-        optr[i-start] = InT(accum);
     }
 }
 
-template<typename InT, typename AccT, bool Expand>
-void one2one_2d(InT *optr, InT const * const iptr, AccT const * const fptr, af::dim4 const & oDims,
-                af::dim4 const & sDims, af::dim4 const & fDims, af::dim4 const & oStrides,
-                af::dim4 const & sStrides, af::dim4 const & fStrides)
+/// Convolves the output line (j, k) of a single batch with every filter tap
+/// along dimensions 1 and 2 that lands inside the signal
+template<typename InT, typename AccT, dim_t baseDim, bool Expand>
+void one2one_line(InT *optr, InT const *iptr, AccT const *fptr, AccT *acc,
+                  dim_t j, dim_t k, af::dim4 const &sDims, af::dim4 const &fDims,
+                  af::dim4 const &sStrides, af::dim4 const &fStrides)
 {
-    dim_t jStart = (Expand ? 0 : fDims[1]/2);
-    dim_t jEnd   = (Expand ? oDims[1] : jStart + sDims[1]);
-    dim_t iStart = (Expand ? 0 : fDims[0]/2);
-    dim_t iEnd   = (Expand ? oDims[0] : iStart + sDims[0]);
+    dim_t const iStart = (Expand ? 0 : fDims[0]/2);
+    dim_t const iEnd   = (Expand ? sDims[0] + fDims[0] - 1 : iStart + sDims[0]);
+    dim_t const fLen1  = (baseDim > 1 ? fDims[1] : 1);
+    dim_t const fLen2  = (baseDim > 2 ? fDims[2] : 1);
+    dim_t const sLen1  = (baseDim > 1 ? sDims[1] : 1);
+    dim_t const sLen2  = (baseDim > 2 ? sDims[2] : 1);
+
+    for (dim_t t0 = iStart; t0 < iEnd; t0 += CONV_TILE) {
+        dim_t const t1 = std::min(t0 + CONV_TILE, iEnd);
+        std::fill(acc, acc + (t1 - t0), AccT(0));
+
+        for (dim_t wk = 0; wk < fLen2; ++wk) {
+            dim_t const kIdx = k - wk;
+            if (kIdx < 0 || kIdx >= sLen2) continue;
+
+            for (dim_t wj = 0; wj < fLen1; ++wj) {
+                dim_t const jIdx = j - wj;
+                if (jIdx < 0 || jIdx >= sLen1) continue;
+
+                conv_taps(acc, t0, t1,
+                          iptr + jIdx * sStrides[1] + kIdx * sStrides[2],
+                          sDims[0], sStrides[0],
+                          fptr + wj * fStrides[1] + wk * fStrides[2],
+                          fDims[0], fStrides[0]);
+            }
+        }
 
-    for(dim_t j=jStart; j<jEnd; ++j) {
-        dim_t joff = (j-jStart)*oStrides[1];
+        for (dim_t i = t0; i < t1; ++i) optr[i - iStart] = InT(acc[i - t0]);
+    }
+}
 
-        for(dim_t i=iStart; i<iEnd; ++i) {
+/// Splits a 2D filter into a column and a row filter when it is the outer
+/// product of the two, up to rounding of its type
+template<typename AccT>
+bool separate(std::vector<AccT> &col, std::vector<AccT> &row,
+              AccT const *fptr, af::dim4 const &fDims, af::dim4 const &fStrides,
+              std::true_type)
+{
+    dim_t const m = fDims[0];
+    dim_t const n = fDims[1];
+    auto at = [&](dim_t i, dim_t j) { return fptr[i * fStrides[0] + j * fStrides[1]]; };
+
+    // Two passes cost m + n per output against m * n for the full filter
+    if (m * n <= m + n) return false;
+
+    dim_t pi = 0, pj = 0;
+    AccT maxabs = 0;
+    for (dim_t j = 0; j < n; ++j) {
+        for (dim_t i = 0; i < m; ++i) {
+            AccT v = std::abs(at(i, j));
+            if (!(v <= maxabs)) { maxabs = v; pi = i; pj = j; }
+        }
+    }
+    if (!(maxabs > 0) || !std::isfinite(maxabs)) return false;
 
-            AccT accum = AccT(0);
-            for(dim_t wj=0; wj<fDims[1]; ++wj) {
-                dim_t jIdx  = j-wj;
-                dim_t w_joff = wj*fStrides[1];
-                dim_t s_joff = jIdx * sStrides[1];
-                bool isJValid = (jIdx>=0 && jIdx<sDims[1]);
+    col.resize(m);
+    row.resize(n);
+    for (dim_t i = 0; i < m; ++i) col[i] = at(i, pj);
+    for (dim_t j = 0; j < n; ++j) row[j] = at(pi, j) / at(pi, pj);
 
-                for(dim_t wi=0; wi<fDims[0]; ++wi) {
-                    dim_t iIdx = i-wi;
+    AccT const tol = 8 * std::numeric_limits<AccT>::epsilon() * maxabs;
+    for (dim_t j = 0; j < n; ++j) {
+        for (dim_t i = 0; i < m; ++i) {
+            if (!(std::abs(col[i] * row[j] - at(i, j)) <= tol)) return false;
+        }
+    }
+    return true;
+}
 
-                    InT s_val = InT(0);
-                    if ( isJValid && (iIdx>=0 && iIdx<sDims[0])) {
-                        s_val = iptr[s_joff+iIdx*sStrides[0]];
-                    }
+template<typename AccT>
+bool separate(std::vector<AccT> &, std::vector<AccT> &,
+              AccT const *, af::dim4 const &, af::dim4 const &, std::false_type)
+{
+    return false;
+}
 
-                    accum += AccT(s_val * fptr[w_joff+wi*fStrides[0]]);
-                }
-            }
-            optr[joff+i-iStart] = InT(accum);
-        }
+/// First pass of a separable convolution: column j of the signal convolved
+/// with cfilt, written to column j of the intermediate image
+template<typename InT, typename AccT, typename TmpT, bool Expand>
+void convolve2_col(TmpT *tptr, InT const *iptr, AccT const *cptr, dim_t cflen,
+                   dim_t j, af::dim4 const &sDims, af::dim4 const &sStrides,
+                   dim_t tStride1)
+{
+    dim_t const iStart = (Expand ? 0 : cflen/2);
+    dim_t const iEnd   = (Expand ? sDims[0] + cflen - 1 : iStart + sDims[0]);
+    AccT acc[CONV_TILE];
+
+    TmpT *tcol = tptr + j * tStride1;
+    for (dim_t t0 = iStart; t0 < iEnd; t0 += CONV_TILE) {
+        dim_t const t1 = std::min(t0 + CONV_TILE, iEnd);
+        std::fill(acc, acc + (t1 - t0), AccT(0));
+        conv_taps(acc, t0, t1, iptr + j * sStrides[1], sDims[0], sStrides[0],
+                  cptr, cflen, dim_t(1));
+        for (dim_t i = t0; i < t1; ++i) tcol[i - iStart] = TmpT(acc[i - t0]);
     }
 }
 
-template<typename InT, typename AccT, bool Expand>
-void one2one_3d(InT *optr, InT const * const iptr, AccT const * const fptr, af::dim4 const & oDims,
-                af::dim4 const & sDims, af::dim4 const & fDims, af::dim4 const & oStrides,
-                af::dim4 const & sStrides, af::dim4 const & fStrides)
+/// Second pass of a separable convolution: column oj of the output, the
+/// columns of the intermediate image convolved with rfilt
+template<typename InT, typename AccT, typename TmpT, bool Expand>
+void convolve2_row(InT *optr, TmpT const *tptr, AccT const *rptr, dim_t rflen,
+                   dim_t oj, dim_t tLen, af::dim4 const &sDims,
+                   af::dim4 const &oStrides, dim_t tStride1)
 {
-    dim_t kStart = (Expand ? 0 : fDims[2]/2);
-    dim_t kEnd   = (Expand ? oDims[2] : kStart + sDims[2]);
-    dim_t jStart = (Expand ? 0 : fDims[1]/2);
-    dim_t jEnd   = (Expand ? oDims[1] : jStart + sDims[1]);
-    dim_t iStart = (Expand ? 0 : fDims[0]/2);
-    dim_t iEnd   = (Expand ? oDims[0] : iStart + sDims[0]);
-
-    for(dim_t k=kStart; k<kEnd; ++k) {
-        dim_t koff = (k-kStart)*oStrides[2];
-
-        for(dim_t j=jStart; j<jEnd; ++j) {
-            dim_t joff = (j-jStart)*oStrides[1];
-
-            for(dim_t i=iStart; i<iEnd; ++i) {
-
-                AccT accum = AccT(0);
-                for(dim_t wk=0; wk<fDims[2]; ++wk) {
-                    dim_t kIdx  = k-wk;
-                    dim_t w_koff = wk*fStrides[2];
-                    dim_t s_koff = kIdx * sStrides[2];
-                    bool isKValid = (kIdx>=0 && kIdx<sDims[2]);
-
-                    for(dim_t wj=0; wj<fDims[1]; ++wj) {
-                        dim_t jIdx  = j-wj;
-                        dim_t w_joff = wj*fStrides[1];
-                        dim_t s_joff = jIdx * sStrides[1];
-                        bool isJValid = (jIdx>=0 && jIdx<sDims[1]);
-
-                        for(dim_t wi=0; wi<fDims[0]; ++wi) {
-                            dim_t iIdx = i-wi;
-
-                            InT s_val = InT(0);
-                            if ( isKValid && isJValid && (iIdx>=0 && iIdx<sDims[0])) {
-                                s_val = iptr[s_koff+s_joff+iIdx*sStrides[0]];
-                            }
-
-                            accum += AccT(s_val * fptr[w_koff+w_joff+wi*fStrides[0]]);
-                        }
-                    }
-                }
-                optr[koff+joff+i-iStart] = InT(accum);
-            } //i loop ends here
-        } // j loop ends here
-    } // k loop ends here
+    dim_t const j = oj + (Expand ? 0 : rflen/2);
+    AccT acc[CONV_TILE];
+
+    InT *ocol = optr + oj * oStrides[1];
+    for (dim_t t0 = 0; t0 < tLen; t0 += CONV_TILE) {
+        dim_t const t1 = std::min(t0 + CONV_TILE, tLen);
+        std::fill(acc, acc + (t1 - t0), AccT(0));
+        for (dim_t wj = 0; wj < rflen; ++wj) {
+            dim_t const jIdx = j - wj;
+            if (jIdx < 0 || jIdx >= sDims[1]) continue;
+            AccT const f = rptr[wj];
+            TmpT const *tcol = tptr + jIdx * tStride1;
+            for (dim_t i = t0; i < t1; ++i) acc[i - t0] += AccT(tcol[i] * f);
+        }
+        for (dim_t i = t0; i < t1; ++i) ocol[i] = InT(acc[i - t0]);
+    }
 }
 
 template<typename InT, typename AccT, dim_t baseDim, bool Expand>
@@ -164,62 +223,72 @@ void convolve_nd(Array<InT> out, Array<InT> const signal, Array<AccT> const filt
         }
     }
 
-    for (dim_t b3=0; b3<batch[3]; ++b3) {
-        for (dim_t b2=0; b2<batch[2]; ++b2) {
-            for (dim_t b1=0; b1<batch[1]; ++b1) {
-
-                InT * out          = optr + b1 * out_step[1] + b2 * out_step[2] + b3 * out_step[3];
-                InT const *in      = iptr + b1 *  in_step[1] + b2 *  in_step[2] + b3 *  in_step[3];
-                AccT const *filt = fptr + b1 *filt_step[1] + b2 *filt_step[2] + b3 *filt_step[3];
-
-                switch(baseDim) {
-                    case 1: one2one_1d<InT, AccT, Expand>(out, in, filt, oDims, sDims, fDims, sStrides);                     break;
-                    case 2: one2one_2d<InT, AccT, Expand>(out, in, filt, oDims, sDims, fDims, oStrides, sStrides, fStrides); break;
-                    case 3: one2one_3d<InT, AccT, Expand>(out, in, filt, oDims, sDims, fDims, oStrides, sStrides, fStrides); break;
-                }
+    dim_t const batches = batch[1] * batch[2] * batch[3];
+    auto batchOffset = [&](dim_t b, dim_t const *step) {
+        return (b % batch[1]) * step[1] + ((b / batch[1]) % batch[2]) * step[2] +
+               (b / (batch[1] * batch[2])) * step[3];
+    };
+
+    // A filter shared by every batch that is an outer product of two vectors
+    // runs as a column pass followed by a row pass
+    std::vector<AccT> cfilt, rfilt;
+    if (baseDim == 2 && kind != AF_BATCH_SAME && kind != AF_BATCH_RHS &&
+        separate(cfilt, rfilt, fptr, fDims, fStrides,
+                 std::is_floating_point<AccT>())) {
+        dim_t const tLen  = (Expand ? oDims[0] : sDims[0]);
+        dim_t const tSize = tLen * sDims[1];
+        std::vector<AccT> temp(tSize * batches);
+
+        // Both passes are split over the columns of every image, so single
+        // large images use the whole thread pool
+        dim_t const cwork = tLen * cfilt.size();
+        parallel_for(0, batches * sDims[1], (MIN_TASK_WORK + cwork - 1) / cwork,
+                     [&](dim_t lo, dim_t hi) {
+            for (dim_t l = lo; l < hi; ++l) {
+                dim_t const b = l / sDims[1];
+                convolve2_col<InT, AccT, AccT, Expand>(
+                    &temp[b * tSize], iptr + batchOffset(b, in_step),
+                    cfilt.data(), cfilt.size(), l % sDims[1], sDims, sStrides, tLen);
             }
-        }
+        });
+
+        dim_t const rwork = tLen * rfilt.size();
+        parallel_for(0, batches * oDims[1], (MIN_TASK_WORK + rwork - 1) / rwork,
+                     [&](dim_t lo, dim_t hi) {
+            for (dim_t l = lo; l < hi; ++l) {
+                dim_t const b = l / oDims[1];
+                convolve2_row<InT, AccT, AccT, Expand>(
+                    optr + batchOffset(b, out_step), &temp[b * tSize],
+                    rfilt.data(), rfilt.size(), l % oDims[1], tLen, sDims, oStrides, tLen);
+            }
+        });
+        return;
     }
-}
-
-template<typename InT, typename AccT, dim_t conv_dim, bool Expand>
-void convolve2_separable(InT *optr, InT const * const iptr, AccT const * const fptr,
-                        af::dim4 const & oDims, af::dim4 const & sDims, af::dim4 const & orgDims, dim_t fDim,
-                        af::dim4 const & oStrides, af::dim4 const & sStrides, dim_t fStride)
-{
-    for(dim_t j=0; j<oDims[1]; ++j) {
-
-        dim_t jOff = j*oStrides[1];
-        dim_t cj = j + (conv_dim==1)*(Expand ? 0: fDim>>1);
-
-        for(dim_t i=0; i<oDims[0]; ++i) {
-
-            dim_t iOff = i*oStrides[0];
-            dim_t ci = i + (conv_dim==0)*(Expand ? 0 : fDim>>1);
-
-            AccT accum = scalar<AccT>(0);
-
-            for(dim_t f=0; f<fDim; ++f) {
-                InT f_val = fptr[f];
-                InT s_val;
 
-                if (conv_dim==0) {
-                    dim_t offi = ci - f;
-                    bool isCIValid = offi>=0 && offi<sDims[0];
-                    bool isCJValid = cj>=0 && cj<sDims[1];
-                    s_val = (isCJValid && isCIValid ? iptr[cj*sDims[0]+offi] : scalar<InT>(0));
-                } else {
-                    dim_t offj = cj - f;
-                    bool isCIValid = ci>=0 && ci<sDims[0];
-                    bool isCJValid = offj>=0 && offj<sDims[1];
-                    s_val = (isCJValid && isCIValid ? iptr[offj*sDims[0]+ci] : scalar<InT>(0));
-                }
-
-                accum += AccT(s_val * f_val);
-            }
-            optr[iOff+jOff] = InT(accum);
+    // Every output line along dimension 0 is a task of its own, so single
+    // large images are spread over the thread pool as well
+    dim_t const lines1 = (baseDim > 1 ? oDims[1] : 1);
+    dim_t const lines2 = (baseDim > 2 ? oDims[2] : 1);
+    dim_t const lines  = lines1 * lines2;
+    dim_t const work = fDims.elements() * oDims[0];
+
+    parallel_for(0, batches * lines, (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
+        AccT acc[CONV_TILE];
+        for (dim_t l = lo; l < hi; ++l) {
+            dim_t const b  = l / lines;
+            dim_t const oj = l % lines1;
+            dim_t const ok = (l / lines1) % lines2;
+            dim_t const j  = oj + (Expand ? 0 : (baseDim > 1 ? fDims[1]/2 : 0));
+            dim_t const k  = ok + (Expand ? 0 : (baseDim > 2 ? fDims[2]/2 : 0));
+
+            InT *o = optr + batchOffset(b, out_step) + oj * (baseDim > 1 ? oStrides[1] : 0)
+                                                     + ok * (baseDim > 2 ? oStrides[2] : 0);
+            one2one_line<InT, AccT, baseDim, Expand>(
+                o, iptr + batchOffset(b, in_step), fptr + batchOffset(b, filt_step),
+                acc, j, k, sDims, fDims, sStrides, fStrides);
         }
-    }
+    });
 }
 
 template<typename InT, typename AccT, bool Expand>
@@ -239,27 +308,38 @@ void convolve2(Array<InT> out, Array<InT> const signal,
     auto sStrides = signal.strides();
     auto tStrides = temp.strides();
 
-    for (dim_t b3=0; b3<oDims[3]; ++b3) {
-
-        dim_t i_b3Off = b3*sStrides[3];
-        dim_t t_b3Off = b3*tStrides[3];
-        dim_t o_b3Off = b3*oStrides[3];
-
-        for (dim_t b2=0; b2<oDims[2]; ++b2) {
-
-            InT const * const iptr = signal.get()+ b2*sStrides[2] + i_b3Off;
-            InT *tptr = temp.get() + b2*tStrides[2] + t_b3Off;
-            InT *optr = out.get()  + b2*oStrides[2] + o_b3Off;
-
-            convolve2_separable<InT, AccT, 0, Expand>(tptr, iptr, c_filter.get(),
-                    tDims, sDims, sDims, cflen,
-                    tStrides, sStrides, c_filter.strides()[0]);
-
-            convolve2_separable<InT, AccT, 1, Expand>(optr, tptr, r_filter.get(),
-                    oDims, tDims, sDims, rflen,
-                    oStrides, tStrides, r_filter.strides()[0]);
+    // The filter taps are applied in the signal type
+    std::vector<AccT> cfilt(cflen), rfilt(rflen);
+    for (dim_t f = 0; f < cflen; ++f) cfilt[f] = AccT(InT(c_filter.get()[f]));
+    for (dim_t f = 0; f < rflen; ++f) rfilt[f] = AccT(InT(r_filter.get()[f]));
+
+    // Both passes are split over the columns of every image
+    dim_t const images = oDims[2] * oDims[3];
+    auto offset = [](dim_t b, af::dim4 const &dims, af::dim4 const &strides) {
+        return (b % dims[2]) * strides[2] + (b / dims[2]) * strides[3];
+    };
+
+    dim_t const cwork = tDims[0] * cflen;
+    parallel_for(0, images * sDims[1], (MIN_TASK_WORK + cwork - 1) / cwork,
+                 [&](dim_t lo, dim_t hi) {
+        for (dim_t l = lo; l < hi; ++l) {
+            dim_t const b = l / sDims[1];
+            convolve2_col<InT, AccT, InT, Expand>(
+                temp.get() + offset(b, oDims, tStrides), signal.get() + offset(b, oDims, sStrides),
+                cfilt.data(), cflen, l % sDims[1], sDims, sStrides, tStrides[1]);
         }
-    }
+    });
+
+    dim_t const rwork = tDims[0] * rflen;
+    parallel_for(0, images * oDims[1], (MIN_TASK_WORK + rwork - 1) / rwork,
+                 [&](dim_t lo, dim_t hi) {
+        for (dim_t l = lo; l < hi; ++l) {
+            dim_t const b = l / oDims[1];
+            convolve2_row<InT, AccT, InT, Expand>(
+                out.get() + offset(b, oDims, oStrides), temp.get() + offset(b, oDims, tStrides),
+                rfilt.data(), rflen, l % oDims[1], tDims[0], sDims, oStrides, tStrides[1]);
+        }
+    });
 }
 
 }
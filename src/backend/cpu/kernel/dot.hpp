@@ -9,36 +9,227 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
 #include <complex>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
+/// Number of independent partial sums kept by a dot product. They break the
+/// dependency between consecutive additions and let the compiler vectorize.
+static const int DOT_LANES = 8;
+
+/// Long dot products are split in chunks of this many elements. The chunks
+/// do not depend on the number of threads, so neither does the result.
+static const dim_t DOT_CHUNK = 1 << 15;
+
+/// Rows accumulated together by a dot product along dims 1, 2 or 3
+static const dim_t DOT_TILE = 1024;
+
 template<typename T> T
 conj(T  x) { return x; }
 
-template<> cfloat  conj<cfloat> (cfloat  c) { return std::conj(c); }
-template<> cdouble conj<cdouble>(cdouble c) { return std::conj(c); }
+template<> inline cfloat  conj<cfloat> (cfloat  c) { return std::conj(c); }
+template<> inline cdouble conj<cdouble>(cdouble c) { return std::conj(c); }
 
-template<typename T, bool conjugate, bool both_conjugate>
-void dot(Array<T> output, const Array<T> lhs, const Array<T> rhs,
-         af_mat_prop optLhs, af_mat_prop optRhs)
+/// conj(a) * b or a * b. The complex product is written out to avoid the
+/// library call made by std::complex to handle infinities.
+template<typename T, bool conjugate>
+struct dot_prod
 {
-    int N = lhs.dims()[0];
+    static T run(const T a, const T b) { return a * b; }
+};
 
-    T out = 0;
-    const T *pL = lhs.get();
-    const T *pR = rhs.get();
+template<typename T, bool conjugate>
+struct dot_prod<std::complex<T>, conjugate>
+{
+    static std::complex<T> run(const std::complex<T> a, const std::complex<T> b)
+    {
+        const T ai = conjugate ? -a.imag() : a.imag();
+        return std::complex<T>(a.real() * b.real() - ai * b.imag(),
+                               a.real() * b.imag() + ai * b.real());
+    }
+};
 
-    for(int i = 0; i < N; i++)
-        out += (conjugate ? kernel::conj(pL[i]) : pL[i]) * pR[i];
+/// Running sum, optionally Kahan compensated
+template<typename T, bool compensated>
+struct dot_accum
+{
+    T s;
+    dot_accum() : s(0) {}
+    void add(const T v) { s += v; }
+    void add(const dot_accum &o) { s += o.s; }
+    T value() const { return s; }
+};
 
-    if(both_conjugate) out = kernel::conj(out);
+template<typename T>
+struct dot_accum<T, true>
+{
+    T s, c;
+    dot_accum() : s(0), c(0) {}
+    void add(const T v)
+    {
+        const T y = v - c;
+        const T t = s + y;
+        c = (t - s) - y;
+        s = t;
+    }
+    void add(const dot_accum &o) { add(o.value()); }
+    T value() const { return s - c; }
+};
 
-    *output.get() = out;
+/// Dot product of n elements read with strides ls and rs
+template<typename T, bool conjugate, bool compensated>
+T dot_range(const T *l, const dim_t ls, const T *r, const dim_t rs, const dim_t n)
+{
+    typedef dot_prod<T, conjugate> prod;
+    dot_accum<T, compensated> acc[DOT_LANES];
+
+    const dim_t nv = n - n % DOT_LANES;
+    if (ls == 1 && rs == 1) {
+        for (dim_t i = 0; i < nv; i += DOT_LANES) {
+            for (int k = 0; k < DOT_LANES; ++k)
+                acc[k].add(prod::run(l[i + k], r[i + k]));
+        }
+    } else {
+        for (dim_t i = 0; i < nv; i += DOT_LANES) {
+            for (int k = 0; k < DOT_LANES; ++k)
+                acc[k].add(prod::run(l[(i + k) * ls], r[(i + k) * rs]));
+        }
+    }
+    for (dim_t i = nv; i < n; ++i) acc[i - nv].add(prod::run(l[i * ls], r[i * rs]));
+
+    for (int w = DOT_LANES / 2; w > 0; w /= 2)
+        for (int k = 0; k < w; ++k) acc[k].add(acc[k + w]);
+    return acc[0].value();
+}
+
+/// Dot product of a single long vector, one chunk per task
+template<typename T, bool conjugate, bool compensated>
+T dot_chunked(const T *l, const dim_t ls, const T *r, const dim_t rs, const dim_t n)
+{
+    if (n <= DOT_CHUNK) return dot_range<T, conjugate, compensated>(l, ls, r, rs, n);
+
+    const dim_t chunks = (n + DOT_CHUNK - 1) / DOT_CHUNK;
+    std::vector<T> partial(chunks);
+    parallel_for(0, chunks, 1, [&](dim_t lo, dim_t hi) {
+        for (dim_t c = lo; c < hi; ++c) {
+            const dim_t b = c * DOT_CHUNK;
+            partial[c] = dot_range<T, conjugate, compensated>(l + b * ls, ls, r + b * rs, rs,
+                                                              std::min(DOT_CHUNK, n - b));
+        }
+    });
+
+    dot_accum<T, compensated> acc;
+    for (dim_t c = 0; c < chunks; ++c) acc.add(partial[c]);
+    return acc.value();
+}
+
+/// Dot products of lhs and rhs along dim, in a single pass over both inputs.
+/// Along dim 0 every column is a separate dot product, along the other
+/// dimensions tiles of rows are accumulated together so memory is read in
+/// order.
+template<typename T, bool conjugate, bool compensated>
+void dot_dim(Array<T> output, const Array<T> lhs, const Array<T> rhs, const int dim)
+{
+    const af::dim4 dims     = lhs.dims();
+    const af::dim4 lstrides = lhs.strides();
+    const af::dim4 rstrides = rhs.strides();
+    const af::dim4 ostrides = output.strides();
+
+    const T *lptr = lhs.get();
+    const T *rptr = rhs.get();
+    T       *optr = output.get();
+
+    const dim_t len = dims[dim];
+    const dim_t ls  = lstrides[dim];
+    const dim_t rs  = rstrides[dim];
+
+    if (dim == 0) {
+        const dim_t cols = dims[1] * dims[2] * dims[3];
+        if (cols == 1) {
+            *optr = dot_chunked<T, conjugate, compensated>(lptr, ls, rptr, rs, len);
+            return;
+        }
+
+        parallel_for(0, cols, (MIN_TASK_WORK + len - 1) / std::max<dim_t>(len, 1),
+                     [&](dim_t b, dim_t e) {
+            for (dim_t c = b; c < e; ++c) {
+                const dim_t c0 = c % dims[1];
+                const dim_t c1 = (c / dims[1]) % dims[2];
+                const dim_t c2 = c / (dims[1] * dims[2]);
+                optr[c0 * ostrides[1] + c1 * ostrides[2] + c2 * ostrides[3]] =
+                    dot_range<T, conjugate, compensated>(
+                        lptr + c0 * lstrides[1] + c1 * lstrides[2] + c2 * lstrides[3], ls,
+                        rptr + c0 * rstrides[1] + c1 * rstrides[2] + c2 * rstrides[3], rs, len);
+            }
+        });
+        return;
+    }
+
+    // The dimensions other than dim and 0 enumerate the outer columns
+    dim_t od[2] = {1, 1}, lo_s[2] = {0, 0}, ro_s[2] = {0, 0}, oo_s[2] = {0, 0};
+    for (int d = 1, k = 0; d < 4; ++d) {
+        if (d == dim) continue;
+        od[k]   = dims[d];
+        lo_s[k] = lstrides[d];
+        ro_s[k] = rstrides[d];
+        oo_s[k] = ostrides[d];
+        ++k;
+    }
+
+    typedef dot_prod<T, conjugate> prod;
+    const dim_t rows  = dims[0];
+    const dim_t l0    = lstrides[0];
+    const dim_t r0    = rstrides[0];
+    const dim_t o0    = ostrides[0];
+    const dim_t tiles = (rows + DOT_TILE - 1) / DOT_TILE;
+    const dim_t outer = od[0] * od[1];
+    const dim_t work  = std::min(rows, DOT_TILE) * len;
+
+    parallel_for(0, outer * tiles, (MIN_TASK_WORK + work - 1) / std::max<dim_t>(work, 1),
+                 [&](dim_t b, dim_t e) {
+        std::vector<dot_accum<T, compensated> > acc(std::min(rows, DOT_TILE));
+        for (dim_t t = b; t < e; ++t) {
+            const dim_t o  = t / tiles;
+            const dim_t r  = (t % tiles) * DOT_TILE;
+            const dim_t nr = std::min(DOT_TILE, rows - r);
+            const dim_t c0 = o % od[0];
+            const dim_t c1 = o / od[0];
+
+            const T *lp = lptr + c0 * lo_s[0] + c1 * lo_s[1] + r * l0;
+            const T *rp = rptr + c0 * ro_s[0] + c1 * ro_s[1] + r * r0;
+            T       *op = optr + c0 * oo_s[0] + c1 * oo_s[1] + r * o0;
+
+            std::fill(acc.begin(), acc.begin() + nr, dot_accum<T, compensated>());
+            for (dim_t k = 0; k < len; ++k) {
+                const T *lk = lp + k * ls;
+                const T *rk = rp + k * rs;
+                for (dim_t i = 0; i < nr; ++i) acc[i].add(prod::run(lk[i * l0], rk[i * r0]));
+            }
+            for (dim_t i = 0; i < nr; ++i) op[i * o0] = acc[i].value();
+        }
+    });
+}
+
+template<typename T, bool conjugate, bool both_conjugate>
+void dot(Array<T> output, const Array<T> lhs, const Array<T> rhs,
+         const int dim, const bool compensated)
+{
+    if (compensated)
+        dot_dim<T, conjugate, true >(output, lhs, rhs, dim);
+    else
+        dot_dim<T, conjugate, false>(output, lhs, rhs, dim);
 
+    if (both_conjugate) {
+        T *optr = output.get();
+        const dim_t n = output.elements();
+        for (dim_t i = 0; i < n; ++i) optr[i] = kernel::conj(optr[i]);
+    }
 }
 
 }
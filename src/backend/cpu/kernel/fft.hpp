@@ -9,7 +9,16 @@
 
 #pragma once
 #include <Array.hpp>
+#include <err_common.hpp>
+#include <util.hpp>
 #include <fftw3.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 namespace cpu
 {
@@ -24,6 +33,170 @@ void computeDims(int rdims[rank], const af::dim4 &idims)
     }
 }
 
+// Number of elements spanned by an array with the given dims and strides
+static inline size_t extent(const af::dim4 &dims, const af::dim4 &strides)
+{
+    size_t n = 1;
+    for (int i = 0; i < 4; i++) {
+        n += (dims[i] - 1) * strides[i];
+    }
+    return n;
+}
+
+template<typename plan_t>
+struct fftw_api;
+
+#define FFTW_API(PRE, TR, SUFFIX)                                       \
+    template<>                                                          \
+    struct fftw_api<PRE##_plan>                                         \
+    {                                                                   \
+        static const char *suffix() { return SUFFIX; }                  \
+        static void destroy(PRE##_plan plan)                            \
+        { PRE##_destroy_plan(plan); }                                   \
+        static int alignment(void *ptr)                                 \
+        { return PRE##_alignment_of((TR *)ptr); }                       \
+        static int importWisdom(const char *file)                       \
+        { return PRE##_import_wisdom_from_filename(file); }             \
+        static int exportWisdom(const char *file)                       \
+        { return PRE##_export_wisdom_to_filename(file); }               \
+    };                                                                  \
+
+FFTW_API(fftwf, float , ".f32")
+FFTW_API(fftw , double, ".f64")
+
+// FFTW's planner is not thread safe. All plan creation and destruction,
+// for both precisions, happens under this lock.
+inline std::recursive_mutex &getPlannerMutex()
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+// Prefix of the files used to persist FFTW wisdom. When set, plans are
+// created with FFTW_MEASURE and the resulting wisdom is saved so that later
+// runs do not pay for the measurement again.
+inline const std::string &getWisdomFile()
+{
+    static const std::string file = getEnvVar("AF_FFTW_WISDOM");
+    return file;
+}
+
+// FFTWPlanner caches fftw plans in least recently used order
+//
+// new plan |--> IF number of plans cached is at limit, drop the least recently used plan
+//          |
+//          |--> push the plan to the front
+// existing plan -> move to the front and reuse
+//
+// Plans are executed with FFTW's new-array interface, so one plan serves
+// every buffer with the same layout and alignment.
+template<typename plan_t>
+class FFTWPlanner
+{
+    public:
+        typedef std::shared_ptr<typename std::remove_pointer<plan_t>::type> plan_ptr;
+
+        static FFTWPlanner& getInstance() {
+            static FFTWPlanner instance;
+            return instance;
+        }
+
+        void setMaxCacheSize(size_t size) {
+            std::lock_guard<std::recursive_mutex> lock(getPlannerMutex());
+            mMaxCacheSize = size;
+            while (mCache.size() > mMaxCacheSize) mCache.pop_back();
+        }
+
+        unsigned flags() const {
+            return getWisdomFile().empty() ? FFTW_ESTIMATE : FFTW_MEASURE;
+        }
+
+        // create(flags) is only called when no plan matches key
+        template<typename F>
+        plan_ptr getPlan(const std::string &key, F create) {
+            std::lock_guard<std::recursive_mutex> lock(getPlannerMutex());
+
+            for (auto it = mCache.begin(); it != mCache.end(); ++it) {
+                if (it->first == key) {
+                    mCache.splice(mCache.begin(), mCache, it);
+                    return it->second;
+                }
+            }
+
+            const std::string &wisdom = getWisdomFile();
+            if (!wisdom.empty() && !mWisdomLoaded) {
+                fftw_api<plan_t>::importWisdom((wisdom + fftw_api<plan_t>::suffix()).c_str());
+                mWisdomLoaded = true;
+            }
+
+            plan_t plan = create(flags());
+            if (plan == NULL) {
+                AF_ERROR("Failed to create FFTW plan", AF_ERR_INTERNAL);
+            }
+
+            // The plan may outlive its cache entry while it is being executed
+            plan_ptr ptr(plan, [](plan_t p) {
+                std::lock_guard<std::recursive_mutex> lock(getPlannerMutex());
+                fftw_api<plan_t>::destroy(p);
+            });
+
+            if (!wisdom.empty()) {
+                fftw_api<plan_t>::exportWisdom((wisdom + fftw_api<plan_t>::suffix()).c_str());
+            }
+
+            if (mMaxCacheSize > 0) {
+                if (mCache.size() >= mMaxCacheSize) mCache.pop_back();
+                mCache.push_front(std::make_pair(key, ptr));
+            }
+            return ptr;
+        }
+
+    private:
+        FFTWPlanner() : mMaxCacheSize(5), mWisdomLoaded(false) {
+            // Construct the mutex first so that it outlives the cached plans
+            getPlannerMutex();
+        }
+        FFTWPlanner(FFTWPlanner const&);
+        void operator=(FFTWPlanner const&);
+
+        size_t mMaxCacheSize;
+        bool mWisdomLoaded;
+        std::list<std::pair<std::string, plan_ptr> > mCache;
+};
+
+// Measured plans overwrite their buffers, so they are created on scratch
+// memory instead of the user's data
+class fftw_scratch
+{
+    public:
+        fftw_scratch(size_t bytes) : ptr(bytes ? fftw_malloc(bytes) : NULL) {}
+        ~fftw_scratch() { if (ptr) fftw_free(ptr); }
+        void *get() { return ptr; }
+
+    private:
+        fftw_scratch(fftw_scratch const&);
+        void operator=(fftw_scratch const&);
+        void *ptr;
+};
+
+template<typename plan_t, int rank>
+std::string planKey(char type, int sign, const int *t_dims, int batch,
+                    const int *in_embed, const af::dim4 &istrides, void *in,
+                    const int *out_embed, const af::dim4 &ostrides, void *out)
+{
+    std::ostringstream key;
+    key << type << sign << ":" << rank << ":" << batch << ":";
+    for (int r = 0; r < rank; r++) {
+        key << t_dims[r] << ":" << in_embed[r] << ":" << out_embed[r] << ":";
+    }
+    key << istrides[0] << ":" << istrides[rank] << ":"
+        << ostrides[0] << ":" << ostrides[rank] << ":"
+        << (in == out) << ":"
+        << fftw_api<plan_t>::alignment(in) << ":"
+        << fftw_api<plan_t>::alignment(out);
+    return key.str();
+}
+
 template<typename T>
 struct fftw_transform;
 
@@ -37,8 +210,9 @@ struct fftw_transform;
         template<typename... Args>                                      \
             plan_t create(Args... args)                                 \
         { return PRE##_plan_many_dft(args...); }                        \
-        void execute(plan_t plan) { return PRE##_execute(plan); }       \
-        void destroy(plan_t plan) { return PRE##_destroy_plan(plan); }  \
+        template<typename... Args>                                      \
+            void execute(plan_t plan, Args... args)                     \
+        { return PRE##_execute_dft(plan, args...); }                    \
     };                                                                  \
 
 
@@ -58,8 +232,9 @@ struct fftw_real_transform;
         template<typename... Args>                                      \
             plan_t create(Args... args)                                 \
         { return PRE##_plan_many_dft_##POST(args...); }                 \
-        void execute(plan_t plan) { return PRE##_execute(plan); }       \
-        void destroy(plan_t plan) { return PRE##_destroy_plan(plan); }  \
+        template<typename... Args>                                      \
+            void execute(plan_t plan, Args... args)                     \
+        { return PRE##_execute_dft_##POST(plan, args...); }             \
     };                                                                  \
 
 
@@ -83,7 +258,7 @@ void fft_inplace(Array<T> in)
     const af::dim4 istrides = in.strides();
 
     typedef typename fftw_transform<T>::ctype_t ctype_t;
-    typename fftw_transform<T>::plan_t plan;
+    typedef typename fftw_transform<T>::plan_t plan_t;
 
     fftw_transform<T> transform;
 
@@ -92,20 +267,33 @@ void fft_inplace(Array<T> in)
         batch *= idims[i];
     }
 
-    plan = transform.create(rank,
-                            t_dims,
-                            (int)batch,
-                            (ctype_t *)in.get(),
-                            in_embed, (int)istrides[0],
-                            (int)istrides[rank],
-                            (ctype_t *)in.get(),
-                            in_embed, (int)istrides[0],
-                            (int)istrides[rank],
-                            direction ? FFTW_FORWARD : FFTW_BACKWARD,
-                            FFTW_ESTIMATE);
-
-    transform.execute(plan);
-    transform.destroy(plan);
+    const int sign = direction ? FFTW_FORWARD : FFTW_BACKWARD;
+    ctype_t *data = (ctype_t *)in.get();
+
+    std::string key = planKey<plan_t, rank>('c', sign, t_dims, batch,
+                                            in_embed, istrides, data,
+                                            in_embed, istrides, data);
+
+    auto plan = FFTWPlanner<plan_t>::getInstance().getPlan(key, [&](unsigned flags) {
+        bool measure = flags != FFTW_ESTIMATE;
+        fftw_scratch scratch(measure ? extent(idims, istrides) * sizeof(T) : 0);
+        ctype_t *buf = measure ? (ctype_t *)scratch.get() : data;
+        if (measure && fftw_api<plan_t>::alignment(data) != 0) flags |= FFTW_UNALIGNED;
+
+        return transform.create(rank,
+                                t_dims,
+                                (int)batch,
+                                buf,
+                                in_embed, (int)istrides[0],
+                                (int)istrides[rank],
+                                buf,
+                                in_embed, (int)istrides[0],
+                                (int)istrides[rank],
+                                sign,
+                                flags);
+    });
+
+    transform.execute(plan.get(), data, data);
 }
 
 template<typename Tc, typename Tr, int rank>
@@ -125,7 +313,7 @@ void fft_r2c(Array<Tc> out, const Array<Tr> in)
     const af::dim4 ostrides = out.strides();
 
     typedef typename fftw_real_transform<Tc, Tr>::ctype_t ctype_t;
-    typename fftw_real_transform<Tc, Tr>::plan_t plan;
+    typedef typename fftw_real_transform<Tc, Tr>::plan_t plan_t;
 
     fftw_real_transform<Tc, Tr> transform;
 
@@ -134,19 +322,37 @@ void fft_r2c(Array<Tc> out, const Array<Tr> in)
         batch *= idims[i];
     }
 
-    plan = transform.create(rank,
-                            t_dims,
-                            (int)batch,
-                            (Tr *)in.get(),
-                            in_embed, (int)istrides[0],
-                            (int)istrides[rank],
-                            (ctype_t *)out.get(),
-                            out_embed, (int)ostrides[0],
-                            (int)ostrides[rank],
-                            FFTW_ESTIMATE);
-
-    transform.execute(plan);
-    transform.destroy(plan);
+    Tr *in_ptr = (Tr *)in.get();
+    ctype_t *out_ptr = (ctype_t *)out.get();
+
+    std::string key = planKey<plan_t, rank>('r', 0, t_dims, batch,
+                                            in_embed, istrides, in_ptr,
+                                            out_embed, ostrides, out_ptr);
+
+    auto plan = FFTWPlanner<plan_t>::getInstance().getPlan(key, [&](unsigned flags) {
+        bool measure = flags != FFTW_ESTIMATE;
+        fftw_scratch iscratch(measure ? extent(idims, istrides) * sizeof(Tr) : 0);
+        fftw_scratch oscratch(measure ? extent(out.dims(), ostrides) * sizeof(Tc) : 0);
+        Tr *ibuf = measure ? (Tr *)iscratch.get() : in_ptr;
+        ctype_t *obuf = measure ? (ctype_t *)oscratch.get() : out_ptr;
+        if (measure && (fftw_api<plan_t>::alignment(in_ptr) != 0 ||
+                        fftw_api<plan_t>::alignment(out_ptr) != 0)) {
+            flags |= FFTW_UNALIGNED;
+        }
+
+        return transform.create(rank,
+                                t_dims,
+                                (int)batch,
+                                ibuf,
+                                in_embed, (int)istrides[0],
+                                (int)istrides[rank],
+                                obuf,
+                                out_embed, (int)ostrides[0],
+                                (int)ostrides[rank],
+                                flags);
+    });
+
+    transform.execute(plan.get(), in_ptr, out_ptr);
 }
 
 template<typename Tr, typename Tc, int rank>
@@ -164,7 +370,7 @@ void fft_c2r(Array<Tr> out, const Array<Tc> in, const af::dim4 odims)
     const af::dim4 ostrides = out.strides();
 
     typedef typename fftw_real_transform<Tr, Tc>::ctype_t ctype_t;
-    typename fftw_real_transform<Tr, Tc>::plan_t plan;
+    typedef typename fftw_real_transform<Tr, Tc>::plan_t plan_t;
 
     fftw_real_transform<Tr, Tc> transform;
 
@@ -173,19 +379,37 @@ void fft_c2r(Array<Tr> out, const Array<Tc> in, const af::dim4 odims)
         batch *= odims[i];
     }
 
-    plan = transform.create(rank,
-                            t_dims,
-                            (int)batch,
-                            (ctype_t *)in.get(),
-                            in_embed, (int)istrides[0],
-                            (int)istrides[rank],
-                            (Tr *)out.get(),
-                            out_embed, (int)ostrides[0],
-                            (int)ostrides[rank],
-                            FFTW_ESTIMATE);
-
-    transform.execute(plan);
-    transform.destroy(plan);
+    ctype_t *in_ptr = (ctype_t *)in.get();
+    Tr *out_ptr = (Tr *)out.get();
+
+    std::string key = planKey<plan_t, rank>('i', 0, t_dims, batch,
+                                            in_embed, istrides, in_ptr,
+                                            out_embed, ostrides, out_ptr);
+
+    auto plan = FFTWPlanner<plan_t>::getInstance().getPlan(key, [&](unsigned flags) {
+        bool measure = flags != FFTW_ESTIMATE;
+        fftw_scratch iscratch(measure ? extent(in.dims(), istrides) * sizeof(Tc) : 0);
+        fftw_scratch oscratch(measure ? extent(odims, ostrides) * sizeof(Tr) : 0);
+        ctype_t *ibuf = measure ? (ctype_t *)iscratch.get() : in_ptr;
+        Tr *obuf = measure ? (Tr *)oscratch.get() : out_ptr;
+        if (measure && (fftw_api<plan_t>::alignment(in_ptr) != 0 ||
+                        fftw_api<plan_t>::alignment(out_ptr) != 0)) {
+            flags |= FFTW_UNALIGNED;
+        }
+
+        return transform.create(rank,
+                                t_dims,
+                                (int)batch,
+                                ibuf,
+                                in_embed, (int)istrides[0],
+                                (int)istrides[rank],
+                                obuf,
+                                out_embed, (int)ostrides[0],
+                                (int)ostrides[rank],
+                                flags);
+    });
+
+    transform.execute(plan.get(), in_ptr, out_ptr);
 }
 
 }
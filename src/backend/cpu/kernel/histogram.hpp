@@ -9,40 +9,195 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
-template<typename OutT, typename InT, bool IsLinear>
-void histogram(Array<OutT> out, Array<InT> const in,
-               unsigned const nbins, double const minval, double const maxval)
+/// Inputs with at most this many distinct values are binned via a table
+static const dim_t HIST_LUT_MAX = 1 << 16;
+
+/// Maps values to bins exactly like (int)((v - minval) / step) followed by
+/// clamping to [0, nbins - 1], but with a multiply by the reciprocal of
+/// step. The bin lower edges are found once so that the rounding of the
+/// reciprocal can be corrected with a single compare.
+class BinEdges
+{
+    std::vector<double> edges;
+    double minval;
+    double scale;
+    double step;
+    int last;
+    bool exact;
+
+    public:
+    BinEdges(unsigned nbins, double minval, double maxval)
+        : edges(nbins + 1), minval(minval), last((int)nbins - 1)
+    {
+        step  = (float)((maxval - minval) / (float)nbins);
+        scale = (1.0 / step) * (1 - 8 * std::numeric_limits<double>::epsilon());
+        exact = !(step > 0) || !std::isfinite(scale);
+        if (exact) return;
+
+        // edges[k] is the smallest x with x / step >= k
+        edges[0]     = -std::numeric_limits<double>::infinity();
+        edges[nbins] =  std::numeric_limits<double>::infinity();
+        for (unsigned k = 1; k < nbins; k++) {
+            double x = k * step;
+            while (x / step >= k) x = std::nextafter(x, -edges[nbins]);
+            while (x / step <  k) x = std::nextafter(x,  edges[nbins]);
+            edges[k] = x;
+        }
+    }
+
+    int operator()(double v) const
+    {
+        double x = v - minval;
+        if (exact) {
+            int bin = (int)(x / step);
+            return std::min(std::max(bin, 0), last);
+        }
+
+        // scale is rounded down, so the guess is the bin or the one before
+        int bin = (int)(x * scale);
+        bin = std::min(std::max(bin, 0), last);
+        bin += x >= edges[bin + 1];
+        return bin;
+    }
+};
+
+/// Table of the bin of every value of a narrow integer type
+template<typename InT>
+class BinTable
+{
+    std::vector<unsigned> table;
+
+    public:
+    BinTable(BinEdges const &edges)
+        : table((size_t)1 << (8 * sizeof(InT)))
+    {
+        for (size_t i = 0; i < table.size(); i++) {
+            InT v = (InT)(i + std::numeric_limits<InT>::min());
+            table[i] = edges((double)v);
+        }
+    }
+
+    unsigned operator()(InT v) const
+    {
+        return table[(size_t)(v - std::numeric_limits<InT>::min())];
+    }
+};
+
+template<typename OutT, typename InT, bool IsLinear, typename Binner>
+void histRange(OutT *outData, InT const *inData, Binner const &binner,
+               dim_t lo, dim_t hi, dim_t d0, dim_t stride1)
+{
+    if (IsLinear) {
+        for (dim_t i = lo; i < hi; i++) outData[binner(inData[i])]++;
+        return;
+    }
+
+    // Walk columns instead of dividing every index
+    dim_t col = lo / d0;
+    dim_t row = lo - col * d0;
+    for (dim_t i = lo; i < hi; col++, row = 0) {
+        InT const *colData = inData + col * stride1;
+        dim_t rows = std::min(d0 - row, hi - i);
+        for (dim_t r = row; r < row + rows; r++) outData[binner(colData[r])]++;
+        i += rows;
+    }
+}
+
+template<typename OutT, typename InT, bool IsLinear, typename Binner>
+void histogramBinned(Array<OutT> out, Array<InT> const in,
+                     unsigned const nbins, Binner const &binner)
 {
     dim4 const outDims   = out.dims();
-    float const step     = (maxval - minval)/(float)nbins;
     dim4 const inDims    = in.dims();
     dim4 const iStrides  = in.strides();
     dim4 const oStrides  = out.strides();
     dim_t const nElems   = inDims[0]*inDims[1];
+    dim_t const nImages  = outDims[2]*outDims[3];
+    dim_t const threads  = getThreadPool().size();
+    dim_t const parts    = std::min(threads, nElems / MIN_TASK_WORK);
+
+    if (nImages >= threads || parts <= 1) {
+        parallel_for_batch(af::dim4(1, 1, outDims[2], outDims[3]), nElems,
+                           [&](dim_t b1, dim_t b2, dim_t b3) {
+            histRange<OutT, InT, IsLinear>(
+                out.get() + b2 * oStrides[2] + b3 * oStrides[3],
+                in.get()  + b2 * iStrides[2] + b3 * iStrides[3],
+                binner, 0, nElems, inDims[0], iStrides[1]);
+        });
+        return;
+    }
+
+    // Few large images: every task counts a slice of an image into its own
+    // bins, which are added up afterwards so that no counter is shared
+    std::vector<OutT> priv(parts * nbins);
+    dim_t const chunk = (nElems + parts - 1) / parts;
 
-    OutT *outData    = out.get();
-    const InT* inData= in.get();
-
-    for(dim_t b3 = 0; b3 < outDims[3]; b3++) {
-        for(dim_t b2 = 0; b2 < outDims[2]; b2++) {
-            for(dim_t i=0; i<nElems; i++) {
-                int idx = IsLinear ? i : ((i % inDims[0]) + (i / inDims[0])*iStrides[1]);
-                int bin = (int)((inData[idx] - minval) / step);
-                bin = std::max(bin, 0);
-                bin = std::min(bin, (int)(nbins - 1));
-                outData[bin]++;
+    for (dim_t b3 = 0; b3 < outDims[3]; b3++) {
+        for (dim_t b2 = 0; b2 < outDims[2]; b2++) {
+            OutT *outData     = out.get() + b2 * oStrides[2] + b3 * oStrides[3];
+            InT const *inData = in.get()  + b2 * iStrides[2] + b3 * iStrides[3];
+
+            std::fill(priv.begin(), priv.end(), OutT(0));
+            parallel_for(0, parts, 1, [&](dim_t lo, dim_t hi) {
+                for (dim_t p = lo; p < hi; p++) {
+                    histRange<OutT, InT, IsLinear>(
+                        &priv[p * nbins], inData, binner,
+                        p * chunk, std::min(nElems, (p + 1) * chunk),
+                        inDims[0], iStrides[1]);
+                }
+            });
+
+            for (dim_t p = 0; p < parts; p++) {
+                OutT const *part = &priv[p * nbins];
+                for (unsigned k = 0; k < nbins; k++) outData[k] += part[k];
             }
-            inData  += iStrides[2];
-            outData += oStrides[2];
         }
     }
 }
 
+template<typename OutT, typename InT, bool IsLinear>
+void histogramNarrow(Array<OutT> out, Array<InT> const in, unsigned const nbins,
+                     BinEdges const &edges, std::true_type)
+{
+    // A table pays off once it is cheaper to fill than the data to bin
+    if (sizeof(InT) == 1 || in.elements() >= HIST_LUT_MAX) {
+        histogramBinned<OutT, InT, IsLinear>(out, in, nbins,
+                                             BinTable<InT>(edges));
+    } else {
+        histogramBinned<OutT, InT, IsLinear>(out, in, nbins, edges);
+    }
+}
+
+template<typename OutT, typename InT, bool IsLinear>
+void histogramNarrow(Array<OutT> out, Array<InT> const in, unsigned const nbins,
+                     BinEdges const &edges, std::false_type)
+{
+    histogramBinned<OutT, InT, IsLinear>(out, in, nbins, edges);
+}
+
+template<typename OutT, typename InT, bool IsLinear>
+void histogram(Array<OutT> out, Array<InT> const in,
+               unsigned const nbins, double const minval, double const maxval)
+{
+    typedef std::integral_constant<bool, std::is_integral<InT>::value &&
+                                         sizeof(InT) <= 2> IsNarrow;
+
+    histogramNarrow<OutT, InT, IsLinear>(out, in, nbins,
+                                         BinEdges(nbins, minval, maxval),
+                                         IsNarrow());
+}
+
 }
 }
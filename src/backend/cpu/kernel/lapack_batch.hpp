@@ -0,0 +1,267 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace cpu
+{
+namespace kernel
+{
+
+/// Largest matrices factored by the unrolled routines below instead of LAPACK
+static const int SMALL_LAPACK_MAX = 8;
+
+/// Batches of matrices whose factorization costs at most this many flops are
+/// run in parallel, one matrix per thread. Larger ones are run in order and
+/// left to the threads of the LAPACK library.
+static const dim_t LAPACK_BATCH_PARALLEL_MAX = 1 << 21;
+
+/// Number of matrices along dims 2 and 3 of an array
+static inline dim_t batch_count(const af::dim4 &dims)
+{
+    return dims[2] * dims[3];
+}
+
+/// Offset of the b-th matrix of an array along dims 2 and 3
+static inline dim_t batch_offset(const af::dim4 &dims, const af::dim4 &strides, const dim_t b)
+{
+    return (b % dims[2]) * strides[2] + (b / dims[2]) * strides[3];
+}
+
+/// Calls func(b) for the batches matrices of size n
+template<typename Func>
+void batch_for(const dim_t batches, const dim_t n, Func func)
+{
+    const dim_t work = std::max<dim_t>(n * n * n, 1);
+    if (batches > 1 && work <= LAPACK_BATCH_PARALLEL_MAX) {
+        parallel_for(0, batches, (MIN_TASK_WORK + work - 1) / work, [&](dim_t lo, dim_t hi) {
+            for (dim_t b = lo; b < hi; ++b) func(b);
+        });
+    } else {
+        for (dim_t b = 0; b < batches; ++b) func(b);
+    }
+}
+
+/// Magnitude used by LAPACK to pick pivots, |re| + |im| for complex numbers
+template<typename T>
+double pivot_abs(const T v) { return std::abs(v); }
+
+template<typename T>
+double pivot_abs(const std::complex<T> v) { return std::abs(v.real()) + std::abs(v.imag()); }
+
+template<typename T>
+T conj_val(const T v) { return v; }
+
+template<typename T>
+std::complex<T> conj_val(const std::complex<T> v) { return std::conj(v); }
+
+template<typename T>
+double real_val(const T v) { return v; }
+
+template<typename T>
+double real_val(const std::complex<T> v) { return v.real(); }
+
+// The routines below follow the LAPACK routines of the same names on column
+// major N x N matrices. N being known at compile time, their loops are fully
+// unrolled. The return value is LAPACK's info.
+
+/// LU factorization with partial pivoting, ipiv being 1-based row swaps
+template<typename T, int N>
+struct small_getrf
+{
+    static int run(T *a, const dim_t lda, int *ipiv)
+    {
+        int info = 0;
+        for (int k = 0; k < N; ++k) {
+            int p = k;
+            double mag = pivot_abs(a[k + k * lda]);
+            for (int i = k + 1; i < N; ++i) {
+                double m = pivot_abs(a[i + k * lda]);
+                if (m > mag) { p = i; mag = m; }
+            }
+            ipiv[k] = p + 1;
+
+            // A zero column leaves the trailing matrix unchanged
+            if (a[p + k * lda] == T(0)) {
+                if (info == 0) info = k + 1;
+                continue;
+            }
+
+            if (p != k) {
+                for (int j = 0; j < N; ++j) std::swap(a[k + j * lda], a[p + j * lda]);
+            }
+
+            T inv = T(1) / a[k + k * lda];
+            for (int i = k + 1; i < N; ++i) a[i + k * lda] *= inv;
+
+            for (int j = k + 1; j < N; ++j) {
+                T akj = a[k + j * lda];
+                for (int i = k + 1; i < N; ++i) a[i + j * lda] -= a[i + k * lda] * akj;
+            }
+        }
+        return info;
+    }
+};
+
+/// Solves A X = B using the factors of small_getrf
+template<typename T, int N>
+struct small_getrs
+{
+    static int run(const T *a, const dim_t lda, const int *ipiv,
+                   T *b, const dim_t ldb, const dim_t nrhs)
+    {
+        for (dim_t c = 0; c < nrhs; ++c) {
+            T *x = b + c * ldb;
+            for (int k = 0; k < N; ++k) std::swap(x[k], x[ipiv[k] - 1]);
+
+            for (int i = 1; i < N; ++i) {
+                T s = x[i];
+                for (int k = 0; k < i; ++k) s -= a[i + k * lda] * x[k];
+                x[i] = s;
+            }
+
+            for (int i = N - 1; i >= 0; --i) {
+                T s = x[i];
+                for (int k = i + 1; k < N; ++k) s -= a[i + k * lda] * x[k];
+                x[i] = s / a[i + i * lda];
+            }
+        }
+        return 0;
+    }
+};
+
+/// Solves A X = B, leaving B unchanged when A is singular
+template<typename T, int N>
+struct small_gesv
+{
+    static int run(T *a, const dim_t lda, T *b, const dim_t ldb, const dim_t nrhs)
+    {
+        int ipiv[N];
+        int info = small_getrf<T, N>::run(a, lda, ipiv);
+        if (info == 0) small_getrs<T, N>::run(a, lda, ipiv, b, ldb, nrhs);
+        return info;
+    }
+};
+
+/// Inverts A in place, leaving its LU factors when A is singular
+template<typename T, int N>
+struct small_getri
+{
+    static int run(T *a, const dim_t lda)
+    {
+        int ipiv[N];
+        int info = small_getrf<T, N>::run(a, lda, ipiv);
+        if (info != 0) return info;
+
+        T lu[N * N];
+        for (int j = 0; j < N; ++j)
+            for (int i = 0; i < N; ++i) lu[i + j * N] = a[i + j * lda];
+
+        for (int j = 0; j < N; ++j) {
+            T *x = a + j * lda;
+            for (int i = 0; i < N; ++i) x[i] = T(i == j);
+            small_getrs<T, N>::run(lu, N, ipiv, x, lda, 1);
+        }
+        return 0;
+    }
+};
+
+/// Cholesky factorization of the upper or lower triangle of A, the other
+/// triangle being left untouched
+template<typename T, int N>
+struct small_potrf
+{
+    static int run(T *a, const dim_t lda, const bool is_upper)
+    {
+        // The upper factor is read through its conjugate transpose
+        auto at = [&](int i, int j) -> T& { return is_upper ? a[j + i * lda] : a[i + j * lda]; };
+        auto rd = [&](int i, int j) { return is_upper ? conj_val(a[j + i * lda]) : a[i + j * lda]; };
+
+        for (int j = 0; j < N; ++j) {
+            double d = real_val(a[j + j * lda]);
+            for (int k = 0; k < j; ++k) {
+                T l = rd(j, k);
+                d -= real_val(l * conj_val(l));
+            }
+            if (!(d > 0)) {
+                a[j + j * lda] = T(d);
+                return j + 1;
+            }
+
+            double ljj = std::sqrt(d);
+            a[j + j * lda] = T(ljj);
+
+            for (int i = j + 1; i < N; ++i) {
+                T s = rd(i, j);
+                for (int k = 0; k < j; ++k) s -= rd(i, k) * conj_val(rd(j, k));
+                s /= T(ljj);
+                at(i, j) = is_upper ? conj_val(s) : s;
+            }
+        }
+        return 0;
+    }
+};
+
+/// Solves A X = B for a triangular A. Nothing is solved when a diagonal
+/// element is zero.
+template<typename T, int N>
+struct small_trtrs
+{
+    static int run(const bool is_upper, const bool is_unit, const T *a, const dim_t lda,
+                   T *b, const dim_t ldb, const dim_t nrhs)
+    {
+        if (!is_unit) {
+            for (int i = 0; i < N; ++i)
+                if (a[i + i * lda] == T(0)) return i + 1;
+        }
+
+        for (dim_t c = 0; c < nrhs; ++c) {
+            T *x = b + c * ldb;
+            if (is_upper) {
+                for (int i = N - 1; i >= 0; --i) {
+                    T s = x[i];
+                    for (int k = i + 1; k < N; ++k) s -= a[i + k * lda] * x[k];
+                    x[i] = is_unit ? s : s / a[i + i * lda];
+                }
+            } else {
+                for (int i = 0; i < N; ++i) {
+                    T s = x[i];
+                    for (int k = 0; k < i; ++k) s -= a[i + k * lda] * x[k];
+                    x[i] = is_unit ? s : s / a[i + i * lda];
+                }
+            }
+        }
+        return 0;
+    }
+};
+
+/// Calls Op<T, n>::run(args...) for 1 <= n <= SMALL_LAPACK_MAX
+template<template<typename, int> class Op, typename T, typename... Args>
+int small_lapack(const int n, Args... args)
+{
+    switch (n) {
+        case 1: return Op<T, 1>::run(args...);
+        case 2: return Op<T, 2>::run(args...);
+        case 3: return Op<T, 3>::run(args...);
+        case 4: return Op<T, 4>::run(args...);
+        case 5: return Op<T, 5>::run(args...);
+        case 6: return Op<T, 6>::run(args...);
+        case 7: return Op<T, 7>::run(args...);
+        case 8: return Op<T, 8>::run(args...);
+        default: return 0;
+    }
+}
+
+}
+}
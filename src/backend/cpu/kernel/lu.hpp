@@ -66,12 +66,16 @@ void lu_split(Array<T> lower, Array<T> upper, const Array<T> in)
 
 void convertPivot(Array<int> p, Array<int> pivot)
 {
-    int *d_pi = pivot.get();
-    int *d_po = p.get();
-    dim_t d0  = pivot.dims()[0];
-    for(int j = 0; j < (int)d0; j++) {
-        // 1 indexed in pivot
-        std::swap(d_po[j], d_po[d_pi[j] - 1]);
+    dim_t d0 = pivot.dims()[0];
+    for(dim_t w = 0; w < pivot.dims()[3]; w++) {
+        for(dim_t z = 0; z < pivot.dims()[2]; z++) {
+            int *d_pi = pivot.get() + w * pivot.strides()[3] + z * pivot.strides()[2];
+            int *d_po = p.get()     + w * p.strides()[3]     + z * p.strides()[2];
+            for(int j = 0; j < (int)d0; j++) {
+                // 1 indexed in pivot
+                std::swap(d_po[j], d_po[d_pi[j] - 1]);
+            }
+        }
     }
 }
 
@@ -0,0 +1,365 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace cpu
+{
+namespace kernel
+{
+
+/// Values of a column whose moments are computed exactly, with a sum for the
+/// mean and a second pass over the block, still in cache, for the squared
+/// deviations. Blocks are then merged into the running moments.
+static const dim_t MOMENTS_BLOCK = 256;
+
+/// Values of a column handled by a single task
+static const dim_t MOMENTS_CHUNK = 1 << 16;
+
+/// Number of outputs accumulated together when reducing along dim > 0
+static const dim_t MOMENTS_TILE = 256;
+
+/// Independent accumulators used on contiguous data so that the loops can be
+/// vectorized
+static const int MOMENTS_LANES = 8;
+
+/// Total weight, mean and sum of squared deviations from the mean of a set
+/// of values. The weight is the number of values when they are unweighted.
+template<typename To, typename Tw>
+struct Moments
+{
+    Tw w;
+    To mean;
+    To m2;
+
+    Moments() : w(0), mean(0), m2(0) {}
+    Moments(Tw w_, To mean_, To m2_) : w(w_), mean(mean_), m2(m2_) {}
+
+    /// Pairwise update of Chan et al., which generalizes Welford's single
+    /// value update to sets of any size
+    void merge(Moments const &o)
+    {
+        if (o.w == Tw(0)) return;
+        if (w == Tw(0)) { *this = o; return; }
+
+        Tw const tot   = w + o.w;
+        To const delta = o.mean - mean;
+        mean = mean + delta * (o.w / tot);
+        m2   = m2 + o.m2 + delta * delta * (w * o.w / tot);
+        w    = tot;
+    }
+};
+
+/// Means of two sets of paired values and the sums of the products of their
+/// deviations from them
+template<typename To>
+struct CoMoments
+{
+    To n;
+    To mx, my;
+    To cxx, cyy, cxy;
+
+    CoMoments() : n(0), mx(0), my(0), cxx(0), cyy(0), cxy(0) {}
+
+    void merge(CoMoments const &o)
+    {
+        if (o.n == To(0)) return;
+        if (n == To(0)) { *this = o; return; }
+
+        To const tot = n + o.n;
+        To const dx  = o.mx - mx;
+        To const dy  = o.my - my;
+        To const f   = n * o.n / tot;
+        mx  = mx + dx * (o.n / tot);
+        my  = my + dy * (o.n / tot);
+        cxx = cxx + o.cxx + dx * dx * f;
+        cyy = cyy + o.cyy + dy * dy * f;
+        cxy = cxy + o.cxy + dx * dy * f;
+        n   = tot;
+    }
+};
+
+/// Sum of f(i) for i in [0, n), accumulated in independent lanes that are
+/// combined pairwise at the end
+template<typename T, typename F>
+T lane_sum(dim_t const n, F f)
+{
+    T acc[MOMENTS_LANES];
+    for (int k = 0; k < MOMENTS_LANES; k++) acc[k] = T(0);
+
+    dim_t i = 0;
+    for (; i + MOMENTS_LANES <= n; i += MOMENTS_LANES) {
+        for (int k = 0; k < MOMENTS_LANES; k++) acc[k] = acc[k] + f(i + k);
+    }
+    for (; i < n; i++) acc[0] = acc[0] + f(i);
+
+    for (int w = 1; w < MOMENTS_LANES; w *= 2) {
+        for (int k = 0; k + w < MOMENTS_LANES; k += 2 * w) acc[k] = acc[k] + acc[k + w];
+    }
+    return acc[0];
+}
+
+/// Moments of n values of x, weighted by wt unless it is null
+template<typename Ti, typename To, typename Tw>
+Moments<To, Tw> block_moments(Ti const *x, dim_t const xs,
+                              Tw const *wt, dim_t const ws, dim_t const n)
+{
+    if (!wt) {
+        To const mean = lane_sum<To>(n, [&](dim_t i) { return To(x[i * xs]); }) / Tw(n);
+        To const m2   = lane_sum<To>(n, [&](dim_t i) {
+            To const d = To(x[i * xs]) - mean;
+            return d * d;
+        });
+        return Moments<To, Tw>(Tw(n), mean, m2);
+    }
+
+    Tw const w = lane_sum<Tw>(n, [&](dim_t i) { return wt[i * ws]; });
+    if (w == Tw(0)) return Moments<To, Tw>();
+
+    To const mean = lane_sum<To>(n, [&](dim_t i) { return To(x[i * xs]) * wt[i * ws]; }) / w;
+    To const m2   = lane_sum<To>(n, [&](dim_t i) {
+        To const d = To(x[i * xs]) - mean;
+        return d * d * wt[i * ws];
+    });
+    return Moments<To, Tw>(w, mean, m2);
+}
+
+/// Co-moments of n paired values of x and y
+template<typename Ti, typename To>
+CoMoments<To> block_comoments(Ti const *x, dim_t const xs, Ti const *y, dim_t const ys, dim_t const n)
+{
+    CoMoments<To> c;
+    c.n   = To(n);
+    c.mx  = lane_sum<To>(n, [&](dim_t i) { return To(x[i * xs]); }) / To(n);
+    c.my  = lane_sum<To>(n, [&](dim_t i) { return To(y[i * ys]); }) / To(n);
+    c.cxx = lane_sum<To>(n, [&](dim_t i) { To d = To(x[i * xs]) - c.mx; return d * d; });
+    c.cyy = lane_sum<To>(n, [&](dim_t i) { To d = To(y[i * ys]) - c.my; return d * d; });
+    c.cxy = lane_sum<To>(n, [&](dim_t i) { return (To(x[i * xs]) - c.mx) * (To(y[i * ys]) - c.my); });
+    return c;
+}
+
+/// Splits columns of len values in chunks of at most MOMENTS_CHUNK values,
+/// calls chunk(c, off, n, result) for every one of them on the thread pool
+/// and merges the chunk results of each column in order into out
+template<typename M, typename F>
+void reduce_columns(std::vector<M> &out, dim_t const cols, dim_t const len, F chunk)
+{
+    dim_t const chunks = std::max<dim_t>((len + MOMENTS_CHUNK - 1) / MOMENTS_CHUNK, 1);
+    dim_t const work   = std::max<dim_t>(std::min(len, MOMENTS_CHUNK), 1);
+
+    std::vector<M> partial(cols * chunks);
+    parallel_for(0, cols * chunks, (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
+        for (dim_t t = lo; t < hi; t++) {
+            dim_t const off = (t % chunks) * MOMENTS_CHUNK;
+            chunk(t / chunks, off, std::min(MOMENTS_CHUNK, len - off), partial[t]);
+        }
+    });
+
+    out.assign(cols, M());
+    for (dim_t c = 0; c < cols; c++) {
+        for (dim_t k = 0; k < chunks; k++) out[c].merge(partial[c * chunks + k]);
+    }
+}
+
+/// Mean and variance along dim of in, weighted by wt unless it is null. The
+/// unweighted variance is divided by the number of values minus correction
+/// and the weighted one by the sum of the weights.
+template<typename Ti, typename To, typename Tw>
+void meanvar_impl(Array<To> mean, Array<To> var, Array<Ti> const &in,
+                  Tw const *wt, af::dim4 const &wstrides,
+                  dim_t const correction, int const dim)
+{
+    af::dim4 const idims    = in.dims();
+    af::dim4 const istrides = in.strides();
+    af::dim4 const ostrides = mean.strides();
+    af::dim4 const odims    = mean.dims();
+
+    dim_t const len = idims[dim];
+    Ti const *iptr  = in.get();
+    To *mptr        = mean.get();
+    To *vptr        = var.get();
+
+    auto finish = [&](Moments<To, Tw> const &m, dim_t const off) {
+        mptr[off] = m.mean;
+        vptr[off] = m.m2 / (wt ? m.w : Tw(len - correction));
+    };
+
+    if (dim == 0 || idims[0] == 1) {
+        // Every column along dim is reduced on its own
+        dim_t od[3], is[3], ws[3], os[3];
+        for (int d = 0, k = 0; d < 4; d++) {
+            if (d == dim) continue;
+            od[k] = idims[d];
+            is[k] = istrides[d];
+            ws[k] = wstrides[d];
+            os[k] = ostrides[d];
+            k++;
+        }
+
+        auto offset = [&](dim_t c, dim_t const *s) {
+            return (c % od[0]) * s[0] + ((c / od[0]) % od[1]) * s[1] + (c / (od[0] * od[1])) * s[2];
+        };
+
+        std::vector<Moments<To, Tw> > result;
+        reduce_columns(result, od[0] * od[1] * od[2], len,
+                       [&](dim_t c, dim_t off, dim_t n, Moments<To, Tw> &m) {
+            Ti const *x = iptr + offset(c, is) + off * istrides[dim];
+            Tw const *w = wt ? wt + offset(c, ws) + off * wstrides[dim] : wt;
+            for (dim_t b = 0; b < n; b += MOMENTS_BLOCK) {
+                dim_t const bn = std::min(MOMENTS_BLOCK, n - b);
+                m.merge(block_moments<Ti, To, Tw>(x + b * istrides[dim], istrides[dim],
+                                                  w ? w + b * wstrides[dim] : w,
+                                                  wstrides[dim], bn));
+            }
+        });
+
+        for (dim_t c = 0; c < (dim_t)result.size(); c++) finish(result[c], offset(c, os));
+        return;
+    }
+
+    // Along dim > 0 a tile of consecutive outputs is updated with every row
+    // of the input, so the inner loops walk contiguous memory
+    dim_t const tiles   = (odims[0] + MOMENTS_TILE - 1) / MOMENTS_TILE;
+    dim_t const batches = odims[1] * odims[2] * odims[3];
+    dim_t const work    = std::max<dim_t>(std::min(odims[0], MOMENTS_TILE) * len, 1);
+    dim_t const s0      = istrides[0];
+    dim_t const w0      = wstrides[0];
+
+    parallel_for(0, batches * tiles, (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
+        Moments<To, Tw> acc[MOMENTS_TILE];
+        To bsum[MOMENTS_TILE], bm2[MOMENTS_TILE];
+        Tw bw[MOMENTS_TILE];
+
+        for (dim_t t = lo; t < hi; t++) {
+            dim_t const b  = t / tiles;
+            dim_t const b1 = b % odims[1];
+            dim_t const b2 = (b / odims[1]) % odims[2];
+            dim_t const b3 = b / (odims[1] * odims[2]);
+            dim_t const i0 = (t % tiles) * MOMENTS_TILE;
+            dim_t const n  = std::min(MOMENTS_TILE, odims[0] - i0);
+
+            Ti const *x = iptr + b1 * istrides[1] + b2 * istrides[2] + b3 * istrides[3] + i0 * s0;
+            Tw const *w = wt ? wt + b1 * wstrides[1] + b2 * wstrides[2] + b3 * wstrides[3] + i0 * w0 : wt;
+
+            for (dim_t i = 0; i < n; i++) acc[i] = Moments<To, Tw>();
+
+            for (dim_t j0 = 0; j0 < len; j0 += MOMENTS_BLOCK) {
+                dim_t const j1 = std::min(j0 + MOMENTS_BLOCK, len);
+
+                for (dim_t i = 0; i < n; i++) {
+                    bsum[i] = To(0);
+                    bm2[i]  = To(0);
+                    bw[i]   = w ? Tw(0) : Tw(j1 - j0);
+                }
+
+                for (dim_t j = j0; j < j1; j++) {
+                    Ti const *row = x + j * istrides[dim];
+                    if (w) {
+                        Tw const *wrow = w + j * wstrides[dim];
+                        for (dim_t i = 0; i < n; i++) {
+                            bw[i]   = bw[i] + wrow[i * w0];
+                            bsum[i] = bsum[i] + To(row[i * s0]) * wrow[i * w0];
+                        }
+                    } else {
+                        for (dim_t i = 0; i < n; i++) bsum[i] = bsum[i] + To(row[i * s0]);
+                    }
+                }
+
+                for (dim_t i = 0; i < n; i++) {
+                    bsum[i] = bw[i] == Tw(0) ? To(0) : bsum[i] / bw[i];
+                }
+
+                for (dim_t j = j0; j < j1; j++) {
+                    Ti const *row = x + j * istrides[dim];
+                    if (w) {
+                        Tw const *wrow = w + j * wstrides[dim];
+                        for (dim_t i = 0; i < n; i++) {
+                            To const d = To(row[i * s0]) - bsum[i];
+                            bm2[i] = bm2[i] + d * d * wrow[i * w0];
+                        }
+                    } else {
+                        for (dim_t i = 0; i < n; i++) {
+                            To const d = To(row[i * s0]) - bsum[i];
+                            bm2[i] = bm2[i] + d * d;
+                        }
+                    }
+                }
+
+                for (dim_t i = 0; i < n; i++) acc[i].merge(Moments<To, Tw>(bw[i], bsum[i], bm2[i]));
+            }
+
+            dim_t const o = b1 * ostrides[1] + b2 * ostrides[2] + b3 * ostrides[3] + i0;
+            for (dim_t i = 0; i < n; i++) finish(acc[i], o + i);
+        }
+    });
+}
+
+template<typename Ti, typename To, typename Tw>
+void meanvar(Array<To> mean, Array<To> var, Array<Ti> const in,
+             bool const isbiased, int const dim)
+{
+    meanvar_impl<Ti, To, Tw>(mean, var, in, (Tw const *)nullptr, in.strides(),
+                             isbiased ? 0 : 1, dim);
+}
+
+template<typename Ti, typename To, typename Tw>
+void meanvar_weighted(Array<To> mean, Array<To> var, Array<Ti> const in,
+                      Array<Tw> const wts, int const dim)
+{
+    meanvar_impl<Ti, To, Tw>(mean, var, in, wts.get(), wts.strides(), 0, dim);
+}
+
+/// Co-moments of every column of x and y along dim 0
+template<typename Ti, typename To>
+void comoments(Array<To> mx, Array<To> my, Array<To> cxx, Array<To> cyy, Array<To> cxy,
+               Array<Ti> const x, Array<Ti> const y)
+{
+    af::dim4 const dims = x.dims();
+    af::dim4 const xs   = x.strides();
+    af::dim4 const ys   = y.strides();
+    af::dim4 const os   = mx.strides();
+
+    dim_t const len  = dims[0];
+    dim_t const cols = dims[1] * dims[2] * dims[3];
+
+    auto offset = [&](dim_t c, af::dim4 const &s) {
+        return (c % dims[1]) * s[1] + ((c / dims[1]) % dims[2]) * s[2] + (c / (dims[1] * dims[2])) * s[3];
+    };
+
+    Ti const *xptr = x.get();
+    Ti const *yptr = y.get();
+
+    std::vector<CoMoments<To> > result;
+    reduce_columns(result, cols, len, [&](dim_t c, dim_t off, dim_t n, CoMoments<To> &m) {
+        Ti const *xc = xptr + offset(c, xs) + off * xs[0];
+        Ti const *yc = yptr + offset(c, ys) + off * ys[0];
+        for (dim_t b = 0; b < n; b += MOMENTS_BLOCK) {
+            m.merge(block_comoments<Ti, To>(xc + b * xs[0], xs[0], yc + b * ys[0], ys[0],
+                                            std::min(MOMENTS_BLOCK, n - b)));
+        }
+    });
+
+    for (dim_t c = 0; c < cols; c++) {
+        dim_t const o = offset(c, os);
+        mx.get()[o]  = result[c].mx;
+        my.get()[o]  = result[c].my;
+        cxx.get()[o] = result[c].cxx;
+        cyy.get()[o] = result[c].cyy;
+        cxy.get()[o] = result[c].cxy;
+    }
+}
+
+}
+}
@@ -9,80 +9,372 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
 #include <vector>
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 
 namespace cpu
 {
 namespace kernel
 {
 
+// Windows up to this many elements are sorted with a sorting network
+static const dim_t MEDFILT_NETWORK_MAX = 25;
+
+// Number of outputs along dim 0 sorted together by the network
+static const dim_t MEDFILT_LANES = 32;
+
+// Minimum number of columns handled by one task of the histogram filters
+static const dim_t MEDFILT_STRIPE = 64;
+
+// Padded access to the image, matching the window gathering of medfilt2
 template<typename T, af_border_type Pad>
-void medfilt1(Array<T> out, const Array<T> in, dim_t w_wid)
+struct MedfiltSource
+{
+    T const * ptr;
+    dim_t len0, len1, stride0, stride1;
+
+    static dim_t reflect(dim_t idx, dim_t len)
+    {
+        if (idx < 0)     idx = -idx;
+        if (idx >= len)  idx = 2 * (len - 1) - idx;
+        return idx;
+    }
+
+    T operator()(dim_t i, dim_t j) const
+    {
+        if (Pad == AF_PAD_ZERO && (i < 0 || j < 0 || i >= len0 || j >= len1))
+            return T(0);
+        return ptr[reflect(i, len0) * stride0 + reflect(j, len1) * stride1];
+    }
+};
+
+// Middle of n sorted values, averaging the two middle ones when n is even
+template<typename T>
+T middle(T lo, T hi, dim_t n)
+{
+    return (n % 2 == 0) ? (T)((hi + lo) / 2) : hi;
+}
+
+// Batcher's merge exchange network sorting n elements (Knuth 5.2.2 M)
+static inline std::vector<std::pair<int, int> > sortingNetwork(int n)
+{
+    std::vector<std::pair<int, int> > net;
+    int t = 0;
+    while ((1 << t) < n) t++;
+    for (int p = (t > 0 ? 1 << (t - 1) : 0); p > 0; p >>= 1) {
+        int q = 1 << (t - 1), r = 0, d = p;
+        while (true) {
+            for (int i = 0; i < n - d; i++) {
+                if ((i & p) == r) net.push_back(std::make_pair(i, i + d));
+            }
+            if (q == p) break;
+            d = q - p;
+            q >>= 1;
+            r = p;
+        }
+    }
+    return net;
+}
+
+// Sorts the window of MEDFILT_LANES consecutive outputs at once: lane k of
+// every output holds element k of its window, and every compare exchange of
+// the network is applied to all outputs with min / max.
+template<typename T, af_border_type Pad>
+void medfiltNetwork(Array<T> out, const Array<T> in, dim_t w_len, dim_t w_wid)
 {
     const af::dim4 dims     = in.dims();
     const af::dim4 istrides = in.strides();
     const af::dim4 ostrides = out.strides();
+    const dim_t n           = w_len * w_wid;
+    const std::vector<std::pair<int, int> > net = sortingNetwork(n);
 
-    std::vector<T> wind_vals;
-    wind_vals.reserve(w_wid);
+    parallel_for_batch(dims, dims[0] * net.size(), [&](dim_t col, dim_t b2, dim_t b3) {
+        std::vector<T> lanes(n * MEDFILT_LANES);
 
-    T const * in_ptr = in.get();
-    T * out_ptr = out.get();
+        MedfiltSource<T, Pad> src = {in.get() + b2*istrides[2] + b3*istrides[3],
+                                     dims[0], dims[1], istrides[0], istrides[1]};
+        T * out_ptr = out.get() + col*ostrides[1] + b2*ostrides[2] + b3*ostrides[3];
 
-    for(int b3=0; b3<(int)dims[3]; b3++) {
+        for (dim_t row0 = 0; row0 < dims[0]; row0 += MEDFILT_LANES) {
+            const dim_t count = std::min(MEDFILT_LANES, dims[0] - row0);
 
-        for(int b2=0; b2<(int)dims[2]; b2++) {
-
-            for(int col=0; col<(int)dims[1]; col++) {
+            for (dim_t wj = 0; wj < w_wid; wj++) {
+                for (dim_t wi = 0; wi < w_len; wi++) {
+                    T *lane = &lanes[(wj * w_len + wi) * MEDFILT_LANES];
+                    for (dim_t x = 0; x < count; x++) {
+                        lane[x] = src(row0 + x + wi - w_len/2, col + wj - w_wid/2);
+                    }
+                }
+            }
 
-                int ocol_off = col*ostrides[1];
+            for (size_t c = 0; c < net.size(); c++) {
+                T *a = &lanes[net[c].first  * MEDFILT_LANES];
+                T *b = &lanes[net[c].second * MEDFILT_LANES];
+                for (dim_t x = 0; x < MEDFILT_LANES; x++) {
+                    const T lo = std::min(a[x], b[x]);
+                    const T hi = std::max(a[x], b[x]);
+                    a[x] = lo;
+                    b[x] = hi;
+                }
+            }
 
-                for(int row=0; row<(int)dims[0]; row++) {
+            const T *hi = &lanes[(n / 2) * MEDFILT_LANES];
+            const T *lo = &lanes[(n / 2 - (n % 2 == 0 ? 1 : 0)) * MEDFILT_LANES];
+            for (dim_t x = 0; x < count; x++) {
+                out_ptr[(row0 + x) * ostrides[0]] = middle(lo[x], hi[x], n);
+            }
+        }
+    });
+}
 
-                    wind_vals.clear();
-                    for(int wi=0; wi<(int)w_wid; ++wi) {
+// Median of the n values counted in hist, which has bins bins
+template<typename T, typename C>
+T histMedian(const C *hist, int bins, dim_t n)
+{
+    const dim_t khi = n / 2;
+    const dim_t klo = (n % 2 == 0) ? khi - 1 : khi;
+
+    dim_t sum = 0;
+    int b = 0;
+    while (sum + hist[b] <= klo) sum += hist[b++];
+    const int lo = b;
+    while (sum + hist[b] <= khi) sum += hist[b++];
+    return middle((T)lo, (T)b, n);
+}
 
-                        int im_row = row + wi-w_wid/2;
-                        int im_roff;
-                        switch(Pad) {
-                            case AF_PAD_ZERO:
-                                im_roff = im_row * istrides[0];
-                                if (im_row < 0 || im_row>=(int)dims[0])
-                                    wind_vals.push_back(0);
-                                else
-                                    wind_vals.push_back(in_ptr[im_roff]);
-                                break;
-                            case AF_PAD_SYM:
-                                {
-                                    if (im_row < 0) {
-                                        im_row *= -1;
-                                    }
+// Perreault and Hebert's constant time median filter for 8 bit images.
+// Every row of the image keeps a histogram of the w_wid values of its window
+// columns, updated with one removal and one insertion per output column. The
+// histogram of the window is slid along dim 0 by adding and removing a row
+// histogram, which costs the same for any window size.
+template<typename T, af_border_type Pad>
+void medfiltHistogram8(Array<T> out, const Array<T> in, dim_t w_len, dim_t w_wid)
+{
+    static const int bins = 256;
 
-                                    if (im_row>=(int)dims[0]) {
-                                        im_row = 2*((int)dims[0]-1) - im_row;
-                                    }
+    const af::dim4 dims     = in.dims();
+    const af::dim4 istrides = in.strides();
+    const af::dim4 ostrides = out.strides();
+    const dim_t n           = w_len * w_wid;
+    const dim_t r0          = w_len / 2;
+    const dim_t r1          = w_wid / 2;
+
+    const dim_t stripe  = std::max(MEDFILT_STRIPE, w_wid);
+    const dim_t stripes = (dims[1] + stripe - 1) / stripe;
+    const dim_t batches = dims[2] * dims[3];
+
+    parallel_for(0, batches * stripes, 1, [&](dim_t lo, dim_t hi) {
+        // Row histograms followed by the one of the rows outside of the image
+        std::vector<unsigned> rows((dims[0] + 1) * bins);
+        std::vector<unsigned> kernel(bins);
+        unsigned * const zero = &rows[dims[0] * bins];
+
+        for (dim_t t = lo; t < hi; t++) {
+            const dim_t b  = t / stripes;
+            const dim_t b2 = b % dims[2];
+            const dim_t b3 = b / dims[2];
+            const dim_t j0 = (t % stripes) * stripe;
+            const dim_t j1 = std::min(j0 + stripe, dims[1]);
+
+            MedfiltSource<T, Pad> src = {in.get() + b2*istrides[2] + b3*istrides[3],
+                                         dims[0], dims[1], istrides[0], istrides[1]};
+            T * out_ptr = out.get() + b2*ostrides[2] + b3*ostrides[3];
+
+            std::fill(rows.begin(), rows.end(), 0);
+            zero[0] = w_wid;
+            for (dim_t i = 0; i < dims[0]; i++) {
+                unsigned *h = &rows[i * bins];
+                for (dim_t wj = 0; wj < w_wid; wj++) h[(int)src(i, j0 + wj - r1)]++;
+            }
 
-                                    im_roff = im_row * istrides[0];
-                                    wind_vals.push_back(in_ptr[im_roff]);
-                                }
-                                break;
-                        }
+            auto row = [&](dim_t i) -> const unsigned * {
+                if (i < 0 || i >= dims[0]) {
+                    if (Pad == AF_PAD_ZERO) return zero;
+                    i = MedfiltSource<T, Pad>::reflect(i, dims[0]);
+                }
+                return &rows[i * bins];
+            };
+
+            for (dim_t j = j0; j < j1; j++) {
+                if (j > j0) {
+                    for (dim_t i = 0; i < dims[0]; i++) {
+                        unsigned *h = &rows[i * bins];
+                        h[(int)src(i, j - 1 - r1)]--;
+                        h[(int)src(i, j - 1 - r1 + w_wid)]++;
                     }
+                }
 
-                    int off = wind_vals.size()/2;
-                    std::stable_sort(wind_vals.begin(),wind_vals.end());
-                    if (wind_vals.size()%2==0)
-                        out_ptr[ocol_off+row*ostrides[0]] = (wind_vals[off]+wind_vals[off-1])/2;
-                    else {
-                        out_ptr[ocol_off+row*ostrides[0]] = wind_vals[off];
+                std::fill(kernel.begin(), kernel.end(), 0);
+                for (dim_t wi = 0; wi < w_len; wi++) {
+                    const unsigned *h = row(wi - r0);
+                    for (int v = 0; v < bins; v++) kernel[v] += h[v];
+                }
+
+                for (dim_t i = 0; i < dims[0]; i++) {
+                    if (i > 0) {
+                        const unsigned *add = row(i - 1 - r0 + w_len);
+                        const unsigned *rem = row(i - 1 - r0);
+                        for (int v = 0; v < bins; v++) kernel[v] += add[v] - rem[v];
                     }
+                    out_ptr[i * ostrides[0] + j * ostrides[1]] = histMedian<T>(kernel.data(), bins, n);
+                }
+            }
+        }
+    });
+}
+
+// Huang's sliding histogram median for 16 bit images. The window histogram is
+// slid along dim 1 by removing and inserting a column of w_len values. A
+// coarse histogram of the high byte finds the median in two short scans.
+template<typename T, af_border_type Pad>
+void medfiltHistogram16(Array<T> out, const Array<T> in, dim_t w_len, dim_t w_wid)
+{
+    static const int bins = 1 << 16;
+
+    const af::dim4 dims     = in.dims();
+    const af::dim4 istrides = in.strides();
+    const af::dim4 ostrides = out.strides();
+    const dim_t n           = w_len * w_wid;
+    const dim_t r0          = w_len / 2;
+    const dim_t r1          = w_wid / 2;
+    const dim_t khi         = n / 2;
+    const dim_t klo         = (n % 2 == 0) ? khi - 1 : khi;
+
+    const dim_t rows = dims[0] * dims[2] * dims[3];
+
+    parallel_for(0, rows, 1, [&](dim_t lo, dim_t hi) {
+        std::vector<unsigned> fine(bins), coarse(256);
+
+        auto select = [&](dim_t k) {
+            dim_t sum = 0;
+            int c = 0;
+            while (sum + coarse[c] <= k) sum += coarse[c++];
+            int v = c << 8;
+            while (sum + fine[v] <= k) sum += fine[v++];
+            return v;
+        };
+
+        for (dim_t r = lo; r < hi; r++) {
+            const dim_t i  = r % dims[0];
+            const dim_t b2 = (r / dims[0]) % dims[2];
+            const dim_t b3 = r / (dims[0] * dims[2]);
+
+            MedfiltSource<T, Pad> src = {in.get() + b2*istrides[2] + b3*istrides[3],
+                                         dims[0], dims[1], istrides[0], istrides[1]};
+            T * out_ptr = out.get() + i*ostrides[0] + b2*ostrides[2] + b3*ostrides[3];
+
+            std::fill(fine.begin(), fine.end(), 0);
+            std::fill(coarse.begin(), coarse.end(), 0);
+
+            auto update = [&](dim_t j, int delta) {
+                for (dim_t wi = 0; wi < w_len; wi++) {
+                    const int v = (int)src(i + wi - r0, j);
+                    fine[v]        += delta;
+                    coarse[v >> 8] += delta;
+                }
+            };
+
+            for (dim_t wj = 0; wj < w_wid; wj++) update(wj - r1, 1);
+
+            for (dim_t j = 0; j < dims[1]; j++) {
+                if (j > 0) {
+                    update(j - 1 - r1, -1);
+                    update(j - 1 - r1 + w_wid, 1);
                 }
+                out_ptr[j * ostrides[1]] = middle((T)select(klo), (T)select(khi), n);
             }
-            in_ptr  += istrides[2];
-            out_ptr += ostrides[2];
         }
+    });
+}
+
+// Picks the fastest filter for the window. Returns false if none applies.
+template<typename T, af_border_type Pad>
+bool medfiltFast(Array<T> out, const Array<T> in, dim_t w_len, dim_t w_wid)
+{
+    const af::dim4 dims = in.dims();
+
+    // Symmetric padding only reflects once
+    if (Pad == AF_PAD_SYM && (w_len / 2 >= dims[0] || w_wid / 2 >= dims[1]))
+        return false;
+
+    if (w_len * w_wid <= MEDFILT_NETWORK_MAX) {
+        medfiltNetwork<T, Pad>(out, in, w_len, w_wid);
+        return true;
+    }
+    if (std::is_same<T, uchar>::value) {
+        medfiltHistogram8<T, Pad>(out, in, w_len, w_wid);
+        return true;
     }
+    if (std::is_same<T, ushort>::value) {
+        medfiltHistogram16<T, Pad>(out, in, w_len, w_wid);
+        return true;
+    }
+    return false;
+}
+
+template<typename T, af_border_type Pad>
+void medfilt1(Array<T> out, const Array<T> in, dim_t w_wid)
+{
+    const af::dim4 dims     = in.dims();
+    const af::dim4 istrides = in.strides();
+    const af::dim4 ostrides = out.strides();
+
+    // The window is a single column of a 2D window
+    if (medfiltFast<T, Pad>(out, in, w_wid, 1)) return;
+
+    parallel_for_batch(dims, dims[0] * w_wid, [&](dim_t col, dim_t b2, dim_t b3) {
+        std::vector<T> wind_vals;
+        wind_vals.reserve(w_wid);
+
+        T const * in_ptr = in.get() + col*istrides[1] + b2*istrides[2] + b3*istrides[3];
+        T * out_ptr = out.get() + b2*ostrides[2] + b3*ostrides[3];
+
+        int ocol_off = col*ostrides[1];
+
+        for(int row=0; row<(int)dims[0]; row++) {
+
+            wind_vals.clear();
+            for(int wi=0; wi<(int)w_wid; ++wi) {
+
+                int im_row = row + wi-w_wid/2;
+                int im_roff;
+                switch(Pad) {
+                    case AF_PAD_ZERO:
+                        im_roff = im_row * istrides[0];
+                        if (im_row < 0 || im_row>=(int)dims[0])
+                            wind_vals.push_back(0);
+                        else
+                            wind_vals.push_back(in_ptr[im_roff]);
+                        break;
+                    case AF_PAD_SYM:
+                        {
+                            if (im_row < 0) {
+                                im_row *= -1;
+                            }
+
+                            if (im_row>=(int)dims[0]) {
+                                im_row = 2*((int)dims[0]-1) - im_row;
+                            }
+
+                            im_roff = im_row * istrides[0];
+                            wind_vals.push_back(in_ptr[im_roff]);
+                        }
+                        break;
+                }
+            }
+
+            int off = wind_vals.size()/2;
+            std::stable_sort(wind_vals.begin(),wind_vals.end());
+            if (wind_vals.size()%2==0)
+                out_ptr[ocol_off+row*ostrides[0]] = (wind_vals[off]+wind_vals[off-1])/2;
+            else {
+                out_ptr[ocol_off+row*ostrides[0]] = wind_vals[off];
+            }
+        }
+    });
 }
 
 
@@ -93,108 +385,101 @@ void medfilt2(Array<T> out, const Array<T> in, dim_t w_len, dim_t w_wid)
     const af::dim4 istrides = in.strides();
     const af::dim4 ostrides = out.strides();
 
-    std::vector<T> wind_vals;
-    wind_vals.reserve(w_len*w_wid);
+    if (medfiltFast<T, Pad>(out, in, w_len, w_wid)) return;
 
-    T const * in_ptr = in.get();
-    T * out_ptr = out.get();
+    parallel_for_batch(dims, dims[0] * w_len * w_wid, [&](dim_t col, dim_t b2, dim_t b3) {
+        std::vector<T> wind_vals;
+        wind_vals.reserve(w_len*w_wid);
 
-    for(int b3=0; b3<(int)dims[3]; b3++) {
+        T const * in_ptr = in.get() + b2*istrides[2] + b3*istrides[3];
+        T * out_ptr = out.get() + b2*ostrides[2] + b3*ostrides[3];
 
-        for(int b2=0; b2<(int)dims[2]; b2++) {
+        int ocol_off = col*ostrides[1];
 
-            for(int col=0; col<(int)dims[1]; col++) {
+        for(int row=0; row<(int)dims[0]; row++) {
 
-                int ocol_off = col*ostrides[1];
+            wind_vals.clear();
 
-                for(int row=0; row<(int)dims[0]; row++) {
+            for(int wj=0; wj<(int)w_wid; ++wj) {
 
-                    wind_vals.clear();
+                bool isColOff = false;
 
-                    for(int wj=0; wj<(int)w_wid; ++wj) {
+                int im_col = col + wj-w_wid/2;
+                int im_coff;
+                switch(Pad) {
+                    case AF_PAD_ZERO:
+                        im_coff = im_col * istrides[1];
+                        if (im_col < 0 || im_col>=(int)dims[1])
+                            isColOff = true;
+                        break;
+                    case AF_PAD_SYM:
+                        {
+                            if (im_col < 0) {
+                                im_col *= -1;
+                                isColOff = true;
+                            }
 
-                        bool isColOff = false;
+                            if (im_col>=(int)dims[1]) {
+                                im_col = 2*((int)dims[1]-1) - im_col;
+                                isColOff = true;
+                            }
 
-                        int im_col = col + wj-w_wid/2;
-                        int im_coff;
-                        switch(Pad) {
-                            case AF_PAD_ZERO:
-                                im_coff = im_col * istrides[1];
-                                if (im_col < 0 || im_col>=(int)dims[1])
-                                    isColOff = true;
-                                break;
-                            case AF_PAD_SYM:
-                                {
-                                    if (im_col < 0) {
-                                        im_col *= -1;
-                                        isColOff = true;
-                                    }
-
-                                    if (im_col>=(int)dims[1]) {
-                                        im_col = 2*((int)dims[1]-1) - im_col;
-                                        isColOff = true;
-                                    }
-
-                                    im_coff = im_col * istrides[1];
-                                }
-                                break;
+                            im_coff = im_col * istrides[1];
                         }
+                        break;
+                }
 
-                        for(int wi=0; wi<(int)w_len; ++wi) {
-
-                            bool isRowOff = false;
-
-                            int im_row = row + wi-w_len/2;
-                            int im_roff;
-                            switch(Pad) {
-                                case AF_PAD_ZERO:
-                                    im_roff = im_row * istrides[0];
-                                    if (im_row < 0 || im_row>=(int)dims[0])
-                                        isRowOff = true;
-                                    break;
-                                case AF_PAD_SYM:
-                                    {
-                                        if (im_row < 0) {
-                                            im_row *= -1;
-                                            isRowOff = true;
-                                        }
-
-                                        if (im_row>=(int)dims[0]) {
-                                            im_row = 2*((int)dims[0]-1) - im_row;
-                                            isRowOff = true;
-                                        }
-
-                                        im_roff = im_row * istrides[0];
-                                    }
-                                    break;
-                            }
+                for(int wi=0; wi<(int)w_len; ++wi) {
+
+                    bool isRowOff = false;
+
+                    int im_row = row + wi-w_len/2;
+                    int im_roff;
+                    switch(Pad) {
+                        case AF_PAD_ZERO:
+                            im_roff = im_row * istrides[0];
+                            if (im_row < 0 || im_row>=(int)dims[0])
+                                isRowOff = true;
+                            break;
+                        case AF_PAD_SYM:
+                            {
+                                if (im_row < 0) {
+                                    im_row *= -1;
+                                    isRowOff = true;
+                                }
 
-                            if(isRowOff || isColOff) {
-                                switch(Pad) {
-                                    case AF_PAD_ZERO:
-                                        wind_vals.push_back(0);
-                                        break;
-                                    case AF_PAD_SYM:
-                                        wind_vals.push_back(in_ptr[im_coff+im_roff]);
-                                        break;
+                                if (im_row>=(int)dims[0]) {
+                                    im_row = 2*((int)dims[0]-1) - im_row;
+                                    isRowOff = true;
                                 }
-                            } else
-                                wind_vals.push_back(in_ptr[im_coff+im_roff]);
-                        }
+
+                                im_roff = im_row * istrides[0];
+                            }
+                            break;
                     }
 
-                    std::stable_sort(wind_vals.begin(),wind_vals.end());
-                    int off = wind_vals.size()/2;
-                    if (wind_vals.size()%2==0)
-                        out_ptr[ocol_off+row*ostrides[0]] = (wind_vals[off]+wind_vals[off-1])/2;
-                    else
-                        out_ptr[ocol_off+row*ostrides[0]] = wind_vals[off];
+                    if(isRowOff || isColOff) {
+                        switch(Pad) {
+                            case AF_PAD_ZERO:
+                                wind_vals.push_back(0);
+                                break;
+                            case AF_PAD_SYM:
+                                wind_vals.push_back(in_ptr[im_coff+im_roff]);
+                                break;
+                        }
+                    } else
+                        wind_vals.push_back(in_ptr[im_coff+im_roff]);
                 }
             }
-            in_ptr  += istrides[2];
-            out_ptr += ostrides[2];
+
+            std::stable_sort(wind_vals.begin(),wind_vals.end());
+            int off = wind_vals.size()/2;
+            if (wind_vals.size()%2==0)
+                out_ptr[ocol_off+row*ostrides[0]] = (wind_vals[off]+wind_vals[off-1])/2;
+            else
+                out_ptr[ocol_off+row*ostrides[0]] = wind_vals[off];
         }
-    }
+    });
 }
 
 }
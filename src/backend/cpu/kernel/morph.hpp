@@ -9,15 +9,161 @@
 
 #pragma once
 #include <limits>
+#include <vector>
 #include <Array.hpp>
 #include <utility.hpp>
 #include <ops.hpp>
+#include <thread_pool.hpp>
 
 namespace cpu
 {
 namespace kernel
 {
 
+// Number of neighbouring lines filtered together by the flat mask path
+static const dim_t MORPH_TILE = 256;
+
+// Number of columns filtered together by the pass along dim 0 of the flat
+// mask path. Their elements are gathered into contiguous lines first.
+static const dim_t MORPH_COLUMNS = 16;
+
+template<typename T>
+bool isFlatMask(Array<T> const mask, const int rank)
+{
+    const af::dim4 window   = mask.dims();
+    const af::dim4 fstrides = mask.strides();
+    const T*   filter       = mask.get();
+
+    for(dim_t wk=0; wk<(rank == 3 ? window[2] : 1); wk++)
+        for(dim_t wj=0; wj<window[1]; wj++)
+            for(dim_t wi=0; wi<window[0]; wi++)
+                if (!(filter[ getIdx(fstrides, wi, wj, wk) ] > (T)0)) return false;
+    return true;
+}
+
+template<typename T, bool IsDilation>
+inline T extreme(T lhs, T rhs)
+{
+    return IsDilation ? std::max(lhs, rhs) : std::min(lhs, rhs);
+}
+
+// van Herk/Gil-Werman running min/max along a dimension of n elements using
+// three comparisons per element for any window size. Output i covers inputs
+// [i - R, i - R + w), out of bounds inputs are ignored. Element p of line l is
+// in[l * iline + p * istep] and out[l * oline + p * ostep]. out may alias in.
+//
+// The padded input is split in blocks of w elements. g holds the running
+// result from the start of every block and h the one to the end of every
+// block, so every window is covered by one suffix of h and one prefix of g.
+template<typename T, bool IsDilation>
+void vhgw(T *out, const dim_t ostep, const dim_t oline,
+          const T *in, const dim_t istep, const dim_t iline,
+          const dim_t n, const dim_t lines, const dim_t w, const dim_t R,
+          std::vector<T> &scratch)
+{
+    const T init  = IsDilation ? Binary<T, af_max_t>().init() : Binary<T, af_min_t>().init();
+    const dim_t L = n + w - 1;
+
+    scratch.resize(2 * L * lines);
+    T *g = scratch.data();
+    T *h = g + L * lines;
+
+    for (dim_t p = 0; p < L; p++) {
+        const dim_t q = p - R;
+        T *gp = g + p * lines;
+        T *hp = h + p * lines;
+        if (q < 0 || q >= n) {
+            for (dim_t l = 0; l < lines; l++) gp[l] = init;
+        } else {
+            const T *ip = in + q * istep;
+            if (iline == 1) {
+                for (dim_t l = 0; l < lines; l++) gp[l] = ip[l];
+            } else {
+                for (dim_t l = 0; l < lines; l++) gp[l] = ip[l * iline];
+            }
+        }
+        for (dim_t l = 0; l < lines; l++) hp[l] = gp[l];
+    }
+
+    for (dim_t p = 1; p < L; p++) {
+        if (p % w == 0) continue;
+        T *gp = g + p * lines;
+        const T *gq = gp - lines;
+        for (dim_t l = 0; l < lines; l++) gp[l] = extreme<T, IsDilation>(gp[l], gq[l]);
+    }
+
+    for (dim_t p = L - 2; p >= 0; p--) {
+        if ((p + 1) % w == 0) continue;
+        T *hp = h + p * lines;
+        const T *hq = hp + lines;
+        for (dim_t l = 0; l < lines; l++) hp[l] = extreme<T, IsDilation>(hp[l], hq[l]);
+    }
+
+    for (dim_t i = 0; i < n; i++) {
+        const T *hp = h + i * lines;
+        const T *gp = g + (i + w - 1) * lines;
+        T *op = out + i * ostep;
+        if (oline == 1) {
+            for (dim_t l = 0; l < lines; l++) op[l] = extreme<T, IsDilation>(hp[l], gp[l]);
+        } else {
+            for (dim_t l = 0; l < lines; l++) op[l * oline] = extreme<T, IsDilation>(hp[l], gp[l]);
+        }
+    }
+}
+
+// Flat rectangular masks are separable: the window is filtered along each
+// dimension in turn. The first pass reads the input along dim 0, the others
+// update the output in place, sweeping MORPH_TILE contiguous lines at once.
+template<typename T, bool IsDilation>
+void morphFlat(Array<T> out, Array<T> const in, const af::dim4 &window, const int rank)
+{
+    const af::dim4 dims     = in.dims();
+    const af::dim4 istrides = in.strides();
+    const af::dim4 ostrides = out.strides();
+    T* outData              = out.get();
+    const T*   inData       = in.get();
+
+    if (dims.elements() == 0) return;
+
+    // MORPH_COLUMNS neighbouring columns of the same slice are filtered as
+    // the lines of a single pass
+    const dim_t groups = (dims[1] + MORPH_COLUMNS - 1) / MORPH_COLUMNS;
+    const dim_t work   = std::min(dims[1], MORPH_COLUMNS) * dims[0];
+    parallel_for(0, groups * dims[2] * dims[3], (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
+        std::vector<T> scratch;
+        for (dim_t t = lo; t < hi; t++) {
+            const dim_t b1 = (t % groups) * MORPH_COLUMNS;
+            const dim_t b2 = (t / groups) % dims[2];
+            const dim_t b3 = t / (groups * dims[2]);
+            vhgw<T, IsDilation>(outData + getIdx(ostrides, 0, b1, b2, b3), 1, ostrides[1],
+                                inData  + getIdx(istrides, 0, b1, b2, b3), istrides[0], istrides[1],
+                                dims[0], std::min(MORPH_COLUMNS, dims[1] - b1),
+                                window[0], window[0] / 2, scratch);
+        }
+    });
+
+    for (int d = 1; d < rank; d++) {
+        if (window[d] == 1) continue;
+
+        // Lines along d are the contiguous elements of all the lower dimensions
+        const dim_t lanes   = ostrides[d];
+        const dim_t tiles   = (lanes + MORPH_TILE - 1) / MORPH_TILE;
+        const dim_t batches = dims.elements() / (lanes * dims[d]);
+
+        parallel_for(0, batches * tiles, 1, [&](dim_t lo, dim_t hi) {
+            std::vector<T> scratch;
+            for (dim_t t = lo; t < hi; t++) {
+                const dim_t l0 = (t % tiles) * MORPH_TILE;
+                T *ptr = outData + (t / tiles) * ostrides[d + 1] + l0;
+                vhgw<T, IsDilation>(ptr, ostrides[d], 1, ptr, ostrides[d], 1, dims[d],
+                                    std::min(MORPH_TILE, lanes - l0),
+                                    window[d], window[d] / 2, scratch);
+            }
+        });
+    }
+}
+
 template<typename T, bool IsDilation>
 void morph(Array<T> out, Array<T> const in, Array<T> const mask)
 {
@@ -32,6 +178,11 @@ void morph(Array<T> out, Array<T> const in, Array<T> const mask)
     const dim_t R0      = window[0]/2;
     const dim_t R1      = window[1]/2;
 
+    if (isFlatMask(mask, 2)) {
+        morphFlat<T, IsDilation>(out, in, window, 2);
+        return;
+    }
+
     T init = IsDilation ? Binary<T, af_max_t>().init() : Binary<T, af_min_t>().init();
 
     for(dim_t b3=0; b3<dims[3]; ++b3) {
@@ -92,6 +243,11 @@ void morph3d(Array<T> out, Array<T> const in, Array<T> const mask)
     const T*   inData   = in.get();
     const T*   filter   = mask.get();
 
+    if (isFlatMask(mask, 3)) {
+        morphFlat<T, IsDilation>(out, in, window, 3);
+        return;
+    }
+
     T init = IsDilation ? Binary<T, af_max_t>().init() : Binary<T, af_min_t>().init();
 
     for(dim_t batchId=0; batchId<bCount; ++batchId) {
@@ -9,6 +9,13 @@
 
 #pragma once
 #include <Array.hpp>
+#include <blas.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace cpu
 {
@@ -19,9 +26,21 @@ namespace kernel
 
 #include <intrin.h>
 #define __builtin_popcount __popcnt
+#define __builtin_popcountll __popcnt64
 
 #endif
 
+/// Queries matched together against a block of the training set
+static const dim_t NN_QUERY_BLOCK = 512;
+/// Training descriptors per block, sized for the block to stay in cache
+static const dim_t NN_TRAIN_BLOCK = 2048;
+/// Descriptors shorter than this are matched without a matrix multiply
+static const dim_t NN_GEMM_MIN_LEN = 8;
+/// Extra candidates kept per query on the matrix multiply path. They are
+/// ranked again with the exact distance, which absorbs the rounding of
+/// the ||q||^2 + ||t||^2 - 2 q.t expansion.
+static const unsigned NN_RERANK_EXTRA = 8;
+
 template<typename T, typename To, af_match_type dist_type>
 struct dist_op
 {
@@ -63,7 +82,7 @@ struct dist_op<uintl, To, AF_SHD>
 {
     To operator()(uintl v1, uintl v2)
     {
-        return __builtin_popcount(v1 ^ v2);
+        return __builtin_popcountll(v1 ^ v2);
     }
 };
 
@@ -85,57 +104,254 @@ struct dist_op<ushort, To, AF_SHD>
     }
 };
 
+/// The best k (distance, index) pairs seen so far, kept as a max heap.
+/// Ties go to the lower index, as training samples arrive in order.
+template<typename To>
+class TopK
+{
+    typedef std::pair<To, uint> Entry;
+    std::vector<Entry> heap;
+    unsigned k;
+
+    public:
+    TopK() : k(0) {}
+
+    void reset(unsigned capacity)
+    {
+        k = capacity;
+        heap.clear();
+        heap.reserve(k);
+    }
+
+    void push(To d, uint i)
+    {
+        Entry e(d, i);
+        if (heap.size() < k) {
+            heap.push_back(e);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (e < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = e;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    std::vector<Entry> &entries() { return heap; }
+};
+
+/// Descriptors laid out one after the other, ld elements apart
+template<typename T>
+struct Descriptors
+{
+    std::vector<T> packed;
+    T const *ptr;
+    dim_t ld;
+    dim_t len;
+    dim_t count;
+
+    Descriptors(Array<T> const &in, uint dist_dim)
+    {
+        uint sample_dim = (dist_dim == 0) ? 1 : 0;
+        dim4 const dims    = in.dims();
+        dim4 const strides = in.strides();
+        len   = dims[dist_dim];
+        count = dims[sample_dim];
+
+        if (dist_dim == 0) {
+            ptr = in.get();
+            ld  = strides[1];
+            return;
+        }
+
+        // Samples along rows are gathered into columns
+        packed.resize(len * count);
+        T const *src = in.get();
+        for (dim_t k = 0; k < len; ++k) {
+            for (dim_t i = 0; i < count; ++i) {
+                packed[i * len + k] = src[k * strides[1] + i];
+            }
+        }
+        ptr = packed.data();
+        ld  = len;
+    }
+
+    T const *operator[](dim_t i) const { return ptr + i * ld; }
+};
+
+/// Bits of every descriptor packed into 64 bit words for Hamming distances
+template<typename T>
+struct BitDescriptors
+{
+    std::vector<uintl> words;
+    dim_t len;
+
+    BitDescriptors(Descriptors<T> const &d)
+    {
+        dim_t const bytes = d.len * sizeof(T);
+        len = (bytes + 7) / 8;
+        words.assign(len * d.count, 0);
+        for (dim_t i = 0; i < d.count; ++i) {
+            std::memcpy(&words[i * len], d[i], bytes);
+        }
+    }
+
+    uintl const *operator[](dim_t i) const { return &words[i * len]; }
+};
+
+inline uint popcount64(uintl x)
+{
+#if defined(__POPCNT__) || defined(_MSC_VER)
+    return (uint)__builtin_popcountll(x);
+#else
+    // Without the popcnt instruction the builtin is a library call, while
+    // this is inlined and vectorized over the words of a descriptor
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (uint)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline uint hamming(uintl const *a, uintl const *b, dim_t len)
+{
+    uint d = 0;
+    for (dim_t w = 0; w < len; ++w) d += popcount64(a[w] ^ b[w]);
+    return d;
+}
+
+template<typename T, typename To, af_match_type dist_type>
+To distance(T const *q, T const *t, dim_t len)
+{
+    dist_op<T, To, dist_type> op;
+    To d = 0;
+    for (dim_t k = 0; k < len; ++k) d += op(q[k], t[k]);
+    return d;
+}
+
+/// Matches blocks of queries against blocks of the training set, so that
+/// a training block is reused from cache by every query of the block
+template<typename To, typename DistF>
+void match_blocked(std::vector<TopK<To> > &best, dim_t nQuery, dim_t nTrain,
+                   dim_t len, DistF dist)
+{
+    parallel_for(0, nQuery, std::max<dim_t>(1, MIN_TASK_WORK / std::max<dim_t>(1, nTrain * len)),
+                 [&](dim_t qlo, dim_t qhi) {
+        for (dim_t q0 = qlo; q0 < qhi; q0 += NN_QUERY_BLOCK) {
+            dim_t const q1 = std::min(qhi, q0 + NN_QUERY_BLOCK);
+            for (dim_t t0 = 0; t0 < nTrain; t0 += NN_TRAIN_BLOCK) {
+                dim_t const t1 = std::min(nTrain, t0 + NN_TRAIN_BLOCK);
+                for (dim_t i = q0; i < q1; ++i) {
+                    TopK<To> &b = best[i];
+                    for (dim_t j = t0; j < t1; ++j) b.push(dist(i, j), (uint)j);
+                }
+            }
+        }
+    });
+}
+
+/// SSD through ||q||^2 + ||t||^2 - 2 q.t, with the dot products of a block
+/// of queries against a block of the training set done by a single GEMM
+template<typename T, typename To>
+void match_gemm(std::vector<TopK<To> > &best, Descriptors<T> const &query,
+                Descriptors<T> const &train, std::true_type)
+{
+    dim_t const len = query.len;
+    auto sqnorm = [len](T const *v) {
+        T s = 0;
+        for (dim_t k = 0; k < len; ++k) s += v[k] * v[k];
+        return s;
+    };
+
+    std::vector<T> qn(query.count), tn(train.count);
+    for (dim_t i = 0; i < query.count; ++i) qn[i] = sqnorm(query[i]);
+    for (dim_t j = 0; j < train.count; ++j) tn[j] = sqnorm(train[j]);
+
+    std::vector<T> dots(NN_QUERY_BLOCK * NN_TRAIN_BLOCK);
+    for (dim_t q0 = 0; q0 < query.count; q0 += NN_QUERY_BLOCK) {
+        dim_t const nq = std::min(NN_QUERY_BLOCK, query.count - q0);
+        for (dim_t t0 = 0; t0 < train.count; t0 += NN_TRAIN_BLOCK) {
+            dim_t const nt = std::min(NN_TRAIN_BLOCK, train.count - t0);
+
+            // dots(j, i) = t_j . q_i
+            gemm<T>(true, false, nt, nq, len,
+                    train[t0], train.ld, query[q0], query.ld,
+                    dots.data(), nt);
+
+            parallel_for(0, nq, std::max<dim_t>(1, MIN_TASK_WORK / nt),
+                         [&](dim_t lo, dim_t hi) {
+                for (dim_t i = lo; i < hi; ++i) {
+                    TopK<To> &b = best[q0 + i];
+                    T const *d = &dots[i * nt];
+                    for (dim_t j = 0; j < nt; ++j) {
+                        T ssd = std::max(T(0), qn[q0 + i] + tn[t0 + j] - 2 * d[j]);
+                        b.push(ssd, (uint)(t0 + j));
+                    }
+                }
+            });
+        }
+    }
+}
+
+template<typename T, typename To>
+void match_gemm(std::vector<TopK<To> > &, Descriptors<T> const &,
+                Descriptors<T> const &, std::false_type)
+{
+}
+
 template<typename T, typename To, af_match_type dist_type>
 void nearest_neighbour(Array<uint> idx, Array<To> dist,
                        const Array<T> query, const Array<T> train,
                        const uint dist_dim, const uint n_dist)
 {
-    uint sample_dim = (dist_dim == 0) ? 1 : 0;
-    const dim4 qDims = query.dims();
-    const dim4 tDims = train.dims();
+    Descriptors<T> const qDesc(query, dist_dim);
+    Descriptors<T> const tDesc(train, dist_dim);
+    dim_t const len    = qDesc.len;
+    dim_t const nQuery = qDesc.count;
+    dim_t const nTrain = tDesc.count;
+
+    bool const useGemm = dist_type == AF_SSD && std::is_floating_point<T>::value &&
+                         len >= NN_GEMM_MIN_LEN;
 
-    const unsigned distLength = qDims[dist_dim];
-    const unsigned nQuery = qDims[sample_dim];
-    const unsigned nTrain = tDims[sample_dim];
+    unsigned const keep = useGemm ? (unsigned)std::min<dim_t>(nTrain, n_dist + NN_RERANK_EXTRA)
+                                  : n_dist;
+    std::vector<TopK<To> > best(nQuery);
+    for (auto &b : best) b.reset(keep);
+
+    if (useGemm) {
+        match_gemm(best, qDesc, tDesc, std::is_floating_point<T>());
+    } else if (dist_type == AF_SHD) {
+        BitDescriptors<T> const qBits(qDesc), tBits(tDesc);
+        match_blocked(best, nQuery, nTrain, qBits.len, [&](dim_t i, dim_t j) {
+            return To(hamming(qBits[i], tBits[j], qBits.len));
+        });
+    } else {
+        match_blocked(best, nQuery, nTrain, len, [&](dim_t i, dim_t j) {
+            return distance<T, To, dist_type>(qDesc[i], tDesc[j], len);
+        });
+    }
 
-    const T* qPtr = query.get();
-    const T* tPtr = train.get();
     uint* iPtr = idx.get();
     To* dPtr = dist.get();
 
-    dist_op<T, To, dist_type> op;
+    parallel_for(0, nQuery, std::max<dim_t>(1, MIN_TASK_WORK / (keep * len)),
+                 [&](dim_t lo, dim_t hi) {
+        for (dim_t i = lo; i < hi; ++i) {
+            auto &e = best[i].entries();
 
-    for (unsigned i = 0; i < nQuery; i++) {
-        To best_dist = limit_max<To>();
-        unsigned best_idx  = 0;
-
-        for (unsigned j = 0; j < nTrain; j++) {
-            To local_dist = 0;
-            for (unsigned k = 0; k < distLength; k++) {
-                size_t qIdx, tIdx;
-                if (sample_dim == 0) {
-                    qIdx = k * qDims[0] + i;
-                    tIdx = k * tDims[0] + j;
+            // Candidates of the GEMM path get their exact distance back
+            if (useGemm) {
+                for (auto &c : e) {
+                    c.first = distance<T, To, dist_type>(qDesc[i], tDesc[c.second], len);
                 }
-                else {
-                    qIdx = i * qDims[0] + k;
-                    tIdx = j * tDims[0] + k;
-                }
-
-                local_dist += op(qPtr[qIdx], tPtr[tIdx]);
             }
+            std::sort(e.begin(), e.end());
 
-            if (local_dist < best_dist) {
-                best_dist = local_dist;
-                best_idx  = j;
+            for (unsigned r = 0; r < n_dist; ++r) {
+                iPtr[i * n_dist + r] = e[r].second;
+                dPtr[i * n_dist + r] = e[r].first;
             }
         }
-
-        size_t oIdx;
-        oIdx = i;
-        iPtr[oIdx] = best_idx;
-        dPtr[oIdx] = best_dist;
-    }
+    });
 }
 
 }
@@ -0,0 +1,127 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <Array.hpp>
+#include <kernel/sort_helper.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace cpu
+{
+namespace kernel
+{
+
+/// Moves the elements of rank [rlo, rhi) in keys[begin, end) to their sorted
+/// positions. Selecting the middle rank splits the range in two, the ranks
+/// below it being found on the left and the ones above on the right.
+template<typename U>
+void multi_select(U *keys, const dim_t begin, const dim_t end,
+                  const dim_t *rlo, const dim_t *rhi)
+{
+    if (rlo == rhi) return;
+    const dim_t *mid = rlo + (rhi - rlo) / 2;
+    std::nth_element(keys + begin, keys + *mid, keys + end);
+    multi_select(keys, begin, *mid, rlo, mid);
+    multi_select(keys, *mid + 1, end, mid + 1, rhi);
+}
+
+/// Linearly interpolated quantiles of every column of in along dim. Columns
+/// are copied to a buffer of radix keys, which orders NaNs the same way sort
+/// does, and only the ranks the quantiles need are selected.
+template<typename T, typename To>
+void quantile(Array<To> out, Array<T> const in, std::vector<double> const probs, int const dim)
+{
+    typedef radix_key<T> rkey;
+    typedef typename rkey::type U;
+
+    af::dim4 const idims    = in.dims();
+    af::dim4 const istrides = in.strides();
+    af::dim4 const ostrides = out.strides();
+
+    dim_t const len     = idims[dim];
+    dim_t const istride = istrides[dim];
+    dim_t const ostride = ostrides[dim];
+
+    // The remaining dimensions enumerate the columns
+    dim_t od[3], is[3], os[3];
+    for (int d = 0, k = 0; d < 4; ++d) {
+        if (d == dim) continue;
+        od[k] = idims[d];
+        is[k] = istrides[d];
+        os[k] = ostrides[d];
+        ++k;
+    }
+    dim_t const cols = od[0] * od[1] * od[2];
+
+    // Every quantile is read from the ranks lo and hi with weight frac for hi
+    size_t const nprobs = probs.size();
+    std::vector<dim_t> lo(nprobs), hi(nprobs);
+    std::vector<To> frac(nprobs);
+    for (size_t k = 0; k < nprobs; ++k) {
+        double const h = probs[k] * (len - 1);
+        lo[k]   = std::min<dim_t>((dim_t)std::floor(h), len - 1);
+        frac[k] = To(h - lo[k]);
+        hi[k]   = frac[k] == To(0) ? lo[k] : std::min(lo[k] + 1, len - 1);
+    }
+
+    std::vector<dim_t> ranks(lo);
+    ranks.insert(ranks.end(), hi.begin(), hi.end());
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+    T  const *iptr = in.get();
+    To       *optr = out.get();
+
+    auto column = [&](dim_t c, T const *&src, To *&dst) {
+        dim_t const c0 = c % od[0];
+        dim_t const c1 = (c / od[0]) % od[1];
+        dim_t const c2 = c / (od[0] * od[1]);
+        src = iptr + c0 * is[0] + c1 * is[1] + c2 * is[2];
+        dst = optr + c0 * os[0] + c1 * os[1] + c2 * os[2];
+    };
+
+    auto finish = [&](U const *keys, To *dst) {
+        for (size_t k = 0; k < nprobs; ++k) {
+            To const a = To(rkey::decode(keys[lo[k]]));
+            To const b = To(rkey::decode(keys[hi[k]]));
+            dst[k * ostride] = frac[k] == To(0) ? a : (To(1) - frac[k]) * a + frac[k] * b;
+        }
+    };
+
+    // A single long column is gathered in parallel
+    if (cols == 1) {
+        T const *src; To *dst;
+        column(0, src, dst);
+
+        std::vector<U> keys(len);
+        parallel_for(0, len, MIN_TASK_WORK, [&](dim_t b, dim_t e) {
+            for (dim_t i = b; i < e; ++i) keys[i] = rkey::encode(src[i * istride]);
+        });
+        multi_select(keys.data(), 0, len, ranks.data(), ranks.data() + ranks.size());
+        finish(keys.data(), dst);
+        return;
+    }
+
+    parallel_for(0, cols, (MIN_TASK_WORK + len - 1) / len, [&](dim_t b, dim_t e) {
+        std::vector<U> keys(len);
+        for (dim_t c = b; c < e; ++c) {
+            T const *src; To *dst;
+            column(c, src, dst);
+            for (dim_t i = 0; i < len; ++i) keys[i] = rkey::encode(src[i * istride]);
+            multi_select(keys.data(), 0, len, ranks.data(), ranks.data() + ranks.size());
+            finish(keys.data(), dst);
+        }
+    });
+}
+
+}
+}
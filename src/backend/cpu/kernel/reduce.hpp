@@ -9,62 +9,236 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
-template<af_op_t op, typename Ti, typename To, int D>
-struct reduce_dim
+// Spans longer than this are split in halves that are reduced separately.
+// Sums then accumulate rounding errors proportional to log(n) instead of n.
+static const dim_t REDUCE_BLOCK = 256;
+
+// Number of elements of a row reduced by a single task
+static const dim_t REDUCE_CHUNK = 1 << 16;
+
+// Number of outputs accumulated together when reducing along dim > 0
+static const dim_t REDUCE_TILE = 256;
+
+// Independent accumulators used on contiguous data so that the loop can be
+// vectorized
+static const int REDUCE_LANES = 8;
+
+// Combines n values pairwise. vals is overwritten.
+template<af_op_t op, typename To>
+To reduce_tree(To *vals, const dim_t n)
 {
-    void operator()(Array<To> out, const dim_t outOffset,
-                    const Array<Ti> in, const dim_t inOffset,
-                    const int dim, bool change_nan, double nanval)
-    {
-        static const int D1 = D - 1;
-        static reduce_dim<op, Ti, To, D1> reduce_dim_next;
-
-        const af::dim4 ostrides = out.strides();
-        const af::dim4 istrides = in.strides();
-        const af::dim4 odims    = out.dims();
-
-        for (dim_t i = 0; i < odims[D1]; i++) {
-            reduce_dim_next(out, outOffset + i * ostrides[D1],
-                            in, inOffset + i * istrides[D1],
-                            dim, change_nan, nanval);
+    Binary<To, op> reduce;
+    if (n == 0) return reduce.init();
+
+    for (dim_t width = 1; width < n; width *= 2) {
+        for (dim_t i = 0; i + width < n; i += 2 * width) {
+            vals[i] = reduce(vals[i], vals[i + width]);
         }
     }
-};
+    return vals[0];
+}
 
 template<af_op_t op, typename Ti, typename To>
-struct reduce_dim<op, Ti, To, 0>
+To reduce_span(Ti const * const in, const dim_t n, const dim_t stride,
+               bool change_nan, double nanval)
 {
+    Binary<To, op> reduce;
+
+    if (n > REDUCE_BLOCK) {
+        const dim_t half = n / 2;
+        To lhs = reduce_span<op, Ti, To>(in, half, stride, change_nan, nanval);
+        To rhs = reduce_span<op, Ti, To>(in + half * stride, n - half, stride,
+                                         change_nan, nanval);
+        return reduce(lhs, rhs);
+    }
 
     Transform<Ti, To, op> transform;
-    Binary<To, op> reduce;
-    void operator()(Array<To> out, const dim_t outOffset,
-                    const Array<Ti> in, const dim_t inOffset,
-                    const int dim, bool change_nan, double nanval)
-    {
-        const af::dim4 istrides = in.strides();
-        const af::dim4 idims    = in.dims();
-
-        To * const outPtr = out.get() + outOffset;
-        Ti const * const inPtr = in.get() + inOffset;
-        dim_t stride = istrides[dim];
-
-        To out_val = reduce.init();
-        for (dim_t i = 0; i < idims[dim]; i++) {
-            To in_val = transform(inPtr[i * stride]);
-            if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
-            out_val = reduce(in_val, out_val);
+
+    To acc[REDUCE_LANES];
+    for (int k = 0; k < REDUCE_LANES; k++) acc[k] = reduce.init();
+
+    dim_t i = 0;
+    if (stride == 1) {
+        for (; i + REDUCE_LANES <= n; i += REDUCE_LANES) {
+            for (int k = 0; k < REDUCE_LANES; k++) {
+                To in_val = transform(in[i + k]);
+                if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
+                acc[k] = reduce(in_val, acc[k]);
+            }
         }
+    }
 
-        *outPtr = out_val;
+    for (; i < n; i++) {
+        To in_val = transform(in[i * stride]);
+        if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
+        acc[0] = reduce(in_val, acc[0]);
     }
-};
 
+    return reduce_tree<op, To>(acc, REDUCE_LANES);
+}
+
+// Reduces every row of dims[0] elements in chunks of at most REDUCE_CHUNK
+// elements on the thread pool. The result of chunk c of row r is stored in
+// partial[r * chunks + c]. Returns the number of chunks per row.
+template<af_op_t op, typename Ti, typename To>
+dim_t reduce_chunks(std::vector<To> &partial, Ti const * const inPtr,
+                    const af::dim4 &dims, const af::dim4 &strides,
+                    bool change_nan, double nanval)
+{
+    const dim_t len    = dims[0];
+    const dim_t chunks = std::max<dim_t>((len + REDUCE_CHUNK - 1) / REDUCE_CHUNK, 1);
+    const dim_t rows   = dims[1] * dims[2] * dims[3];
+    const dim_t work   = std::max<dim_t>(std::min(len, REDUCE_CHUNK), 1);
+
+    partial.resize(rows * chunks);
+
+    parallel_for(0, rows * chunks, (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
+        for (dim_t t = lo; t < hi; t++) {
+            const dim_t r  = t / chunks;
+            const dim_t b1 = r % dims[1];
+            const dim_t b2 = (r / dims[1]) % dims[2];
+            const dim_t b3 = r / (dims[1] * dims[2]);
+            const dim_t off = (t % chunks) * REDUCE_CHUNK;
+
+            Ti const * const in = inPtr + b1 * strides[1] + b2 * strides[2] +
+                                  b3 * strides[3] + off * strides[0];
+
+            partial[t] = reduce_span<op, Ti, To>(in, std::min(REDUCE_CHUNK, len - off),
+                                                 strides[0], change_nan, nanval);
+        }
+    });
+
+    return chunks;
+}
+
+// Reduction along dim 0. Long rows are split across threads and the partial
+// results of each row are combined afterwards.
+template<af_op_t op, typename Ti, typename To>
+void reduce_first(Array<To> out, const Array<Ti> in, bool change_nan, double nanval)
+{
+    const af::dim4 odims    = out.dims();
+    const af::dim4 ostrides = out.strides();
+
+    std::vector<To> partial;
+    const dim_t chunks = reduce_chunks<op, Ti, To>(partial, in.get(), in.dims(), in.strides(),
+                                                   change_nan, nanval);
+
+    To * const outPtr = out.get();
+
+    for (dim_t b3 = 0; b3 < odims[3]; b3++) {
+        for (dim_t b2 = 0; b2 < odims[2]; b2++) {
+            for (dim_t b1 = 0; b1 < odims[1]; b1++) {
+                const dim_t r = b1 + odims[1] * (b2 + odims[2] * b3);
+                outPtr[b1 * ostrides[1] + b2 * ostrides[2] + b3 * ostrides[3]] =
+                    reduce_tree<op, To>(&partial[r * chunks], chunks);
+            }
+        }
+    }
+}
+
+// Reduction along dim > 0. Every task keeps accumulators for REDUCE_TILE
+// consecutive outputs and adds the input rows along dim to them, so the inner
+// loop walks contiguous memory instead of jumping by the stride of dim.
+template<af_op_t op, typename Ti, typename To>
+void reduce_strided(Array<To> out, const Array<Ti> in, const int dim,
+                    bool change_nan, double nanval)
+{
+    const af::dim4 odims    = out.dims();
+    const af::dim4 ostrides = out.strides();
+    const af::dim4 idims    = in.dims();
+    const af::dim4 istrides = in.strides();
+
+    const dim_t len     = idims[dim];
+    const dim_t dstride = istrides[dim];
+    const dim_t s0      = istrides[0];
+    const dim_t tiles   = (odims[0] + REDUCE_TILE - 1) / REDUCE_TILE;
+    const dim_t batches = odims[1] * odims[2] * odims[3];
+    const dim_t work    = std::max<dim_t>(std::min(odims[0], REDUCE_TILE) * len, 1);
+
+    To * const outPtr = out.get();
+    Ti const * const inPtr = in.get();
+
+    parallel_for(0, batches * tiles, (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
+        Transform<Ti, To, op> transform;
+        Binary<To, op> reduce;
+
+        To acc[REDUCE_TILE];
+        To blk[REDUCE_TILE];
+
+        for (dim_t t = lo; t < hi; t++) {
+            const dim_t b  = t / tiles;
+            const dim_t b1 = b % odims[1];
+            const dim_t b2 = (b / odims[1]) % odims[2];
+            const dim_t b3 = b / (odims[1] * odims[2]);
+            const dim_t i0 = (t % tiles) * REDUCE_TILE;
+            const dim_t n  = std::min(REDUCE_TILE, odims[0] - i0);
+
+            Ti const * const base = inPtr + b1 * istrides[1] + b2 * istrides[2] +
+                                    b3 * istrides[3] + i0 * s0;
+
+            for (dim_t i = 0; i < n; i++) acc[i] = reduce.init();
+
+            // Blocks of rows are reduced separately to limit rounding errors
+            for (dim_t j0 = 0; j0 < len; j0 += REDUCE_BLOCK) {
+                const dim_t j1 = std::min(j0 + REDUCE_BLOCK, len);
+
+                for (dim_t i = 0; i < n; i++) blk[i] = reduce.init();
+
+                for (dim_t j = j0; j < j1; j++) {
+                    Ti const * const row = base + j * dstride;
+                    if (s0 == 1) {
+                        for (dim_t i = 0; i < n; i++) {
+                            To in_val = transform(row[i]);
+                            if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
+                            blk[i] = reduce(in_val, blk[i]);
+                        }
+                    } else {
+                        for (dim_t i = 0; i < n; i++) {
+                            To in_val = transform(row[i * s0]);
+                            if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
+                            blk[i] = reduce(in_val, blk[i]);
+                        }
+                    }
+                }
+
+                for (dim_t i = 0; i < n; i++) acc[i] = reduce(acc[i], blk[i]);
+            }
+
+            To * const o = outPtr + b1 * ostrides[1] + b2 * ostrides[2] +
+                           b3 * ostrides[3] + i0;
+            for (dim_t i = 0; i < n; i++) o[i] = acc[i];
+        }
+    });
+}
+
+template<af_op_t op, typename Ti, typename To>
+To reduce_all(const Array<Ti> in, bool change_nan, double nanval)
+{
+    af::dim4 dims    = in.dims();
+    af::dim4 strides = in.strides();
+
+    // Linear arrays are reduced as a single row
+    if (in.isLinear()) {
+        dims    = af::dim4(in.elements(), 1, 1, 1);
+        strides = af::dim4(1, in.elements(), in.elements(), in.elements());
+    }
+
+    std::vector<To> partial;
+    reduce_chunks<op, Ti, To>(partial, in.get(), dims, strides, change_nan, nanval);
+
+    return reduce_tree<op, To>(partial.data(), partial.size());
+}
 
 }
 }
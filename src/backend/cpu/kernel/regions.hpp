@@ -9,181 +9,163 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
-template<typename T>
-class LabelNode
+// Union-find over the pixels of an image stored as a flat array of parent
+// indices. The root of every set is its pixel with the smallest index, which
+// is the first pixel of the region in scan order.
+class PixelSets
 {
-private:
-    T label;
-    T minLabel;
-    unsigned rank;
-    LabelNode* parent;
+    std::vector<uint> parent;
 
 public:
-    LabelNode() : label(0), minLabel(0), rank(0), parent(this) { }
-    LabelNode(T label) : label(label), minLabel(label), rank(0), parent(this) { }
+    explicit PixelSets(dim_t n) : parent(n) { }
 
-    T getLabel()
-    {
-        return label;
-    }
+    void make(uint x) { parent[x] = x; }
 
-    T getMinLabel()
-    {
-        return minLabel;
-    }
+    bool isRoot(uint x) const { return parent[x] == x; }
 
-    LabelNode* getParent()
+    // Does not compress paths, so it can be called from several threads
+    uint root(uint x) const
     {
-        return parent;
+        while (parent[x] != x) x = parent[x];
+        return x;
     }
 
-    unsigned getRank()
+    uint find(uint x)
     {
-        return rank;
-    }
-
-    void setMinLabel(T l)
-    {
-        minLabel = l;
-    }
-
-    void setParent(LabelNode* p)
-    {
-        parent = p;
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
     }
 
-    void setRank(unsigned r)
+    void unite(uint x, uint y)
     {
-        rank = r;
+        x = find(x);
+        y = find(y);
+        if (x < y) parent[y] = x;
+        else if (y < x) parent[x] = y;
     }
 };
 
-template<typename T>
-static LabelNode<T>* find(LabelNode<T>* x)
-{
-    if (x->getParent() != x)
-        x->setParent(find(x->getParent()));
-    return x->getParent();
-}
-
-template<typename T>
-static void setUnion(LabelNode<T>* x, LabelNode<T>* y)
-{
-    LabelNode<T>* xRoot = find(x);
-    LabelNode<T>* yRoot = find(y);
-    if (xRoot == yRoot)
-        return;
-
-    T xMinLabel = xRoot->getMinLabel();
-    T yMinLabel = yRoot->getMinLabel();
-    xRoot->setMinLabel(min(xMinLabel, yMinLabel));
-    yRoot->setMinLabel(min(xMinLabel, yMinLabel));
-
-    if (xRoot->getRank() < yRoot->getRank())
-        xRoot->setParent(yRoot);
-    else if (xRoot->getRank() > yRoot->getRank())
-        yRoot->setParent(xRoot);
-    else {
-        yRoot->setParent(xRoot);
-        xRoot->setRank(xRoot->getRank() + 1);
-    }
-}
-
+// Two pass labeling of every 2D image of the batch. The columns of an image
+// are split in stripes labeled in parallel, the sets of neighbouring stripes
+// are merged along their border and the regions are numbered in the order of
+// their first pixel.
 template<typename T>
 void regions(Array<T> out, const Array<char> in, af_connectivity connectivity)
 {
-    const af::dim4 in_dims = in.dims();
-    const char *in_ptr  = in.get();
-    T    *out_ptr = out.get();
-
-    // Map labels
-    typedef typename std::map<T, LabelNode<T>* > label_map_t;
-    typedef typename label_map_t::iterator label_map_iterator_t;
-
-    label_map_t lmap;
-
-    // Initial label
-    T label = (T)1;
-
-    for (int j = 0; j < (int)in_dims[1]; j++) {
-        for (int i = 0; i < (int)in_dims[0]; i++) {
-            int idx = j * in_dims[0] + i;
-            if (in_ptr[idx] != 0) {
-                std::vector<T> l;
-
-                // Test neighbors
-                if (i > 0 && out_ptr[j * (int)in_dims[0] + i-1] > 0)
-                    l.push_back(out_ptr[j * in_dims[0] + i-1]);
-                if (j > 0 && out_ptr[(j-1) * (int)in_dims[0] + i] > 0)
-                    l.push_back(out_ptr[(j-1) * in_dims[0] + i]);
-                if (connectivity == AF_CONNECTIVITY_8 && i > 0 &&
-                        j > 0 && out_ptr[(j-1) * in_dims[0] + i-1] > 0)
-                    l.push_back(out_ptr[(j-1) * in_dims[0] + i-1]);
-                if (connectivity == AF_CONNECTIVITY_8 &&
-                        i < (int)in_dims[0] - 1 && j > 0 && out_ptr[(j-1) * in_dims[0] + i+1] != 0)
-                    l.push_back(out_ptr[(j-1) * in_dims[0] + i+1]);
-
-                if (!l.empty()) {
-                    T minl = l[0];
-                    for (size_t k = 0; k < l.size(); k++) {
-                        minl = min(l[k], minl);
-                        label_map_iterator_t cur_map = lmap.find(l[k]);
-                        LabelNode<T> *node = cur_map->second;
-                        // Group labels of the same region under a disjoint set
-                        for (size_t m = k+1; m < l.size(); m++)
-                            setUnion(node, lmap.find(l[m])->second);
+    const af::dim4 dims     = in.dims();
+    const af::dim4 istrides = in.strides();
+    const af::dim4 ostrides = out.strides();
+    const bool     full     = (connectivity == AF_CONNECTIVITY_8);
+
+    const dim_t n0 = dims[0], n1 = dims[1];
+    const dim_t pixels = n0 * n1;
+    if (pixels == 0) return;
+
+    const dim_t tasks   = 4 * getThreadPool().size();
+    const dim_t stripe  = std::max((n1 + tasks - 1) / tasks,
+                                   std::max<dim_t>(1, MIN_TASK_WORK / n0));
+    const dim_t stripes = (n1 + stripe - 1) / stripe;
+
+    PixelSets sets(pixels);
+    std::vector<uint> first(stripes + 1);
+
+    for (dim_t b3 = 0; b3 < dims[3]; b3++) {
+        for (dim_t b2 = 0; b2 < dims[2]; b2++) {
+            const char *in_ptr  = in.get()  + b2 * istrides[2] + b3 * istrides[3];
+                  T    *out_ptr = out.get() + b2 * ostrides[2] + b3 * ostrides[3];
+
+            auto fg = [&](dim_t i, dim_t j) {
+                return in_ptr[i * istrides[0] + j * istrides[1]] != 0;
+            };
+
+            // Links a foreground pixel to its neighbours in the previous column
+            auto linkLeft = [&](dim_t i, dim_t j) {
+                const uint p = i + j * n0;
+                if (fg(i, j - 1)) sets.unite(p, p - n0);
+                if (full && i > 0      && fg(i - 1, j - 1)) sets.unite(p, p - n0 - 1);
+                if (full && i < n0 - 1 && fg(i + 1, j - 1)) sets.unite(p, p - n0 + 1);
+            };
+
+            parallel_for(0, stripes, 1, [&](dim_t lo, dim_t hi) {
+                for (dim_t s = lo; s < hi; s++) {
+                    const dim_t j0 = s * stripe;
+                    const dim_t j1 = std::min(j0 + stripe, n1);
+                    for (dim_t j = j0; j < j1; j++) {
+                        for (dim_t i = 0; i < n0; i++) {
+                            if (!fg(i, j)) continue;
+                            const uint p = i + j * n0;
+                            sets.make(p);
+                            if (i > 0 && fg(i - 1, j)) sets.unite(p, p - 1);
+                            if (j > j0) linkLeft(i, j);
+                        }
                     }
-                    // Set label to smallest neighbor label
-                    out_ptr[idx] = minl;
-                }
-                else {
-                    // Insert new label in map
-                    LabelNode<T> *node = new LabelNode<T>(label);
-                    lmap.insert(std::pair<T, LabelNode<T>* >(label, node));
-                    out_ptr[idx] = label++;
                 }
-            }
-        }
-    }
-
-    std::set<T> removed;
+            });
 
-    for (int j = 0; j < (int)in_dims[1]; j++) {
-        for (int i = 0; i < (int)in_dims[0]; i++) {
-            int idx = j * (int)in_dims[0] + i;
-            if (in_ptr[idx] != 0) {
-                T l = out_ptr[idx];
-                label_map_iterator_t cur_map = lmap.find(l);
-
-                if (cur_map != lmap.end()) {
-                    LabelNode<T>* node = cur_map->second;
-
-                    LabelNode<T>* node_root = find(node);
-                    out_ptr[idx] = node_root->getMinLabel();
-
-                    // Mark removed labels (those that are part of a region
-                    // that contains a smaller label)
-                    if (node->getMinLabel() < l || node_root->getMinLabel() < l)
-                        removed.insert(l);
-                    if (node->getLabel() > node->getMinLabel())
-                        removed.insert(node->getLabel());
+            // Stripes only touch the sets of their own pixels until here
+            for (dim_t s = 1; s < stripes; s++) {
+                const dim_t j = s * stripe;
+                for (dim_t i = 0; i < n0; i++) {
+                    if (fg(i, j)) linkLeft(i, j);
                 }
             }
-        }
-    }
 
-    // Calculate final neighbors (ensure final labels are sequential)
-    for (int j = 0; j < (int)in_dims[1]; j++) {
-        for (int i = 0; i < (int)in_dims[0]; i++) {
-            int idx = j * (int)in_dims[0] + i;
-            if (out_ptr[idx] > 0) {
-                out_ptr[idx] -= distance(removed.begin(), removed.lower_bound(out_ptr[idx]));
+            // Count the regions starting in every stripe to number them in
+            // scan order
+            parallel_for(0, stripes, 1, [&](dim_t lo, dim_t hi) {
+                for (dim_t s = lo; s < hi; s++) {
+                    const dim_t j0 = s * stripe;
+                    const dim_t j1 = std::min(j0 + stripe, n1);
+                    uint count = 0;
+                    for (dim_t j = j0; j < j1; j++) {
+                        for (dim_t i = 0; i < n0; i++) {
+                            if (fg(i, j) && sets.isRoot(i + j * n0)) count++;
+                        }
+                    }
+                    first[s + 1] = count;
+                }
+            });
+
+            first[0] = 1;
+            for (dim_t s = 0; s < stripes; s++) first[s + 1] += first[s];
+
+            auto label = [&](uint p) -> T& {
+                return out_ptr[(p % n0) * ostrides[0] + (p / n0) * ostrides[1]];
+            };
+
+            // Roots are labeled first since other stripes read their labels
+            for (int pass = 0; pass < 2; pass++) {
+                parallel_for(0, stripes, 1, [&](dim_t lo, dim_t hi) {
+                    for (dim_t s = lo; s < hi; s++) {
+                        const dim_t j0 = s * stripe;
+                        const dim_t j1 = std::min(j0 + stripe, n1);
+                        uint next = first[s];
+                        for (dim_t j = j0; j < j1; j++) {
+                            for (dim_t i = 0; i < n0; i++) {
+                                const uint p = i + j * n0;
+                                if (!fg(i, j)) {
+                                    if (pass == 0) label(p) = (T)0;
+                                } else if (sets.isRoot(p)) {
+                                    if (pass == 0) label(p) = (T)next++;
+                                } else if (pass == 1) {
+                                    label(p) = label(sets.root(p));
+                                }
+                            }
+                        }
+                    }
+                });
             }
         }
     }
@@ -9,73 +9,177 @@
 
 #pragma once
 #include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <vector>
 
 namespace cpu
 {
 namespace kernel
 {
 
-template<af_op_t op, typename Ti, typename To, int D, bool inclusive_scan>
-struct scan_dim
+// Number of elements of a line scanned by a single task
+static const dim_t SCAN_CHUNK = 1 << 16;
+
+// Number of lines scanned together when scanning along dim > 0
+static const dim_t SCAN_TILE = 256;
+
+// Scans n elements starting from carry. Returns the carry for the elements
+// that follow.
+template<af_op_t op, typename Ti, typename To, bool inclusive_scan>
+To scan_span(To * const out, const dim_t ostride,
+             Ti const * const in, const dim_t istride,
+             const dim_t n, To carry)
 {
-    void operator()(Array<To> out, dim_t outOffset,
-                    const Array<Ti> in, dim_t inOffset,
-                    const int dim) const
-    {
-        const dim4 odims    = out.dims();
-        const dim4 ostrides = out.strides();
-        const dim4 istrides = in.strides();
-
-        const int D1 = D - 1;
-        for (dim_t i = 0; i < odims[D1]; i++) {
-            scan_dim<op, Ti, To, D1, inclusive_scan> func;
-            getQueue().enqueue(func,
-                    out, outOffset + i * ostrides[D1],
-                    in, inOffset + i * istrides[D1], dim);
-            if (D1 == dim) break;
+    Transform<Ti, To, op> transform;
+    // FIXME: Change the name to something better
+    Binary<To, op> scan;
+
+    for (dim_t i = 0; i < n; i++) {
+        To in_val = transform(in[i * istride]);
+        if (!inclusive_scan) out[i * ostride] = carry;
+        carry = scan(in_val, carry);
+        if (inclusive_scan) out[i * ostride] = carry;
+    }
+    return carry;
+}
+
+template<af_op_t op, typename Ti, typename To>
+To scan_total(Ti const * const in, const dim_t istride, const dim_t n)
+{
+    Transform<Ti, To, op> transform;
+    Binary<To, op> scan;
+
+    To total = scan.init();
+    for (dim_t i = 0; i < n; i++) {
+        total = scan(transform(in[i * istride]), total);
+    }
+    return total;
+}
+
+// Scan along dim when all the dimensions before dim are 1, which includes
+// dim 0. Lines are split into chunks of SCAN_CHUNK elements and scanned in
+// three phases: the totals of all chunks are computed in parallel, the totals
+// of every line are scanned to get the carry into each chunk, and the chunks
+// are scanned in parallel starting from their carry.
+template<af_op_t op, typename Ti, typename To, bool inclusive_scan>
+void scan_first(Array<To> out, const Array<Ti> in, const int dim)
+{
+    af::dim4 dims     = in.dims();
+    af::dim4 istrides = in.strides();
+    af::dim4 ostrides = out.strides();
+
+    std::swap(dims[0], dims[dim]);
+    std::swap(istrides[0], istrides[dim]);
+    std::swap(ostrides[0], ostrides[dim]);
+
+    const dim_t len    = dims[0];
+    const dim_t chunks = std::max<dim_t>((len + SCAN_CHUNK - 1) / SCAN_CHUNK, 1);
+    const dim_t lines  = dims[1] * dims[2] * dims[3];
+    const dim_t work   = std::max<dim_t>(std::min(len, SCAN_CHUNK), 1);
+    const dim_t grain  = (MIN_TASK_WORK + work - 1) / work;
+
+    To * const outPtr = out.get();
+    Ti const * const inPtr = in.get();
+
+    Binary<To, op> scan;
+    std::vector<To> carry(lines * chunks, scan.init());
+
+    auto offset = [&](const af::dim4 &strides, dim_t t) {
+        const dim_t r  = t / chunks;
+        const dim_t b1 = r % dims[1];
+        const dim_t b2 = (r / dims[1]) % dims[2];
+        const dim_t b3 = r / (dims[1] * dims[2]);
+        return (b1 * strides[1] + b2 * strides[2] + b3 * strides[3] +
+                (t % chunks) * SCAN_CHUNK * strides[0]);
+    };
+
+    if (chunks > 1) {
+        parallel_for(0, lines * chunks, grain, [&](dim_t lo, dim_t hi) {
+            for (dim_t t = lo; t < hi; t++) {
+                const dim_t n = std::min(SCAN_CHUNK, len - (t % chunks) * SCAN_CHUNK);
+                carry[t] = scan_total<op, Ti, To>(inPtr + offset(istrides, t),
+                                                  istrides[0], n);
+            }
+        });
+
+        for (dim_t r = 0; r < lines; r++) {
+            To running = scan.init();
+            for (dim_t c = 0; c < chunks; c++) {
+                To total = carry[r * chunks + c];
+                carry[r * chunks + c] = running;
+                running = scan(total, running);
+            }
         }
     }
-};
 
+    parallel_for(0, lines * chunks, grain, [&](dim_t lo, dim_t hi) {
+        for (dim_t t = lo; t < hi; t++) {
+            const dim_t n = std::min(SCAN_CHUNK, len - (t % chunks) * SCAN_CHUNK);
+            scan_span<op, Ti, To, inclusive_scan>(outPtr + offset(ostrides, t), ostrides[0],
+                                                  inPtr + offset(istrides, t), istrides[0],
+                                                  n, carry[t]);
+        }
+    });
+}
+
+// Scan along dim > 0. Every task keeps the carries of SCAN_TILE consecutive
+// lines and sweeps the input row by row, so memory is read contiguously
+// instead of jumping by the stride of dim.
 template<af_op_t op, typename Ti, typename To, bool inclusive_scan>
-struct scan_dim<op, Ti, To, 0, inclusive_scan>
+void scan_strided(Array<To> out, const Array<Ti> in, const int dim)
 {
-    void operator()(Array<To> output, dim_t outOffset,
-                    const Array<Ti> input,  dim_t inOffset,
-                    const int dim) const
-    {
-        const Ti* in = input.get() + inOffset;
-              To* out= output.get()+ outOffset;
+    const af::dim4 dims     = in.dims();
+    const af::dim4 istrides = in.strides();
+    const af::dim4 ostrides = out.strides();
+
+    af::dim4 bdims = dims;
+    bdims[dim] = 1;
 
-        const dim4 ostrides = output.strides();
-        const dim4 istrides = input.strides();
-        const dim4 idims    = input.dims();
+    const dim_t len     = dims[dim];
+    const dim_t tiles   = (dims[0] + SCAN_TILE - 1) / SCAN_TILE;
+    const dim_t batches = bdims[1] * bdims[2] * bdims[3];
+    const dim_t work    = std::max<dim_t>(std::min(dims[0], SCAN_TILE) * len, 1);
+    const dim_t is0     = istrides[0];
 
-        dim_t istride = istrides[dim];
-        dim_t ostride = ostrides[dim];
+    To * const outPtr = out.get();
+    Ti const * const inPtr = in.get();
 
+    parallel_for(0, batches * tiles, (MIN_TASK_WORK + work - 1) / work,
+                 [&](dim_t lo, dim_t hi) {
         Transform<Ti, To, op> transform;
-        // FIXME: Change the name to something better
         Binary<To, op> scan;
 
-        To out_val = scan.init();
-        for (dim_t i = 0; i < idims[dim]; i++) {
-            To in_val = transform(in[i * istride]);
-            out_val = scan(in_val, out_val);
-            if (!inclusive_scan) {
-                //The loop shifts the output index by 1.
-                //The last index wraps around and writes the first element.
-                if (i == (idims[dim] - 1)) {
-                    out[0] = scan.init();
-                } else {
-                    out[(i + 1) * ostride] = out_val;
+        To carry[SCAN_TILE];
+
+        for (dim_t t = lo; t < hi; t++) {
+            const dim_t b  = t / tiles;
+            const dim_t b1 = b % bdims[1];
+            const dim_t b2 = (b / bdims[1]) % bdims[2];
+            const dim_t b3 = b / (bdims[1] * bdims[2]);
+            const dim_t i0 = (t % tiles) * SCAN_TILE;
+            const dim_t n  = std::min(SCAN_TILE, dims[0] - i0);
+
+            Ti const *iptr = inPtr + b1 * istrides[1] + b2 * istrides[2] +
+                           b3 * istrides[3] + i0 * is0;
+            To *optr = outPtr + b1 * ostrides[1] + b2 * ostrides[2] +
+                      b3 * ostrides[3] + i0;
+
+            for (dim_t i = 0; i < n; i++) carry[i] = scan.init();
+
+            for (dim_t j = 0; j < len; j++) {
+                for (dim_t i = 0; i < n; i++) {
+                    To in_val = transform(iptr[i * is0]);
+                    if (!inclusive_scan) optr[i] = carry[i];
+                    carry[i] = scan(in_val, carry[i]);
+                    if (inclusive_scan) optr[i] = carry[i];
                 }
-            } else {
-                out[i * ostride] = out_val;
+                iptr += istrides[dim];
+                optr += ostrides[dim];
             }
         }
-    }
-};
+    });
+}
 
 }
 }
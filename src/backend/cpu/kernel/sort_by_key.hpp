@@ -19,9 +19,6 @@ namespace kernel
 template<typename Tk, typename Tv>
 void sort0ByKeyIterative(Array<Tk> okey, Array<Tv> oval, bool isAscending);
 
-template<typename Tk, typename Tv>
-void sortByKeyBatched(Array<Tk> okey, Array<Tv> oval, const int dim, bool isAscending);
-
 template<typename Tk, typename Tv>
 void sort0ByKey(Array<Tk> okey, Array<Tv> oval, bool isAscending);
 
@@ -7,54 +7,302 @@
  * http://arrayfire.com/licenses/BSD-3-Clause
  ********************************************************/
 
-#include <err_cpu.hpp>
+#pragma once
+#include <Array.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
 
 namespace cpu
 {
-    namespace kernel
+namespace kernel
+{
+
+// Columns up to this length are sorted by insertion
+static const dim_t SORT_INSERTION_MAX = 32;
+
+// Single columns at least this long are split across threads
+static const dim_t SORT_PARALLEL_MIN = 1 << 16;
+
+static const int RADIX_BITS = 8;
+static const int RADIX_SIZE = 1 << RADIX_BITS;
+
+// Maps keys to unsigned integers with the same ordering
+template<typename T, bool is_float = std::is_floating_point<T>::value>
+struct radix_key
+{
+    typedef typename std::make_unsigned<T>::type type;
+
+    static type sign() { return std::is_signed<T>::value ? type(type(1) << (8 * sizeof(type) - 1)) : type(0); }
+    static type encode(T val) { return type(type(val) ^ sign()); }
+    static T decode(type val) { return T(type(val ^ sign())); }
+};
+
+// Negative floating point numbers have all their bits flipped and positive
+// ones only the sign bit
+template<typename T>
+struct radix_key<T, true>
+{
+    typedef typename std::conditional<sizeof(T) == 4, uint, uintl>::type type;
+
+    static type sign() { return type(1) << (8 * sizeof(type) - 1); }
+
+    static type encode(T val)
     {
-        template <typename Tk, typename Tv>
-        using IndexPair = std::tuple<Tk, Tv>;
-
-        template <typename Tk, typename Tv, bool isAscending>
-        struct IPCompare
-        {
-            bool operator()(const IndexPair<Tk, Tv> &lhs, const IndexPair<Tk, Tv> &rhs)
-            {
-                // Check stable sort condition
-                Tk lhsVal = std::get<0>(lhs);
-                Tk rhsVal = std::get<0>(rhs);
-                if(isAscending) return (lhsVal < rhsVal);
-                else return (lhsVal > rhsVal);
-            }
-        };
-
-        template <typename Tk, typename Tv>
-        using KeyIndexPair = std::tuple<Tk, Tv, uint>;
-
-        template <typename Tk, typename Tv, bool isAscending>
-        struct KIPCompareV
-        {
-            bool operator()(const KeyIndexPair<Tk, Tv> &lhs, const KeyIndexPair<Tk, Tv> &rhs)
-            {
-                // Check stable sort condition
-                Tk lhsVal = std::get<0>(lhs);
-                Tk rhsVal = std::get<0>(rhs);
-                if(isAscending) return (lhsVal < rhsVal);
-                else return (lhsVal > rhsVal);
+        type bits;
+        std::memcpy(&bits, &val, sizeof(T));
+        return (bits & sign()) ? ~bits : (bits | sign());
+    }
+
+    static T decode(type bits)
+    {
+        bits = (bits & sign()) ? (bits & ~sign()) : ~bits;
+        T val;
+        std::memcpy(&val, &bits, sizeof(T));
+        return val;
+    }
+};
+
+// The sorting functions below work on encoded keys. vals may be null, in
+// which case only the keys are sorted.
+
+template<typename U, typename Tv>
+void insertion_sort(U *keys, Tv *vals, const dim_t n)
+{
+    for (dim_t i = 1; i < n; i++) {
+        U  key = keys[i];
+        Tv val = vals ? vals[i] : Tv();
+        dim_t j = i;
+        for (; j > 0 && key < keys[j - 1]; j--) {
+            keys[j] = keys[j - 1];
+            if (vals) vals[j] = vals[j - 1];
+        }
+        keys[j] = key;
+        if (vals) vals[j] = val;
+    }
+}
+
+// Stable LSD radix sort using tkeys and tvals as scratch space. Digits shared
+// by all the keys are skipped.
+template<typename U, typename Tv>
+void radix_sort(U *keys, Tv *vals, U *tkeys, Tv *tvals, const dim_t n)
+{
+    if (n <= SORT_INSERTION_MAX) {
+        insertion_sort(keys, vals, n);
+        return;
+    }
+
+    const int passes = (8 * sizeof(U)) / RADIX_BITS;
+
+    std::vector<dim_t> counts(passes * RADIX_SIZE, 0);
+    for (dim_t i = 0; i < n; i++) {
+        const U key = keys[i];
+        for (int p = 0; p < passes; p++) {
+            counts[p * RADIX_SIZE + ((key >> (p * RADIX_BITS)) & (RADIX_SIZE - 1))]++;
+        }
+    }
+
+    U  *src_k = keys,  *dst_k = tkeys;
+    Tv *src_v = vals,  *dst_v = tvals;
+
+    for (int p = 0; p < passes; p++) {
+        const int shift = p * RADIX_BITS;
+        dim_t *offset = &counts[p * RADIX_SIZE];
+
+        if (offset[(src_k[0] >> shift) & (RADIX_SIZE - 1)] == n) continue;
+
+        dim_t sum = 0;
+        for (int d = 0; d < RADIX_SIZE; d++) {
+            const dim_t count = offset[d];
+            offset[d] = sum;
+            sum += count;
+        }
+
+        for (dim_t i = 0; i < n; i++) {
+            const dim_t o = offset[(src_k[i] >> shift) & (RADIX_SIZE - 1)]++;
+            dst_k[o] = src_k[i];
+            if (vals) dst_v[o] = src_v[i];
+        }
+
+        std::swap(src_k, dst_k);
+        std::swap(src_v, dst_v);
+    }
+
+    if (src_k != keys) {
+        std::copy(src_k, src_k + n, keys);
+        if (vals) std::copy(src_v, src_v + n, vals);
+    }
+}
+
+// Number of elements taken from a in the first d elements of the stable merge
+// of a and b
+template<typename U>
+dim_t merge_split(const U *a, const dim_t na, const U *b, const dim_t nb, const dim_t d)
+{
+    dim_t lo = std::max<dim_t>(0, d - nb);
+    dim_t hi = std::min(d, na);
+    while (lo < hi) {
+        const dim_t i = lo + (hi - lo) / 2;
+        if (b[d - i - 1] < a[i]) hi = i;
+        else                     lo = i + 1;
+    }
+    return lo;
+}
+
+// Output elements [d0, d1) of the stable merge of a and b
+template<typename U, typename Tv>
+void merge_range(const U *ak, const Tv *av, const dim_t na,
+                 const U *bk, const Tv *bv, const dim_t nb,
+                 U *ok, Tv *ov, const dim_t d0, const dim_t d1)
+{
+    dim_t i = merge_split(ak, na, bk, nb, d0);
+    dim_t j = d0 - i;
+    const dim_t ie = merge_split(ak, na, bk, nb, d1);
+    const dim_t je = d1 - ie;
+
+    for (dim_t o = d0; o < d1; o++) {
+        if (j < je && (i == ie || bk[j] < ak[i])) {
+            ok[o] = bk[j];
+            if (ov) ov[o] = bv[j];
+            j++;
+        } else {
+            ok[o] = ak[i];
+            if (ov) ov[o] = av[i];
+            i++;
+        }
+    }
+}
+
+// Sorts a single column on the thread pool. Runs of the column are radix
+// sorted in parallel and merged in pairs, every merge being split in pieces
+// of similar size.
+template<typename U, typename Tv>
+void parallel_sort(U *keys, Tv *vals, U *tkeys, Tv *tvals, const dim_t n)
+{
+    thread_pool &pool = getThreadPool();
+    const dim_t runs  = std::max<dim_t>(1, std::min<dim_t>(pool.size(), n / SORT_PARALLEL_MIN));
+    const dim_t piece = std::max<dim_t>(n / (4 * pool.size()), MIN_TASK_WORK);
+
+    std::vector<dim_t> bounds(runs + 1);
+    for (dim_t r = 0; r <= runs; r++) bounds[r] = n * r / runs;
+
+    auto at = [](Tv *ptr, dim_t off) { return ptr ? ptr + off : ptr; };
+
+    parallel_for(0, runs, 1, [&](dim_t lo, dim_t hi) {
+        for (dim_t r = lo; r < hi; r++) {
+            const dim_t off = bounds[r];
+            radix_sort(keys + off, at(vals, off), tkeys + off, at(tvals, off),
+                       bounds[r + 1] - off);
+        }
+    });
+
+    U  *src_k = keys,  *dst_k = tkeys;
+    Tv *src_v = vals,  *dst_v = tvals;
+
+    while (bounds.size() > 2) {
+        // (first run of the pair, start, end) of the output of every piece
+        std::vector<dim_t> tasks;
+        for (size_t r = 0; r + 1 < bounds.size(); r += 2) {
+            const dim_t end = bounds[std::min(r + 2, bounds.size() - 1)];
+            for (dim_t d = bounds[r]; d < end; d += piece) {
+                tasks.push_back(r);
+                tasks.push_back(d);
+                tasks.push_back(std::min(d + piece, end));
             }
-        };
-
-        template <typename Tk, typename Tv, bool isAscending>
-        struct KIPCompareK
-        {
-            bool operator()(const KeyIndexPair<Tk, Tv> &lhs, const KeyIndexPair<Tk, Tv> &rhs)
-            {
-                uint lhsVal = std::get<2>(lhs);
-                uint rhsVal = std::get<2>(rhs);
-                if(isAscending) return (lhsVal < rhsVal);
-                else return (lhsVal > rhsVal);
+        }
+
+        parallel_for(0, tasks.size() / 3, 1, [&](dim_t lo, dim_t hi) {
+            for (dim_t t = lo; t < hi; t++) {
+                const size_t r  = tasks[3 * t];
+                const dim_t  a  = bounds[r];
+                const dim_t  b  = bounds[std::min(r + 1, bounds.size() - 1)];
+                const dim_t  e  = bounds[std::min(r + 2, bounds.size() - 1)];
+                merge_range(src_k + a, at(src_v, a), b - a,
+                            src_k + b, at(src_v, b), e - b,
+                            dst_k + a, at(dst_v, a),
+                            tasks[3 * t + 1] - a, tasks[3 * t + 2] - a);
             }
-        };
+        });
+
+        std::vector<dim_t> merged;
+        for (size_t r = 0; r < bounds.size(); r += 2) merged.push_back(bounds[r]);
+        if (merged.back() != n) merged.push_back(n);
+        bounds.swap(merged);
+
+        std::swap(src_k, dst_k);
+        std::swap(src_v, dst_v);
+    }
+
+    if (src_k != keys) {
+        parallel_for(0, n, MIN_TASK_WORK, [&](dim_t lo, dim_t hi) {
+            std::copy(src_k + lo, src_k + hi, keys + lo);
+            if (vals) std::copy(src_v + lo, src_v + hi, vals + lo);
+        });
     }
 }
+
+// Sorts every column along dim 0 carrying val_ptr along, unless it is null.
+// Keys and values are expected to be stored contiguously along dim 0.
+template<typename Tk, typename Tv>
+void sort_columns(Tk *key_ptr, const af::dim4 &kstrides,
+                  Tv *val_ptr, const af::dim4 &vstrides,
+                  const af::dim4 &dims, bool isAscending)
+{
+    typedef radix_key<Tk> rkey;
+    typedef typename rkey::type U;
+
+    const dim_t len  = dims[0];
+    const dim_t cols = dims[1] * dims[2] * dims[3];
+
+    // Descending order is ascending order of the complemented keys
+    const U flip = isAscending ? U(0) : U(~U(0));
+
+    auto column = [&](dim_t c, Tk *&key, Tv *&val) {
+        const dim_t b1 = c % dims[1];
+        const dim_t b2 = (c / dims[1]) % dims[2];
+        const dim_t b3 = c / (dims[1] * dims[2]);
+        key = key_ptr + b1 * kstrides[1] + b2 * kstrides[2] + b3 * kstrides[3];
+        val = val_ptr ? val_ptr + b1 * vstrides[1] + b2 * vstrides[2] + b3 * vstrides[3] : val_ptr;
+    };
+
+    if (len >= SORT_PARALLEL_MIN && cols < (dim_t)getThreadPool().size()) {
+        std::vector<U>  ukeys(len), tkeys(len);
+        std::vector<Tv> tvals(val_ptr ? len : 0);
+
+        for (dim_t c = 0; c < cols; c++) {
+            Tk *key; Tv *val;
+            column(c, key, val);
+
+            parallel_for(0, len, MIN_TASK_WORK, [&](dim_t lo, dim_t hi) {
+                for (dim_t i = lo; i < hi; i++) ukeys[i] = U(rkey::encode(key[i]) ^ flip);
+            });
+
+            parallel_sort(ukeys.data(), val, tkeys.data(), val ? tvals.data() : nullptr, len);
+
+            parallel_for(0, len, MIN_TASK_WORK, [&](dim_t lo, dim_t hi) {
+                for (dim_t i = lo; i < hi; i++) key[i] = rkey::decode(U(ukeys[i] ^ flip));
+            });
+        }
+        return;
+    }
+
+    parallel_for(0, cols, (MIN_TASK_WORK + len - 1) / std::max<dim_t>(len, 1),
+                 [&](dim_t lo, dim_t hi) {
+        std::vector<U>  ukeys(len), tkeys(len);
+        std::vector<Tv> tvals(val_ptr ? len : 0);
+
+        for (dim_t c = lo; c < hi; c++) {
+            Tk *key; Tv *val;
+            column(c, key, val);
+
+            for (dim_t i = 0; i < len; i++) ukeys[i] = U(rkey::encode(key[i]) ^ flip);
+            radix_sort(ukeys.data(), val, tkeys.data(), val ? tvals.data() : nullptr, len);
+            for (dim_t i = 0; i < len; i++) key[i] = rkey::decode(U(ukeys[i] ^ flip));
+        }
+    });
+}
+
+}
+}
@@ -11,6 +11,8 @@
 #include <Array.hpp>
 #include <utility.hpp>
 #include <err_cpu.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
 
 namespace cpu
 {
@@ -36,8 +38,75 @@ cdouble getConjugate(const cdouble &in)
     return std::conj(in);
 }
 
+/// Side of the blocks transposed through a local buffer, small enough for
+/// the buffer to stay in registers
+static const dim_t TRANSPOSE_BLOCK = 8;
+
+/// Largest tile transposed block by block. The input and output tiles fit
+/// in the L1 cache together, larger matrices are halved recursively until
+/// they reach this size so that every level of cache is used in full.
+static const dim_t TRANSPOSE_TILE = 32;
+
 template<typename T, bool conjugate>
-void transpose(Array<T> output, const Array<T> input)
+T transpose_value(const T &in)
+{
+    return conjugate ? getConjugate(in) : in;
+}
+
+/// Transposes a full block, reading the columns of in and writing the
+/// columns of out
+template<typename T, bool conjugate>
+void transpose_block(T *out, const dim_t os, const T *in, const dim_t is)
+{
+    T buf[TRANSPOSE_BLOCK][TRANSPOSE_BLOCK];
+    for (dim_t r = 0; r < TRANSPOSE_BLOCK; ++r)
+        for (dim_t c = 0; c < TRANSPOSE_BLOCK; ++c)
+            buf[r][c] = in[c + r * is];
+
+    for (dim_t c = 0; c < TRANSPOSE_BLOCK; ++c)
+        for (dim_t r = 0; r < TRANSPOSE_BLOCK; ++r)
+            out[r + c * os] = transpose_value<T, conjugate>(buf[r][c]);
+}
+
+/// Writes the rows x cols matrix out, whose columns are os apart, from the
+/// cols x rows matrix in
+template<typename T, bool conjugate>
+void transpose_tile(T *out, const dim_t os, const T *in, const dim_t is,
+                    const dim_t rows, const dim_t cols)
+{
+    const dim_t rb = rows - rows % TRANSPOSE_BLOCK;
+    const dim_t cb = cols - cols % TRANSPOSE_BLOCK;
+
+    for (dim_t c = 0; c < cb; c += TRANSPOSE_BLOCK)
+        for (dim_t r = 0; r < rb; r += TRANSPOSE_BLOCK)
+            transpose_block<T, conjugate>(out + r + c * os, os, in + c + r * is, is);
+
+    // Partial blocks on the bottom and right edges
+    for (dim_t c = 0; c < cols; ++c) {
+        for (dim_t r = (c < cb ? rb : 0); r < rows; ++r)
+            out[r + c * os] = transpose_value<T, conjugate>(in[c + r * is]);
+    }
+}
+
+template<typename T, bool conjugate>
+void transpose_recursive(T *out, const dim_t os, const T *in, const dim_t is,
+                         const dim_t rows, const dim_t cols)
+{
+    if (rows <= TRANSPOSE_TILE && cols <= TRANSPOSE_TILE) {
+        transpose_tile<T, conjugate>(out, os, in, is, rows, cols);
+    } else if (rows >= cols) {
+        const dim_t h = rows / 2 / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+        transpose_recursive<T, conjugate>(out,     os, in,          is, h,        cols);
+        transpose_recursive<T, conjugate>(out + h, os, in + h * is, is, rows - h, cols);
+    } else {
+        const dim_t h = cols / 2 / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+        transpose_recursive<T, conjugate>(out,          os, in,     is, rows, h);
+        transpose_recursive<T, conjugate>(out + h * os, os, in + h, is, rows, cols - h);
+    }
+}
+
+template<typename T, bool conjugate>
+void transpose_strided(Array<T> output, const Array<T> input)
 {
     const dim4 odims    = output.dims();
     const dim4 ostrides = output.strides();
@@ -57,10 +126,7 @@ void transpose(Array<T> output, const Array<T> input)
                     // the helper getIdx takes care of indices
                     const dim_t inIdx  = getIdx(istrides,j,i,k,l);
                     const dim_t outIdx = getIdx(ostrides,i,j,k,l);
-                    if(conjugate)
-                        out[outIdx] = getConjugate(in[inIdx]);
-                    else
-                        out[outIdx] = in[inIdx];
+                    out[outIdx] = transpose_value<T, conjugate>(in[inIdx]);
                 }
             }
             // outData and inData pointers doesn't need to be
@@ -70,14 +136,94 @@ void transpose(Array<T> output, const Array<T> input)
     }
 }
 
+/// Transposes every matrix of input. The matrices are cut into strips of
+/// tiles along their longer side, the strips of all the matrices being
+/// spread over the thread pool.
+template<typename T, bool conjugate>
+void transpose(Array<T> output, const Array<T> input)
+{
+    const dim4 odims    = output.dims();
+    const dim4 ostrides = output.strides();
+    const dim4 istrides = input.strides();
+
+    if (istrides[0] != 1 || ostrides[0] != 1) {
+        transpose_strided<T, conjugate>(output, input);
+        return;
+    }
+
+    const dim_t rows = odims[0];
+    const dim_t cols = odims[1];
+    const dim_t os   = ostrides[1];
+    const dim_t is   = istrides[1];
+
+    const bool  wide   = cols >= rows;
+    const dim_t len    = wide ? cols : rows;
+    const dim_t width  = wide ? rows : cols;
+    const dim_t strips = (len + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+    const dim_t tasks  = strips * odims[2] * odims[3];
+    const dim_t work   = std::max<dim_t>(width * TRANSPOSE_TILE, 1);
+
+    T * out = output.get();
+    T const * const in = input.get();
+
+    parallel_for(0, tasks, (MIN_TASK_WORK + work - 1) / work, [&](dim_t lo, dim_t hi) {
+        for (dim_t t = lo; t < hi; ++t) {
+            const dim_t b  = t / strips;
+            const dim_t s0 = (t % strips) * TRANSPOSE_TILE;
+            const dim_t sn = std::min(TRANSPOSE_TILE, len - s0);
+            const dim_t k  = b % odims[2];
+            const dim_t l  = b / odims[2];
+
+            T       *o = out + k * ostrides[2] + l * ostrides[3];
+            const T *i = in  + k * istrides[2] + l * istrides[3];
+            if (wide) {
+                transpose_recursive<T, conjugate>(o + s0 * os, os, i + s0, is, rows, sn);
+            } else {
+                transpose_recursive<T, conjugate>(o + s0, os, i + s0 * is, is, sn, cols);
+            }
+        }
+    });
+}
+
 template<typename T>
 void transpose(Array<T> out, const Array<T> in, const bool conjugate)
 {
     return (conjugate ? transpose<T, true>(out, in) : transpose<T, false>(out, in));
 }
 
+/// Transposes the block of size rows x cols at m in place with its mirror
+/// at mt, both being the same block on the diagonal
 template<typename T, bool conjugate>
-void transpose_inplace(Array<T> input)
+void transpose_swap(T *m, T *mt, const dim_t s, const dim_t rows, const dim_t cols)
+{
+    if (rows == TRANSPOSE_BLOCK && cols == TRANSPOSE_BLOCK) {
+        T tmp[TRANSPOSE_BLOCK * TRANSPOSE_BLOCK];
+        for (dim_t c = 0; c < TRANSPOSE_BLOCK; ++c)
+            for (dim_t r = 0; r < TRANSPOSE_BLOCK; ++r)
+                tmp[r + c * TRANSPOSE_BLOCK] = m[r + c * s];
+
+        if (m != mt) transpose_block<T, conjugate>(m, s, mt, s);
+        transpose_block<T, conjugate>(mt, s, tmp, TRANSPOSE_BLOCK);
+        return;
+    }
+
+    for (dim_t c = 0; c < cols; ++c) {
+        for (dim_t r = 0; r < rows; ++r) {
+            T *x = m  + r + c * s;
+            T *y = mt + c + r * s;
+            if (x == y) {
+                *x = transpose_value<T, conjugate>(*x);
+            } else if (m != mt || r < c) {
+                T tmp = *x;
+                *x = transpose_value<T, conjugate>(*y);
+                *y = transpose_value<T, conjugate>(tmp);
+            }
+        }
+    }
+}
+
+template<typename T, bool conjugate>
+void transpose_inplace_strided(Array<T> input)
 {
     const dim4 idims    = input.dims();
     const dim4 istrides = input.strides();
@@ -89,21 +235,18 @@ void transpose_inplace(Array<T> input)
             // Outermost loop handles batch mode
             // if input has no data along third dimension
             // this loop runs only once
-            //
-            // Run only bottom triangle. std::swap swaps with upper triangle
             for (dim_t j = 0; j < idims[1]; ++j) {
-                for (dim_t i = j + 1; i < idims[0]; ++i) {
+                for (dim_t i = j; i < idims[0]; ++i) {
                     // calculate array indices based on offsets and strides
                     // the helper getIdx takes care of indices
                     const dim_t iIdx  = getIdx(istrides,j,i,k,l);
                     const dim_t oIdx = getIdx(istrides,i,j,k,l);
-                    if(conjugate) {
-                        in[iIdx] = getConjugate(in[iIdx]);
-                        in[oIdx] = getConjugate(in[oIdx]);
-                        std::swap(in[iIdx], in[oIdx]);
-                    }
-                    else {
-                        std::swap(in[iIdx], in[oIdx]);
+                    if (i == j) {
+                        in[iIdx] = transpose_value<T, conjugate>(in[iIdx]);
+                    } else {
+                        T tmp = in[iIdx];
+                        in[iIdx] = transpose_value<T, conjugate>(in[oIdx]);
+                        in[oIdx] = transpose_value<T, conjugate>(tmp);
                     }
                 }
             }
@@ -111,6 +254,51 @@ void transpose_inplace(Array<T> input)
     }
 }
 
+/// Transposes every square matrix of input in place. A row of tiles above
+/// the diagonal is swapped with the matching column of tiles below it, the
+/// rows of all the matrices being spread over the thread pool.
+template<typename T, bool conjugate>
+void transpose_inplace(Array<T> input)
+{
+    const dim4 idims    = input.dims();
+    const dim4 istrides = input.strides();
+
+    if (istrides[0] != 1) {
+        transpose_inplace_strided<T, conjugate>(input);
+        return;
+    }
+
+    const dim_t n     = idims[0];
+    const dim_t s     = istrides[1];
+    const dim_t tiles = (n + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+    const dim_t tasks = tiles * idims[2] * idims[3];
+    const dim_t work  = std::max<dim_t>(n * TRANSPOSE_TILE / 2, 1);
+
+    T * in = input.get();
+
+    parallel_for(0, tasks, (MIN_TASK_WORK + work - 1) / work, [&](dim_t lo, dim_t hi) {
+        for (dim_t t = lo; t < hi; ++t) {
+            const dim_t b  = t / tiles;
+            const dim_t r0 = (t % tiles) * TRANSPOSE_TILE;
+            const dim_t k  = b % idims[2];
+            const dim_t l  = b / idims[2];
+            T *m = in + k * istrides[2] + l * istrides[3];
+
+            for (dim_t c0 = r0; c0 < n; c0 += TRANSPOSE_TILE) {
+                for (dim_t c = c0; c < std::min(c0 + TRANSPOSE_TILE, n); c += TRANSPOSE_BLOCK) {
+                    for (dim_t r = r0; r < std::min(r0 + TRANSPOSE_TILE, n); r += TRANSPOSE_BLOCK) {
+                        // Blocks below the diagonal are their mirror's
+                        if (r > c) continue;
+                        transpose_swap<T, conjugate>(m + r + c * s, m + c + r * s, s,
+                                                     std::min(TRANSPOSE_BLOCK, n - r),
+                                                     std::min(TRANSPOSE_BLOCK, n - c));
+                    }
+                }
+            }
+        }
+    });
+}
+
 template<typename T>
 void transpose_inplace(Array<T> in, const bool conjugate)
 {
@@ -0,0 +1,109 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <Array.hpp>
+#include <math.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace cpu
+{
+namespace kernel
+{
+
+/// Elements per chunk of the compaction. Every chunk is counted and then
+/// written by a single task.
+static const dim_t WHERE_CHUNK = 1 << 16;
+
+/// Calls func(ptr, idx, len) for every run of elements along dimension 0
+/// that falls in the linear index range [lo, hi)
+template<typename T, typename F>
+void for_each_row(T const *iptr, af::dim4 const &dims, af::dim4 const &strides,
+                  dim_t lo, dim_t hi, F func)
+{
+    dim_t const d0 = dims[0];
+    dim_t row = lo / d0;
+    dim_t x   = lo - row * d0;
+    for (dim_t i = lo; i < hi; ++row, x = 0) {
+        dim_t const y = row % dims[1];
+        dim_t const z = (row / dims[1]) % dims[2];
+        dim_t const w = row / (dims[1] * dims[2]);
+        dim_t const len = std::min(d0 - x, hi - i);
+        func(iptr + w * strides[3] + z * strides[2] + y * strides[1] + x, i, len);
+        i += len;
+    }
+}
+
+/// Writes the linear indices of the non zero elements of in to a buffer
+/// allocated for exactly that many. Chunks are counted in parallel, their
+/// offsets found with a scan of the counts and then filled in parallel.
+template<typename T, typename Ti>
+Array<Ti> where(Array<T> const &in)
+{
+    af::dim4 const dims    = in.dims();
+    af::dim4 const strides = in.strides();
+    dim_t const n          = dims.elements();
+    dim_t const chunks     = (n + WHERE_CHUNK - 1) / WHERE_CHUNK;
+    T const zero           = scalar<T>(0);
+    T const *iptr          = in.get();
+
+    std::vector<dim_t> offsets(chunks + 1, 0);
+    parallel_for(0, chunks, 1, [&](dim_t lo, dim_t hi) {
+        for (dim_t c = lo; c < hi; ++c) {
+            dim_t count = 0;
+            for_each_row(iptr, dims, strides, c * WHERE_CHUNK,
+                         std::min(n, (c + 1) * WHERE_CHUNK),
+                         [&](T const *ptr, dim_t, dim_t len) {
+                for (dim_t x = 0; x < len; ++x) count += (ptr[x] != zero);
+            });
+            offsets[c + 1] = count;
+        }
+    });
+
+    for (dim_t c = 0; c < chunks; ++c) offsets[c + 1] += offsets[c];
+
+    Array<Ti> out = createEmptyArray<Ti>(af::dim4(offsets[chunks]));
+    Ti *optr = out.get();
+
+    parallel_for(0, chunks, 1, [&](dim_t lo, dim_t hi) {
+        for (dim_t c = lo; c < hi; ++c) {
+            // Chunks without any or with only non zero elements are common
+            dim_t const begin = c * WHERE_CHUNK;
+            dim_t const end   = std::min(n, begin + WHERE_CHUNK);
+            dim_t const count = offsets[c + 1] - offsets[c];
+            if (count == 0) continue;
+
+            Ti *o = optr + offsets[c];
+            Ti *const oEnd = o + count;
+            if (count == end - begin) {
+                for (dim_t i = 0; i < count; ++i) o[i] = Ti(begin + i);
+                continue;
+            }
+
+            // Every index is written and only kept when the element is non
+            // zero, which avoids a mispredicted branch per element. Writes
+            // stop once the chunk has all its indices, so they never spill
+            // into the next chunk.
+            for_each_row(iptr, dims, strides, begin, end,
+                         [&](T const *ptr, dim_t idx, dim_t len) {
+                for (dim_t x = 0; x < len && o != oEnd; ++x) {
+                    *o = Ti(idx + x);
+                    o += (ptr[x] != zero);
+                }
+            });
+        }
+    });
+
+    return out;
+}
+
+}
+}
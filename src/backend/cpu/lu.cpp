@@ -21,6 +21,7 @@
 #include <platform.hpp>
 #include <queue.hpp>
 #include <kernel/lu.hpp>
+#include <kernel/lapack_batch.hpp>
 
 namespace cpu
 {
@@ -58,8 +59,8 @@ void lu(Array<T> &lower, Array<T> &upper, Array<int> &pivot, const Array<T> &in)
     pivot = lu_inplace(in_copy);
 
     // SPLIT into lower and upper
-    dim4 ldims(M, min(M, N));
-    dim4 udims(min(M, N), N);
+    dim4 ldims(M, min(M, N), iDims[2], iDims[3]);
+    dim4 udims(min(M, N), N, iDims[2], iDims[3]);
     lower = createEmptyArray<T>(ldims);
     upper = createEmptyArray<T>(udims);
 
@@ -72,16 +73,29 @@ Array<int> lu_inplace(Array<T> &in, const bool convert_pivot)
     in.eval();
 
     dim4 iDims = in.dims();
-    Array<int> pivot = createEmptyArray<int>(af::dim4(min(iDims[0], iDims[1]), 1, 1, 1));
+    Array<int> pivot = createEmptyArray<int>(af::dim4(min(iDims[0], iDims[1]), 1, iDims[2], iDims[3]));
 
     auto func = [=] (Array<T> in, Array<int> pivot) {
         dim4 iDims = in.dims();
-        getrf_func<T>()(AF_LAPACK_COL_MAJOR, iDims[0], iDims[1], in.get(), in.strides()[1], pivot.get());
+        dim4 iStrides = in.strides();
+        dim4 pStrides = pivot.strides();
+        int M = iDims[0];
+        int N = iDims[1];
+
+        kernel::batch_for(kernel::batch_count(iDims), min(M, N), [&](dim_t b) {
+            T   *a = in.get()    + kernel::batch_offset(iDims, iStrides, b);
+            int *p = pivot.get() + kernel::batch_offset(iDims, pStrides, b);
+            if (M == N && N <= kernel::SMALL_LAPACK_MAX) {
+                kernel::small_lapack<kernel::small_getrf, T>(N, a, iStrides[1], p);
+            } else {
+                getrf_func<T>()(AF_LAPACK_COL_MAJOR, M, N, a, iStrides[1], p);
+            }
+        });
     };
     getQueue().enqueue(func, in, pivot);
 
     if(convert_pivot) {
-        Array<int> p = range<int>(dim4(iDims[0]), 0);
+        Array<int> p = range<int>(dim4(iDims[0], 1, iDims[2], iDims[3]), 0);
         getQueue().enqueue(kernel::convertPivot, p, pivot);
         return p;
     } else {
@@ -0,0 +1,111 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <af/dim4.hpp>
+#include <Array.hpp>
+#include <meanvar.hpp>
+#include <platform.hpp>
+#include <queue.hpp>
+#include <kernel/meanvar.hpp>
+#include <type_traits>
+
+using af::dim4;
+
+namespace cpu
+{
+
+template<typename Ti, typename To>
+void meanvar(Array<To> &mean, Array<To> &var, const Array<Ti> &in,
+             const bool isbiased, const int dim)
+{
+    typedef typename std::conditional<std::is_same<To, cdouble>::value ||
+                                      std::is_same<To, double>::value,
+                                      double, float>::type Tw;
+    in.eval();
+
+    dim4 odims = in.dims();
+    odims[dim] = 1;
+    mean = createEmptyArray<To>(odims);
+    var  = createEmptyArray<To>(odims);
+
+    getQueue().enqueue(kernel::meanvar<Ti, To, Tw>, mean, var, in, isbiased, dim);
+}
+
+template<typename Ti, typename To, typename Tw>
+void meanvar(Array<To> &mean, Array<To> &var, const Array<Ti> &in,
+             const Array<Tw> &weights, const int dim)
+{
+    in.eval();
+    weights.eval();
+
+    dim4 odims = in.dims();
+    odims[dim] = 1;
+    mean = createEmptyArray<To>(odims);
+    var  = createEmptyArray<To>(odims);
+
+    getQueue().enqueue(kernel::meanvar_weighted<Ti, To, Tw>, mean, var, in, weights, dim);
+}
+
+template<typename Ti, typename To>
+void comoments(Array<To> &mx, Array<To> &my, Array<To> &cxx, Array<To> &cyy,
+               Array<To> &cxy, const Array<Ti> &x, const Array<Ti> &y)
+{
+    x.eval();
+    y.eval();
+
+    dim4 odims = x.dims();
+    odims[0] = 1;
+    mx  = createEmptyArray<To>(odims);
+    my  = createEmptyArray<To>(odims);
+    cxx = createEmptyArray<To>(odims);
+    cyy = createEmptyArray<To>(odims);
+    cxy = createEmptyArray<To>(odims);
+
+    getQueue().enqueue(kernel::comoments<Ti, To>, mx, my, cxx, cyy, cxy, x, y);
+}
+
+#define INSTANTIATE_MEANVAR(Ti, To, Tw)                                         \
+    template void meanvar<Ti, To>(Array<To> &mean, Array<To> &var,              \
+                                  const Array<Ti> &in, const bool isbiased,     \
+                                  const int dim);                               \
+    template void meanvar<Ti, To, Tw>(Array<To> &mean, Array<To> &var,          \
+                                      const Array<Ti> &in,                      \
+                                      const Array<Tw> &weights, const int dim);
+
+INSTANTIATE_MEANVAR(float  , float  , float )
+INSTANTIATE_MEANVAR(double , double , double)
+INSTANTIATE_MEANVAR(cfloat , cfloat , float )
+INSTANTIATE_MEANVAR(cdouble, cdouble, double)
+INSTANTIATE_MEANVAR(int    , float  , float )
+INSTANTIATE_MEANVAR(uint   , float  , float )
+INSTANTIATE_MEANVAR(intl   , double , double)
+INSTANTIATE_MEANVAR(uintl  , double , double)
+INSTANTIATE_MEANVAR(short  , float  , float )
+INSTANTIATE_MEANVAR(ushort , float  , float )
+INSTANTIATE_MEANVAR(uchar  , float  , float )
+INSTANTIATE_MEANVAR(char   , float  , float )
+
+#define INSTANTIATE_COMOMENTS(Ti, To)                                           \
+    template void comoments<Ti, To>(Array<To> &mx, Array<To> &my,               \
+                                    Array<To> &cxx, Array<To> &cyy,             \
+                                    Array<To> &cxy, const Array<Ti> &x,         \
+                                    const Array<Ti> &y);
+
+INSTANTIATE_COMOMENTS(float  , float )
+INSTANTIATE_COMOMENTS(double , double)
+INSTANTIATE_COMOMENTS(int    , float )
+INSTANTIATE_COMOMENTS(uint   , float )
+INSTANTIATE_COMOMENTS(intl   , double)
+INSTANTIATE_COMOMENTS(uintl  , double)
+INSTANTIATE_COMOMENTS(short  , float )
+INSTANTIATE_COMOMENTS(ushort , float )
+INSTANTIATE_COMOMENTS(uchar  , float )
+INSTANTIATE_COMOMENTS(char   , float )
+
+}
@@ -0,0 +1,33 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <Array.hpp>
+
+namespace cpu
+{
+
+/// Mean and variance along dim in a single pass over in. The variance is
+/// divided by the number of values, minus one unless isbiased.
+template<typename Ti, typename To>
+void meanvar(Array<To> &mean, Array<To> &var, const Array<Ti> &in,
+             const bool isbiased, const int dim);
+
+/// Weighted mean and variance along dim in a single pass over in. The
+/// variance is divided by the sum of the weights.
+template<typename Ti, typename To, typename Tw>
+void meanvar(Array<To> &mean, Array<To> &var, const Array<Ti> &in,
+             const Array<Tw> &weights, const int dim);
+
+/// Means of the columns of x and y along dim 0 and the sums of the squares
+/// and products of their deviations from them, in a single pass over both
+template<typename Ti, typename To>
+void comoments(Array<To> &mx, Array<To> &my, Array<To> &cxx, Array<To> &cyy,
+               Array<To> &cxy, const Array<Ti> &x, const Array<Ti> &y);
+
+}
@@ -26,10 +26,6 @@ void nearest_neighbour(Array<uint>& idx, Array<To>& dist,
                        const uint dist_dim, const uint n_dist,
                        const af_match_type dist_type)
 {
-    if (n_dist > 1) {
-        CPU_NOT_SUPPORTED();
-    }
-
     idx.eval();
     dist.eval();
     query.eval();
@@ -20,6 +20,7 @@
 #include <math.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <kernel/lapack_batch.hpp>
 
 namespace cpu
 {
@@ -69,20 +70,26 @@ void qr(Array<T> &q, Array<T> &r, Array<T> &t, const Array<T> &in)
     int M      = iDims[0];
     int N      = iDims[1];
 
-    q = padArray<T, T>(in, dim4(M, max(M, N)));
+    q = padArray<T, T>(in, dim4(M, max(M, N), iDims[2], iDims[3]));
     q.resetDims(iDims);
     t = qr_inplace(q);
 
     // SPLIT into q and r
-    dim4 rdims(M, N);
+    dim4 rdims(M, N, iDims[2], iDims[3]);
     r = createEmptyArray<T>(rdims);
 
     triangle<T, true, false>(r, q);
 
     auto func = [=] (Array<T> q, Array<T> t, int M, int N) {
-        gqr_func<T>()(AF_LAPACK_COL_MAJOR, M, M, min(M, N), q.get(), q.strides()[1], t.get());
+        dim4 qStrides = q.strides();
+        dim4 tStrides = t.strides();
+        kernel::batch_for(kernel::batch_count(iDims), min(M, N), [&](dim_t b) {
+            gqr_func<T>()(AF_LAPACK_COL_MAJOR, M, M, min(M, N),
+                          q.get() + kernel::batch_offset(iDims, qStrides, b), qStrides[1],
+                          t.get() + kernel::batch_offset(iDims, tStrides, b));
+        });
     };
-    q.resetDims(dim4(M, M));
+    q.resetDims(dim4(M, M, iDims[2], iDims[3]));
     getQueue().enqueue(func, q, t, M, N);
 }
 
@@ -94,10 +101,16 @@ Array<T> qr_inplace(Array<T> &in)
     dim4 iDims = in.dims();
     int M      = iDims[0];
     int N      = iDims[1];
-    Array<T> t = createEmptyArray<T>(af::dim4(min(M, N), 1, 1, 1));
+    Array<T> t = createEmptyArray<T>(af::dim4(min(M, N), 1, iDims[2], iDims[3]));
 
     auto func = [=] (Array<T> in, Array<T> t, int M, int N) {
-        geqrf_func<T>()(AF_LAPACK_COL_MAJOR, M, N, in.get(), in.strides()[1], t.get());
+        dim4 iStrides = in.strides();
+        dim4 tStrides = t.strides();
+        kernel::batch_for(kernel::batch_count(iDims), min(M, N), [&](dim_t b) {
+            geqrf_func<T>()(AF_LAPACK_COL_MAJOR, M, N,
+                            in.get() + kernel::batch_offset(iDims, iStrides, b), iStrides[1],
+                            t.get() + kernel::batch_offset(iDims, tStrides, b));
+        });
     };
     getQueue().enqueue(func, in, t, M, N);
 
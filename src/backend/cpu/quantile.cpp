@@ -0,0 +1,49 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <af/dim4.hpp>
+#include <Array.hpp>
+#include <quantile.hpp>
+#include <platform.hpp>
+#include <queue.hpp>
+#include <kernel/quantile.hpp>
+
+using af::dim4;
+
+namespace cpu
+{
+
+template<typename T, typename To>
+Array<To> quantile(const Array<T> &in, const std::vector<double> &probs, const int dim)
+{
+    in.eval();
+
+    dim4 odims = in.dims();
+    odims[dim] = probs.size();
+    Array<To> out = createEmptyArray<To>(odims);
+
+    getQueue().enqueue(kernel::quantile<T, To>, out, in, probs, dim);
+
+    return out;
+}
+
+#define INSTANTIATE(T, To)                                              \
+    template Array<To> quantile<T, To>(const Array<T> &in, const std::vector<double> &probs, const int dim);
+
+INSTANTIATE(float , float )
+INSTANTIATE(double, double)
+INSTANTIATE(int   , float )
+INSTANTIATE(uint  , float )
+INSTANTIATE(int   , double)
+INSTANTIATE(uint  , double)
+INSTANTIATE(short , float )
+INSTANTIATE(ushort, float )
+INSTANTIATE(uchar , float )
+
+}
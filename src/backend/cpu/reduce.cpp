@@ -15,6 +15,7 @@
 #include <complex>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
 #include <kernel/reduce.hpp>
 
 using af::dim4;
@@ -37,9 +38,15 @@ namespace cpu
 {
 
 template<af_op_t op, typename Ti, typename To>
-using reduce_dim_func = std::function<void(Array<To>, const dim_t,
-                                           const Array<Ti>, const dim_t,
-                                           const int, bool, double)>;
+void reduce_batched(Array<To> out, const Array<Ti> in, const int dim,
+                    bool change_nan, double nanval)
+{
+    if (dim == 0) {
+        kernel::reduce_first<op, Ti, To>(out, in, change_nan, nanval);
+    } else {
+        kernel::reduce_strided<op, Ti, To>(out, in, dim, change_nan, nanval);
+    }
+}
 
 template<af_op_t op, typename Ti, typename To>
 Array<To> reduce(const Array<Ti> &in, const int dim, bool change_nan, double nanval)
@@ -49,12 +56,8 @@ Array<To> reduce(const Array<Ti> &in, const int dim, bool change_nan, double nan
     in.eval();
 
     Array<To> out = createEmptyArray<To>(odims);
-    static const reduce_dim_func<op, Ti, To>  reduce_funcs[4] = { kernel::reduce_dim<op, Ti, To, 1>()
-                                                                , kernel::reduce_dim<op, Ti, To, 2>()
-                                                                , kernel::reduce_dim<op, Ti, To, 3>()
-                                                                , kernel::reduce_dim<op, Ti, To, 4>()};
 
-    getQueue().enqueue(reduce_funcs[in.ndims() - 1], out, 0, in, 0, dim, change_nan, nanval);
+    getQueue().enqueue(reduce_batched<op, Ti, To>, out, in, dim, change_nan, nanval);
 
     return out;
 }
@@ -65,37 +68,7 @@ To reduce_all(const Array<Ti> &in, bool change_nan, double nanval)
     in.eval();
     getQueue().sync();
 
-    Transform<Ti, To, op> transform;
-    Binary<To, op> reduce;
-
-    To out = reduce.init();
-
-    // Decrement dimension of select dimension
-    af::dim4 dims = in.dims();
-    af::dim4 strides = in.strides();
-    const Ti *inPtr = in.get();
-
-    for(dim_t l = 0; l < dims[3]; l++) {
-        dim_t off3 = l * strides[3];
-
-        for(dim_t k = 0; k < dims[2]; k++) {
-            dim_t off2 = k * strides[2];
-
-            for(dim_t j = 0; j < dims[1]; j++) {
-                dim_t off1 = j * strides[1];
-
-                for(dim_t i = 0; i < dims[0]; i++) {
-                    dim_t idx = i + off1 + off2 + off3;
-
-                    To in_val = transform(inPtr[idx]);
-                    if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
-                    out = reduce(in_val, out);
-                }
-            }
-        }
-    }
-
-    return out;
+    return kernel::reduce_all<op, Ti, To>(in, change_nan, nanval);
 }
 
 #define INSTANTIATE(ROp, Ti, To)                                        \
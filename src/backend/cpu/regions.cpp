@@ -12,9 +12,7 @@
 #include <regions.hpp>
 #include <err_cpu.hpp>
 #include <math.hpp>
-#include <map>
-#include <set>
-#include <algorithm>
+#include <climits>
 #include <platform.hpp>
 #include <queue.hpp>
 #include <kernel/regions.hpp>
@@ -29,8 +27,11 @@ Array<T> regions(const Array<char> &in, af_connectivity connectivity)
 {
     in.eval();
 
-    Array<T> out = createValueArray(in.dims(), (T)0);
-    out.eval();
+    // Pixels are indexed with 32 bit integers
+    if (in.dims()[0] * in.dims()[1] > (dim_t)UINT_MAX)
+        AF_ERROR("Image is too large for regions", AF_ERR_SIZE);
+
+    Array<T> out = createEmptyArray<T>(in.dims());
 
     getQueue().enqueue(kernel::regions<T>, out, in, connectivity);
 
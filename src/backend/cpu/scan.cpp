@@ -14,6 +14,7 @@
 #include <ops.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
 #include <kernel/scan.hpp>
 
 using af::dim4;
@@ -21,51 +22,34 @@ using af::dim4;
 namespace cpu
 {
 
+    template<af_op_t op, typename Ti, typename To, bool inclusive_scan>
+    void scan_batched(Array<To> out, const Array<Ti> in, const int dim)
+    {
+        // When the dimensions before dim are all 1, the lines along dim can
+        // be split across threads
+        const dim4 dims = in.dims();
+        bool first = true;
+        for (int i = 0; i < dim; i++) first &= (dims[i] == 1);
+
+        if (first) {
+            kernel::scan_first<op, Ti, To, inclusive_scan>(out, in, dim);
+        } else {
+            kernel::scan_strided<op, Ti, To, inclusive_scan>(out, in, dim);
+        }
+    }
+
     template<af_op_t op, typename Ti, typename To>
     Array<To> scan(const Array<Ti>& in, const int dim, bool inclusive_scan)
     {
         dim4 dims     = in.dims();
+
         Array<To> out = createEmptyArray<To>(dims);
         in.eval();
 
         if (inclusive_scan) {
-            switch (in.ndims()) {
-                case 1:
-                    kernel::scan_dim<op, Ti, To, 1, true> func1;
-                    getQueue().enqueue(func1, out, 0, in, 0, dim);
-                    break;
-                case 2:
-                    kernel::scan_dim<op, Ti, To, 2, true> func2;
-                    getQueue().enqueue(func2, out, 0, in, 0, dim);
-                    break;
-                case 3:
-                    kernel::scan_dim<op, Ti, To, 3, true> func3;
-                    getQueue().enqueue(func3, out, 0, in, 0, dim);
-                    break;
-                case 4:
-                    kernel::scan_dim<op, Ti, To, 4, true> func4;
-                    getQueue().enqueue(func4, out, 0, in, 0, dim);
-                    break;
-            }
+            getQueue().enqueue(scan_batched<op, Ti, To, true>, out, in, dim);
         } else {
-            switch (in.ndims()) {
-                case 1:
-                    kernel::scan_dim<op, Ti, To, 1, false> func1;
-                    getQueue().enqueue(func1, out, 0, in, 0, dim);
-                    break;
-                case 2:
-                    kernel::scan_dim<op, Ti, To, 2, false> func2;
-                    getQueue().enqueue(func2, out, 0, in, 0, dim);
-                    break;
-                case 3:
-                    kernel::scan_dim<op, Ti, To, 3, false> func3;
-                    getQueue().enqueue(func3, out, 0, in, 0, dim);
-                    break;
-                case 4:
-                    kernel::scan_dim<op, Ti, To, 4, false> func4;
-                    getQueue().enqueue(func4, out, 0, in, 0, dim);
-                    break;
-            }
+            getQueue().enqueue(scan_batched<op, Ti, To, false>, out, in, dim);
         }
 
         return out;
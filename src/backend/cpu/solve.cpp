@@ -19,6 +19,7 @@
 #include <math.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <kernel/lapack_batch.hpp>
 
 namespace cpu
 {
@@ -85,9 +86,23 @@ Array<T> solveLU(const Array<T> &A, const Array<int> &pivot,
     Array< T > B = copyArray<T>(b);
 
     auto func = [=] (Array<T> A, Array<T> B, Array<int> pivot, int N, int NRHS) {
-        getrs_func<T>()(AF_LAPACK_COL_MAJOR, 'N',
-                        N, NRHS, A.get(), A.strides()[1],
-                        pivot.get(), B.get(), B.strides()[1]);
+        dim4 aDims = A.dims();
+        dim4 aStrides = A.strides();
+        dim4 bStrides = B.strides();
+        dim4 pStrides = pivot.strides();
+        kernel::batch_for(kernel::batch_count(aDims), N, [&](dim_t i) {
+            const T   *a = A.get()     + kernel::batch_offset(aDims, aStrides, i);
+            const int *p = pivot.get() + kernel::batch_offset(aDims, pStrides, i);
+            T         *x = B.get()     + kernel::batch_offset(aDims, bStrides, i);
+            if (N <= kernel::SMALL_LAPACK_MAX) {
+                kernel::small_lapack<kernel::small_getrs, T>(N, a, aStrides[1], p,
+                                                             x, bStrides[1], (dim_t)NRHS);
+            } else {
+                getrs_func<T>()(AF_LAPACK_COL_MAJOR, 'N',
+                                N, NRHS, a, aStrides[1],
+                                p, x, bStrides[1]);
+            }
+        });
     };
     getQueue().enqueue(func, A, B, pivot, N, NRHS);
 
@@ -105,13 +120,28 @@ Array<T> triangleSolve(const Array<T> &A, const Array<T> &b, const af_mat_prop o
     int NRHS   = B.dims()[1];
 
     auto func = [=] (Array<T> A, Array<T> B, int N, int NRHS, const af_mat_prop options) {
-        trtrs_func<T>()(AF_LAPACK_COL_MAJOR,
-                        options & AF_MAT_UPPER ? 'U' : 'L',
-                        'N', // transpose flag
-                        options & AF_MAT_DIAG_UNIT ? 'U' : 'N',
-                        N, NRHS,
-                        A.get(), A.strides()[1],
-                        B.get(), B.strides()[1]);
+        dim4 aDims = A.dims();
+        dim4 aStrides = A.strides();
+        dim4 bStrides = B.strides();
+        bool is_upper = options & AF_MAT_UPPER;
+        bool is_unit  = options & AF_MAT_DIAG_UNIT;
+        kernel::batch_for(kernel::batch_count(aDims), N, [&](dim_t i) {
+            const T *a = A.get() + kernel::batch_offset(aDims, aStrides, i);
+            T       *x = B.get() + kernel::batch_offset(aDims, bStrides, i);
+            if (N <= kernel::SMALL_LAPACK_MAX) {
+                kernel::small_lapack<kernel::small_trtrs, T>(N, is_upper, is_unit,
+                                                             a, aStrides[1],
+                                                             x, bStrides[1], (dim_t)NRHS);
+            } else {
+                trtrs_func<T>()(AF_LAPACK_COL_MAJOR,
+                                is_upper ? 'U' : 'L',
+                                'N', // transpose flag
+                                is_unit ? 'U' : 'N',
+                                N, NRHS,
+                                a, aStrides[1],
+                                x, bStrides[1]);
+            }
+        });
     };
     getQueue().enqueue(func, A, B, N, NRHS, options);
 
@@ -129,32 +159,51 @@ Array<T> solve(const Array<T> &a, const Array<T> &b, const af_mat_prop options)
         return triangleSolve<T>(a, b, options);
     }
 
-    int M = a.dims()[0];
-    int N = a.dims()[1];
+    dim4 aDims = a.dims();
+    int M = aDims[0];
+    int N = aDims[1];
     int K = b.dims()[1];
 
     Array<T> A = copyArray<T>(a);
-    Array<T> B = padArray<T, T>(b, dim4(max(M, N), K));
+    Array<T> B = M == N ? copyArray<T>(b)
+                        : padArray<T, T>(b, dim4(max(M, N), K, aDims[2], aDims[3]));
 
     if(M == N) {
-        Array<int> pivot = createEmptyArray<int>(dim4(N, 1, 1));
+        Array<int> pivot = createEmptyArray<int>(dim4(N, 1, aDims[2], aDims[3]));
 
         auto func = [=] (Array<T> A, Array<T> B, Array<int> pivot, int N, int K) {
-            gesv_func<T>()(AF_LAPACK_COL_MAJOR, N, K, A.get(), A.strides()[1],
-                           pivot.get(), B.get(), B.strides()[1]);
+            dim4 aStrides = A.strides();
+            dim4 bStrides = B.strides();
+            dim4 pStrides = pivot.strides();
+            kernel::batch_for(kernel::batch_count(aDims), N, [&](dim_t i) {
+                T *a = A.get() + kernel::batch_offset(aDims, aStrides, i);
+                T *x = B.get() + kernel::batch_offset(aDims, bStrides, i);
+                if (N <= kernel::SMALL_LAPACK_MAX) {
+                    kernel::small_lapack<kernel::small_gesv, T>(N, a, aStrides[1],
+                                                                x, bStrides[1], (dim_t)K);
+                } else {
+                    gesv_func<T>()(AF_LAPACK_COL_MAJOR, N, K, a, aStrides[1],
+                                   pivot.get() + kernel::batch_offset(aDims, pStrides, i),
+                                   x, bStrides[1]);
+                }
+            });
         };
         getQueue().enqueue(func, A, B, pivot, N, K);
     } else {
         auto func = [=] (Array<T> A, Array<T> B, int M, int N, int K) {
-            int sM = A.strides()[1];
-            int sN = A.strides()[2] / sM;
-
-            gels_func<T>()(AF_LAPACK_COL_MAJOR, 'N',
-                    M, N, K,
-                    A.get(), A.strides()[1],
-                    B.get(), max(sM, sN));
+            dim4 aStrides = A.strides();
+            dim4 bStrides = B.strides();
+            int sM = aStrides[1];
+            int sN = aStrides[2] / sM;
+
+            kernel::batch_for(kernel::batch_count(aDims), min(M, N), [&](dim_t i) {
+                gels_func<T>()(AF_LAPACK_COL_MAJOR, 'N',
+                        M, N, K,
+                        A.get() + kernel::batch_offset(aDims, aStrides, i), aStrides[1],
+                        B.get() + kernel::batch_offset(aDims, bStrides, i), max(sM, sN));
+            });
         };
-        B.resetDims(dim4(N, K));
+        B.resetDims(dim4(N, K, aDims[2], aDims[3]));
         getQueue().enqueue(func, A, B, M, N, K);
     }
 
@@ -9,9 +9,7 @@
 
 #include <Array.hpp>
 #include <sort_index.hpp>
-#include <math.hpp>
 #include <algorithm>
-#include <numeric>
 #include <platform.hpp>
 #include <queue.hpp>
 #include <range.hpp>
@@ -27,32 +25,20 @@ void sort_index(Array<T> &okey, Array<uint> &oval, const Array<T> &in, const uin
 {
     in.eval();
 
-    // okey is values, oval is indices
-    okey = copyArray<T>(in);
-    oval = range<uint>(in.dims(), dim);
-    oval.eval();
+    if (dim > 3) AF_ERROR("Not Supported", AF_ERR_NOT_SUPPORTED);
 
-    switch(dim) {
-        case 0: getQueue().enqueue(kernel::sort0ByKey<T, uint>, okey, oval, isAscending); break;
-        case 1:
-        case 2:
-        case 3: getQueue().enqueue(kernel::sortByKeyBatched<T, uint>, okey, oval, dim, isAscending); break;
-        default: AF_ERROR("Not Supported", AF_ERR_NOT_SUPPORTED);
-    }
+    // Other dimensions are sorted by moving them to the front
+    af::dim4 reorderDims(0, 1, 2, 3);
+    std::swap(reorderDims[0], reorderDims[dim]);
 
-    if(dim != 0) {
-        af::dim4 preorderDims = okey.dims();
-        af::dim4 reorderDims(0, 1, 2, 3);
-        reorderDims[dim] = 0;
-        preorderDims[0] = okey.dims()[dim];
-        for(int i = 1; i <= (int)dim; i++) {
-            reorderDims[i - 1] = i;
-            preorderDims[i] = okey.dims()[i - 1];
-        }
+    // okey is values, oval is indices
+    okey = (dim == 0) ? copyArray<T>(in) : reorder<T>(in, reorderDims);
+    oval = range<uint>(okey.dims(), 0);
+    oval.eval();
 
-        okey.setDataDims(preorderDims);
-        oval.setDataDims(preorderDims);
+    getQueue().enqueue(kernel::sort0ByKey<T, uint>, okey, oval, isAscending);
 
+    if (dim != 0) {
         okey = reorder<T>(okey, reorderDims);
         oval = reorder<uint>(oval, reorderDims);
     }
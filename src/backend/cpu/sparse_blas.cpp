@@ -9,9 +9,11 @@
 
 #include <sparse_blas.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <cassert>
+#include <vector>
 
 #include <af/dim4.hpp>
 #include <complex.hpp>
@@ -19,6 +21,7 @@
 #include <math.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
 
 namespace cpu
 {
@@ -303,6 +306,91 @@ cdouble getConjugate(const cdouble &in)
     return std::conj(in);
 }
 
+// Number of right hand side columns processed in a single pass over a row
+static const int RHS_BLOCK = 8;
+
+// Calls func(row_begin, row_end) on the thread pool with the rows split so
+// that every task processes about the same number of non zero elements
+template<typename F>
+void parallel_rows(int const * const rowPtr, int M, F func)
+{
+    const int nnz = rowPtr[M];
+    if (nnz == 0) {
+        func(0, M);
+        return;
+    }
+
+    parallel_for(0, nnz, MIN_TASK_WORK, [&](dim_t lo, dim_t hi) {
+        // A row belongs to the chunk containing its first non zero element.
+        // Trailing empty rows belong to the last chunk.
+        int rbeg = std::lower_bound(rowPtr, rowPtr + M, (int)lo) - rowPtr;
+        int rend = hi == nnz ? M : std::lower_bound(rowPtr, rowPtr + M, (int)hi) - rowPtr;
+        func(rbeg, rend);
+    });
+}
+
+// out[:, 0:N] = csr * right[:, 0:N] for a CSR matrix with M rows
+template<typename T, bool conjugate>
+void csrmm(T *outPtr, int ldc,
+           T const * const valPtr, int const * const rowPtr, int const * const colPtr,
+           int M, T const * const rightPtr, int ldb, int N)
+{
+    parallel_rows(rowPtr, M, [&](int rbeg, int rend) {
+        for (int o = 0; o < N; o += RHS_BLOCK) {
+            const int nb = std::min(RHS_BLOCK, N - o);
+            T const * const right = rightPtr + o * ldb;
+            T       * const out   = outPtr + o * ldc;
+
+            for (int i = rbeg; i < rend; ++i) {
+                T acc[RHS_BLOCK];
+                for (int k = 0; k < nb; ++k) acc[k] = scalar<T>(0);
+
+                for (int j = rowPtr[i]; j < rowPtr[i+1]; ++j) {
+                    //If stride[0] of right is not 1 then right[colPtr[j]*stride]
+                    const T val = conjugate ? getConjugate(valPtr[j]) : valPtr[j];
+                    T const * const r = right + colPtr[j];
+                    for (int k = 0; k < nb; ++k) {
+                        acc[k] += val * r[k * ldb];
+                    }
+                }
+
+                for (int k = 0; k < nb; ++k) out[i + k * ldc] = acc[k];
+            }
+        }
+    });
+}
+
+// Builds the CSR representation of the transpose (the CSC representation
+// of the input) so that transposed products are computed row by row
+// instead of scattering into the output
+template<typename T>
+void transposeCSR(std::vector<T> &tVal, std::vector<int> &tRow, std::vector<int> &tCol,
+                  T const * const valPtr, int const * const rowPtr, int const * const colPtr,
+                  int rows, int cols)
+{
+    const int nnz = rowPtr[rows];
+
+    tVal.resize(nnz);
+    tCol.resize(nnz);
+    tRow.assign(cols + 1, 0);
+
+    for (int j = 0; j < nnz; ++j) {
+        tRow[colPtr[j] + 1]++;
+    }
+    for (int c = 0; c < cols; ++c) {
+        tRow[c + 1] += tRow[c];
+    }
+
+    std::vector<int> next(tRow.begin(), tRow.end() - 1);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = rowPtr[i]; j < rowPtr[i+1]; ++j) {
+            int dst = next[colPtr[j]]++;
+            tVal[dst] = valPtr[j];
+            tCol[dst] = i;
+        }
+    }
+}
+
 template<typename T, bool conjugate>
 void mv(Array<T> output,
         const Array<T> values,
@@ -311,23 +399,9 @@ void mv(Array<T> output,
         const Array<T> right,
         int M)
 {
-    T   const * const   valPtr = values.get();
-    int const * const   rowPtr = rowIdx.get();
-    int const * const   colPtr = colIdx.get();
-    T   const * const rightPtr = right.get();
-    T         * const   outPtr = output.get();
-
-    for (int i = 0; i < rowIdx.dims()[0]-1; ++i) {
-        outPtr[i] = scalar<T>(0);
-        for (int j = rowPtr[i]; j < rowPtr[i+1]; ++j) {
-            //If stride[0] of right is not 1 then rightPtr[colPtr[j]*stride]
-            if (conjugate) {
-                outPtr[i] += getConjugate(valPtr[j]) * rightPtr[colPtr[j]];
-            } else {
-                outPtr[i] += valPtr[j] * rightPtr[colPtr[j]];
-            }
-        }
-    }
+    csrmm<T, conjugate>(output.get(), 0,
+                        values.get(), rowIdx.get(), colIdx.get(),
+                        rowIdx.dims()[0]-1, right.get(), 0, 1);
 }
 
 template<typename T, bool conjugate>
@@ -338,26 +412,14 @@ void mtv(Array<T> output,
         const Array<T> right,
         int M)
 {
-    T   const * const   valPtr = values.get();
-    int const * const   rowPtr = rowIdx.get();
-    int const * const   colPtr = colIdx.get();
-    T   const * const rightPtr = right.get();
-    T         * const   outPtr = output.get();
-
-    for (int i = 0; i < M; ++i) {
-        outPtr[i] = scalar<T>(0);
-    }
-
-    for (int i = 0; i < rowIdx.dims()[0]-1; ++i) {
-        for (int j = rowPtr[i]; j < rowPtr[i+1]; ++j) {
-            //If stride[0] of right is not 1 then rightPtr[i*stride]
-            if (conjugate) {
-                outPtr[colPtr[j]] += getConjugate(valPtr[j]) * rightPtr[i];
-            } else {
-                outPtr[colPtr[j]] += valPtr[j] * rightPtr[i];
-            }
-        }
-    }
+    std::vector<T>   tVal;
+    std::vector<int> tRow, tCol;
+    transposeCSR(tVal, tRow, tCol, values.get(), rowIdx.get(), colIdx.get(),
+                 rowIdx.dims()[0]-1, M);
+
+    csrmm<T, conjugate>(output.get(), 0,
+                        tVal.data(), tRow.data(), tCol.data(),
+                        M, right.get(), 0, 1);
 }
 
 template<typename T, bool conjugate>
@@ -369,27 +431,9 @@ void mm(Array<T> output,
         int M, int N,
         int ldb, int ldc)
 {
-    T   const * const   valPtr = values.get();
-    int const * const   rowPtr = rowIdx.get();
-    int const * const   colPtr = colIdx.get();
-    T   const *       rightPtr = right.get();
-    T         *         outPtr = output.get();
-
-    for (int o = 0; o < N; ++o) {
-        for (int i = 0; i < rowIdx.dims()[0]-1; ++i) {
-            outPtr[i] = scalar<T>(0);
-            for (int j = rowPtr[i]; j < rowPtr[i+1]; ++j) {
-                //If stride[0] of right is not 1 then rightPtr[colPtr[j]*stride]
-                if (conjugate) {
-                    outPtr[i] += getConjugate(valPtr[j]) * rightPtr[colPtr[j]];
-                } else {
-                    outPtr[i] += valPtr[j] * rightPtr[colPtr[j]];
-                }
-            }
-        }
-        rightPtr += ldb;
-        outPtr += ldc;
-    }
+    csrmm<T, conjugate>(output.get(), ldc,
+                        values.get(), rowIdx.get(), colIdx.get(),
+                        rowIdx.dims()[0]-1, right.get(), ldb, N);
 }
 
 template<typename T, bool conjugate>
@@ -401,31 +445,16 @@ void mtm(Array<T> output,
         int M, int N,
         int ldb, int ldc)
 {
-    T   const * const   valPtr = values.get();
-    int const * const   rowPtr = rowIdx.get();
-    int const * const   colPtr = colIdx.get();
-    T   const *       rightPtr = right.get();
-    T         *         outPtr = output.get();
-
-    for (int o = 0; o < N; ++o) {
-        for (int i = 0; i < M; ++i) {
-            outPtr[i] = scalar<T>(0);
-        }
-
-        for (int i = 0; i < rowIdx.dims()[0]-1; ++i) {
-            for (int j = rowPtr[i]; j < rowPtr[i+1]; ++j) {
-                //If stride[0] of right is not 1 then rightPtr[i*stride]
-                if (conjugate) {
-                    outPtr[colPtr[j]] += getConjugate(valPtr[j]) * rightPtr[i];
-                } else {
-                    outPtr[colPtr[j]] += valPtr[j] * rightPtr[i];
-                }
-            }
-        }
-        rightPtr += ldb;
-        outPtr += ldc;
-    }
+    std::vector<T>   tVal;
+    std::vector<int> tRow, tCol;
+    transposeCSR(tVal, tRow, tCol, values.get(), rowIdx.get(), colIdx.get(),
+                 rowIdx.dims()[0]-1, M);
+
+    csrmm<T, conjugate>(output.get(), ldc,
+                        tVal.data(), tRow.data(), tCol.data(),
+                        M, right.get(), ldb, N);
 }
+
 template<typename T>
 Array<T> matmul(const common::SparseArray<T> lhs, const Array<T> rhs,
                 af_mat_prop optLhs, af_mat_prop optRhs)
@@ -0,0 +1,198 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <thread_pool.hpp>
+#include <util.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace cpu
+{
+
+static thread_local bool is_in_task = false;
+
+static inline unsigned long long packRange(unsigned lo, unsigned hi)
+{
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+static inline unsigned rangeLo(unsigned long long range) { return (unsigned)range; }
+static inline unsigned rangeHi(unsigned long long range) { return (unsigned)(range >> 32); }
+
+thread_pool::thread_pool(unsigned num_threads) :
+    job(NULL),
+    ranges(std::max(1u, num_threads)),
+    failed(false),
+    active(0),
+    generation(0),
+    stop(false)
+{
+    for (unsigned i = 1; i < num_threads; i++) {
+        workers.emplace_back(&thread_pool::worker_loop, this, i);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+bool thread_pool::in_task()
+{
+    return is_in_task;
+}
+
+// Takes the next task from the front of the range owned by thread id
+bool thread_pool::pop(unsigned id, int &task)
+{
+    task_range &range = ranges[id];
+    unsigned long long cur = range.load();
+    while (rangeLo(cur) < rangeHi(cur)) {
+        if (range.compare_exchange_weak(cur, packRange(rangeLo(cur) + 1, rangeHi(cur)))) {
+            task = rangeLo(cur);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves the back half of the tasks of another thread to thread id
+bool thread_pool::steal(unsigned id)
+{
+    unsigned num = ranges.size();
+    for (unsigned i = 1; i < num; i++) {
+        task_range &victim = ranges[(id + i) % num];
+        unsigned long long cur = victim.load();
+        while (rangeLo(cur) < rangeHi(cur)) {
+            unsigned lo = rangeLo(cur);
+            unsigned hi = rangeHi(cur);
+            unsigned mid = lo + (hi - lo) / 2;
+            if (victim.compare_exchange_weak(cur, packRange(lo, mid))) {
+                ranges[id].store(packRange(mid, hi));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void thread_pool::work(unsigned id)
+{
+    is_in_task = true;
+    int task;
+    do {
+        while (!failed && pop(id, task)) {
+            try {
+                (*job)(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (!error) error = std::current_exception();
+                // Skip the remaining tasks
+                failed = true;
+            }
+        }
+    } while (!failed && steal(id));
+    is_in_task = false;
+}
+
+void thread_pool::worker_loop(unsigned id)
+{
+    unsigned seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            work_cv.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+        }
+
+        work(id);
+
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (--active == 0) done_cv.notify_one();
+        }
+    }
+}
+
+void thread_pool::run(int count, const std::function<void(int)> &func)
+{
+    if (count <= 0) return;
+
+    if (workers.empty() || in_task() || count == 1) {
+        for (int i = 0; i < count; i++) func(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        job = &func;
+
+        // Give every thread an equal share of the tasks
+        unsigned num = ranges.size();
+        for (unsigned i = 0; i < num; i++) {
+            ranges[i].store(packRange((unsigned)((dim_t)count * i / num),
+                                      (unsigned)((dim_t)count * (i + 1) / num)));
+        }
+
+        failed = false;
+        active = workers.size();
+        error = nullptr;
+        generation++;
+    }
+    work_cv.notify_all();
+
+    work(0);
+
+    std::exception_ptr err;
+    {
+        std::unique_lock<std::mutex> lock(state_mutex);
+        done_cv.wait(lock, [&] { return active == 0; });
+        job = NULL;
+        err = error;
+        error = nullptr;
+    }
+
+    if (err) std::rethrow_exception(err);
+}
+
+static unsigned getNumThreads()
+{
+    std::string env_var = getEnvVar("AF_CPU_NUM_THREADS");
+    if (!env_var.empty()) {
+        // Malformed, out of range and non positive values are ignored
+        char *end = NULL;
+        errno = 0;
+        long num = std::strtol(env_var.c_str(), &end, 10);
+        if (errno == 0 && end != env_var.c_str() && *end == '\0' &&
+            num > 0 && num <= std::numeric_limits<int>::max())
+            return (unsigned)num;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+thread_pool& getThreadPool()
+{
+    static thread_pool pool(getNumThreads());
+    return pool;
+}
+
+}
@@ -0,0 +1,127 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <af/defines.h>
+#include <af/dim4.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu
+{
+
+// Minimum number of elements processed by a single task
+const dim_t MIN_TASK_WORK = 1 << 14;
+
+/// Pool of worker threads used to split a kernel across cores
+///
+/// Every thread starts with an equal share of the tasks and steals half of
+/// the remaining tasks of another thread once it runs out of work.
+///
+/// The thread calling run() takes part in the work and returns only after
+/// all the tasks have completed. Calls to run() from inside a task are
+/// executed serially on the calling thread.
+///
+/// The number of threads is set by the AF_CPU_NUM_THREADS environment
+/// variable and defaults to the number of cores.
+class thread_pool
+{
+public:
+    thread_pool(unsigned num_threads);
+    ~thread_pool();
+
+    /// Number of threads taking part in a run, including the caller
+    unsigned size() const { return workers.size() + 1; }
+
+    /// Calls func(i) for every i in [0, num_tasks)
+    void run(int num_tasks, const std::function<void(int)> &func);
+
+    /// Returns true when called from inside a task
+    static bool in_task();
+
+private:
+    // Range of task indices [lo, hi) packed into a single atomic
+    typedef std::atomic<unsigned long long> task_range;
+
+    bool pop(unsigned id, int &task);
+    bool steal(unsigned id);
+    void work(unsigned id);
+    void worker_loop(unsigned id);
+
+    std::vector<std::thread> workers;
+
+    std::mutex run_mutex;
+    std::mutex state_mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+
+    const std::function<void(int)> *job;
+    std::vector<task_range> ranges;
+    std::atomic<bool> failed;
+    unsigned active;
+    unsigned generation;
+    bool stop;
+    std::exception_ptr error;
+};
+
+thread_pool& getThreadPool();
+
+/// Splits [begin, end) into chunks of at least grain elements and calls
+/// func(chunk_begin, chunk_end) for each chunk on the thread pool
+template<typename F>
+void parallel_for(dim_t begin, dim_t end, dim_t grain, F func)
+{
+    dim_t len = end - begin;
+    if (len <= 0) return;
+
+    thread_pool &pool = getThreadPool();
+    grain = std::max<dim_t>(grain, 1);
+
+    if (len <= grain || pool.size() == 1 || thread_pool::in_task()) {
+        func(begin, end);
+        return;
+    }
+
+    // A few chunks per thread to balance uneven work
+    dim_t num_chunks = std::min<dim_t>((len + grain - 1) / grain, 4 * pool.size());
+    dim_t chunk = (len + num_chunks - 1) / num_chunks;
+    num_chunks = (len + chunk - 1) / chunk;
+
+    pool.run((int)num_chunks, [&](int i) {
+        dim_t lo = begin + i * chunk;
+        dim_t hi = std::min(lo + chunk, end);
+        func(lo, hi);
+    });
+}
+
+/// Calls func(b1, b2, b3) for every index of the batch dimensions 1-3 of
+/// dims on the thread pool. work is the number of elements processed by a
+/// single call and is used to decide how many calls make a task.
+template<typename F>
+void parallel_for_batch(const af::dim4 &dims, dim_t work, F func)
+{
+    const dim_t d1 = dims[1];
+    const dim_t d2 = dims[2];
+    const dim_t batches = d1 * d2 * dims[3];
+    const dim_t grain = (MIN_TASK_WORK + work - 1) / std::max<dim_t>(work, 1);
+
+    parallel_for(0, batches, grain, [&](dim_t lo, dim_t hi) {
+        for (dim_t b = lo; b < hi; b++) {
+            func(b % d1, (b / d1) % d2, b / (d1 * d2));
+        }
+    });
+}
+
+}
@@ -8,13 +8,15 @@
  ********************************************************/
 
 #include <complex>
+#include <climits>
 #include <af/dim4.hpp>
 #include <Array.hpp>
-#include <memory.hpp>
+#include <err_cpu.hpp>
 #include <where.hpp>
 #include <ops.hpp>
-#include <vector>
 #include <platform.hpp>
+#include <queue.hpp>
+#include <kernel/where.hpp>
 
 using af::dim4;
 
@@ -24,46 +26,29 @@ namespace cpu
 template<typename T>
 Array<uint> where(const Array<T> &in)
 {
+    if (in.elements() > UINT_MAX) {
+        AF_ERROR("Too many elements for 32 bit indices", AF_ERR_SIZE);
+    }
+
+    // The size of the output depends on the data
     in.eval();
     getQueue().sync();
 
-    const dim_t *dims    = in.dims().get();
-    const dim_t *strides = in.strides().get();
-    static const T zero = scalar<T>(0);
-
-    const T *iptr = in.get();
-    uint *out_vec  = memAlloc<uint>(in.elements());
-
-    dim_t count = 0;
-    dim_t idx = 0;
-    for (dim_t w = 0; w < dims[3]; w++) {
-        uint offw = w * strides[3];
-
-        for (dim_t z = 0; z < dims[2]; z++) {
-            uint offz = offw + z * strides[2];
-
-            for (dim_t y = 0; y < dims[1]; y++) {
-                uint offy = y * strides[1] + offz;
-
-                for (dim_t x = 0; x < dims[0]; x++) {
+    return kernel::where<T, uint>(in);
+}
 
-                    T val = iptr[offy + x];
-                    if (val != zero) {
-                        out_vec[count] = idx;
-                        count++;
-                    }
-                    idx++;
-                }
-            }
-        }
-    }
+template<typename T>
+Array<uintl> where64(const Array<T> &in)
+{
+    in.eval();
+    getQueue().sync();
 
-    Array<uint> out = createDeviceDataArray<uint>(dim4(count), out_vec);
-    return out;
+    return kernel::where<T, uintl>(in);
 }
 
-#define INSTANTIATE(T)                                  \
-    template Array<uint> where<T>(const Array<T> &in);    \
+#define INSTANTIATE(T)                                      \
+    template Array<uint > where  <T>(const Array<T> &in);   \
+    template Array<uintl> where64<T>(const Array<T> &in);   \
 
 INSTANTIATE(float  )
 INSTANTIATE(cfloat )
@@ -257,6 +257,13 @@ namespace cuda
         return Array<T>(size, data, false);
     }
 
+    template<typename T>
+    Array<T> createHostMappedArray(const dim4 &size, const T * const data,
+                                   std::shared_ptr<void> mapping)
+    {
+        return createHostDataArray<T>(size, data);
+    }
+
     template<typename T>
     Array<T> createDeviceDataArray(const dim4 &size, const void *data)
     {
@@ -363,6 +370,8 @@ namespace cuda
 
 #define INSTANTIATE(T)                                                  \
     template       Array<T>  createHostDataArray<T>   (const dim4 &size, const T * const data); \
+    template       Array<T>  createHostMappedArray<T> (const dim4 &size, const T * const data, \
+                                                       std::shared_ptr<void> mapping); \
     template       Array<T>  createDeviceDataArray<T> (const dim4 &size, const void *data); \
     template       Array<T>  createValueArray<T>      (const dim4 &size, const T &value); \
     template       Array<T>  createEmptyArray<T>      (const dim4 &size); \
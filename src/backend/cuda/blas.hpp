@@ -20,6 +20,23 @@ template<typename T>
 Array<T> dot(const Array<T> &lhs, const Array<T> &rhs,
              af_mat_prop optLhs, af_mat_prop optRhs);
 
+/// Dot products of the columns of lhs and rhs along dim
+template<typename T>
+Array<T> dot(const Array<T> &lhs, const Array<T> &rhs, const int dim,
+             af_mat_prop optLhs, af_mat_prop optRhs);
+
+/// y = alpha * x + y, in place
+template<typename T>
+void axpy(Array<T> &y, const Array<T> &x, const double alpha);
+
+/// x = alpha * x, in place
+template<typename T>
+void scal(Array<T> &x, const double alpha);
+
+/// Euclidean norm of all the elements of in
+template<typename T>
+double nrm2(const Array<T> &in);
+
 template<typename T>
 void trsm(const Array<T> &lhs, Array<T> &rhs, af_mat_prop trans = AF_MAT_NONE,
           bool is_upper = false, bool is_left = true, bool is_unit = false);
@@ -92,6 +92,10 @@ CH_FUNC(potrf , cdouble, Z)
 template<typename T>
 Array<T> cholesky(int *info, const Array<T> &in, const bool is_upper)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("cholesky can not be used in batch mode", AF_ERR_BATCH);
+    }
+
 
     Array<T> out = copyArray<T>(in);
     *info = cholesky_inplace(out, is_upper);
@@ -105,6 +109,10 @@ Array<T> cholesky(int *info, const Array<T> &in, const bool is_upper)
 template<typename T>
 int cholesky_inplace(Array<T> &in, const bool is_upper)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("cholesky can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     dim4 iDims = in.dims();
     int N = iDims[0];
 
@@ -156,12 +164,20 @@ namespace cuda
 template<typename T>
 Array<T> cholesky(int *info, const Array<T> &in, const bool is_upper)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("cholesky can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::cholesky(info, in, is_upper);
 }
 
 template<typename T>
 int cholesky_inplace(Array<T> &in, const bool is_upper)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("cholesky can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::cholesky_inplace(in, is_upper);
 }
 
@@ -76,6 +76,27 @@ Array<T> convolve2(Array<T> const& signal, Array<accT> const& c_filter, Array<ac
     return out;
 }
 
+bool isFreqDomainPreferred(const dim4 &sDims, const dim4 &fDims, const int baseDim)
+{
+    if (baseDim == 1) {
+        if (fDims[0] > 128) return true;
+    }
+
+    if (baseDim == 2) {
+        // maximum supported size in 2D domain
+        if (fDims[0] > 17 || fDims[1] > 17) return true;
+
+        // Maximum supported non square size
+        if (fDims[0] != fDims[1] && fDims[0] > 5) return true;
+    }
+
+    if (baseDim == 3) {
+        if (fDims[0] > 5 || fDims[1] > 5 || fDims[2] > 5) return true;
+    }
+
+    return false;
+}
+
 #define INSTANTIATE(T, accT)                                            \
     template Array<T> convolve <T, accT, 1, true >(Array<T> const& signal, Array<accT> const& filter, AF_BATCH_KIND kind); \
     template Array<T> convolve <T, accT, 1, false>(Array<T> const& signal, Array<accT> const& filter, AF_BATCH_KIND kind); \
@@ -18,4 +18,8 @@ Array<T> convolve(Array<T> const& signal, Array<accT> const& filter, AF_BATCH_KI
 template<typename T, typename accT, bool expand>
 Array<T> convolve2(Array<T> const& signal, Array<accT> const& c_filter, Array<accT> const& r_filter);
 
+// Whether af_convolve with AF_CONV_AUTO should take the FFT path for a
+// baseDim dimensional filter of size fDims over a signal of size sDims
+bool isFreqDomainPreferred(const af::dim4 &sDims, const af::dim4 &fDims, const int baseDim);
+
 }
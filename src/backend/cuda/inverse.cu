@@ -21,6 +21,10 @@ namespace cuda
 template<typename T>
 Array<T> inverse(const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("inverse can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     Array<T> I = identity<T>(in.dims());
     return solve<T>(in, I);
 }
@@ -44,6 +48,10 @@ namespace cuda
 template<typename T>
 Array<T> inverse(const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("inverse can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::inverse(in);
 }
 
@@ -63,7 +63,7 @@ struct dist_op<uintl, To, AF_SHD>
 {
     __device__ To operator()(uintl v1, uintl v2)
     {
-        return __popc(v1 ^ v2);
+        return __popcll(v1 ^ v2);
     }
 };
 
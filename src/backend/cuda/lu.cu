@@ -107,6 +107,10 @@ void convertPivot(Array<int> &pivot, int out_sz)
 template<typename T>
 void lu(Array<T> &lower, Array<T> &upper, Array<int> &pivot, const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("lu can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     dim4 iDims = in.dims();
     int M = iDims[0];
     int N = iDims[1];
@@ -125,6 +129,10 @@ void lu(Array<T> &lower, Array<T> &upper, Array<int> &pivot, const Array<T> &in)
 template<typename T>
 Array<int> lu_inplace(Array<T> &in, const bool convert_pivot)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("lu can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     dim4 iDims = in.dims();
     int M = iDims[0];
     int N = iDims[1];
@@ -182,12 +190,20 @@ namespace cuda
 template<typename T>
 void lu(Array<T> &lower, Array<T> &upper, Array<int> &pivot, const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("lu can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::lu(lower, upper, pivot, in);
 }
 
 template<typename T>
 Array<int> lu_inplace(Array<T> &in, const bool convert_pivot)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("lu can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::lu_inplace(in, convert_pivot);
 }
 
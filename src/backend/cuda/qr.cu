@@ -126,6 +126,10 @@ MQR_FUNC(mqr , cdouble, Zunmqr)
 template<typename T>
 void qr(Array<T> &q, Array<T> &r, Array<T> &t, const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("qr can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     dim4 iDims = in.dims();
     int M = iDims[0];
     int N = iDims[1];
@@ -181,6 +185,10 @@ void qr(Array<T> &q, Array<T> &r, Array<T> &t, const Array<T> &in)
 template<typename T>
 Array<T> qr_inplace(Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("qr can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     dim4 iDims = in.dims();
     int M = iDims[0];
     int N = iDims[1];
@@ -228,12 +236,20 @@ namespace cuda
 template<typename T>
 void qr(Array<T> &q, Array<T> &r, Array<T> &t, const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("qr can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::qr(q, r, t, in);
 }
 
 template<typename T>
 Array<T> qr_inplace(Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("qr can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     return cpu::qr_inplace(in);
 }
 
@@ -0,0 +1,21 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <Array.hpp>
+#include <vector>
+
+namespace cuda
+{
+
+/// Linearly interpolated quantiles along dim. The output has one element
+/// along dim for each of probs.
+template<typename T, typename To>
+Array<To> quantile(const Array<T> &in, const std::vector<double> &probs, const int dim);
+
+}
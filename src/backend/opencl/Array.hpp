@@ -49,6 +49,12 @@ namespace opencl
     template<typename T>
     Array<T> createDeviceDataArray(const af::dim4 &size, const void *data);
 
+    // Creates an Array from host memory that is kept alive by mapping.
+    // The CPU backend uses the memory directly, other backends copy it.
+    template<typename T>
+    Array<T> createHostMappedArray(const af::dim4 &size, const T * const data,
+                                   std::shared_ptr<void> mapping);
+
     // Copies data to an existing Array object from a host pointer
     template<typename T>
     void writeHostDataArray(Array<T> &arr, const T * const data, const size_t bytes);
@@ -25,9 +25,18 @@ Array<outType> bilateral(const Array<inType> &in, const float &s_sigma, const fl
     return out;
 }
 
+// There is no grid kernel on this backend, the exact filter is used
+template<typename inType, typename outType, bool isColor>
+Array<outType> bilateralGrid(const Array<inType> &in, const float &s_sigma, const float &c_sigma)
+{
+    return bilateral<inType, outType, isColor>(in, s_sigma, c_sigma);
+}
+
 #define INSTANTIATE(inT, outT)\
 template Array<outT> bilateral<inT, outT,true >(const Array<inT> &in, const float &s_sigma, const float &c_sigma);\
-template Array<outT> bilateral<inT, outT,false>(const Array<inT> &in, const float &s_sigma, const float &c_sigma);
+template Array<outT> bilateral<inT, outT,false>(const Array<inT> &in, const float &s_sigma, const float &c_sigma);\
+template Array<outT> bilateralGrid<inT, outT,true >(const Array<inT> &in, const float &s_sigma, const float &c_sigma);\
+template Array<outT> bilateralGrid<inT, outT,false>(const Array<inT> &in, const float &s_sigma, const float &c_sigma);
 
 INSTANTIATE(double, double)
 INSTANTIATE(float ,  float)
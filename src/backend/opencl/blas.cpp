@@ -21,6 +21,9 @@
 #include <arith.hpp>
 #include <reduce.hpp>
 #include <complex.hpp>
+#include <copy.hpp>
+#include <af/traits.hpp>
+#include <cmath>
 
 #if defined(WITH_OPENCL_LINEAR_ALGEBRA)
 #include <cpu/cpu_blas.hpp>
@@ -119,6 +122,10 @@ template<typename T>
 Array<T> matmul(const Array<T> &lhs, const Array<T> &rhs,
                 af_mat_prop optLhs, af_mat_prop optRhs)
 {
+    if (lhs.ndims() > 2 || rhs.ndims() > 2) {
+        AF_ERROR("matmul can not be used in batch mode", AF_ERR_BATCH);
+    }
+
 #if defined(WITH_OPENCL_LINEAR_ALGEBRA)
     if(OpenCLCPUOffload(false)) {   // Do not force offload gemm on OSX Intel devices
         return cpu::matmul(lhs, rhs, optLhs, optRhs);
@@ -183,12 +190,44 @@ Array<T> matmul(const Array<T> &lhs, const Array<T> &rhs,
 template<typename T>
 Array<T> dot(const Array<T> &lhs, const Array<T> &rhs,
              af_mat_prop optLhs, af_mat_prop optRhs)
+{
+    return dot<T>(lhs, rhs, 0, optLhs, optRhs);
+}
+
+template<typename T>
+Array<T> dot(const Array<T> &lhs, const Array<T> &rhs, const int dim,
+             af_mat_prop optLhs, af_mat_prop optRhs)
 {
     const Array<T> lhs_ = (optLhs == AF_MAT_NONE ? lhs : conj<T>(lhs));
     const Array<T> rhs_ = (optRhs == AF_MAT_NONE ? rhs : conj<T>(rhs));
 
     const Array<T> temp = arithOp<T, af_mul_t>(lhs_, rhs_, lhs_.dims());
-    return reduce<af_add_t, T, T>(temp, 0, false, 0);
+    return reduce<af_add_t, T, T>(temp, dim, false, 0);
+}
+
+template<typename T>
+void axpy(Array<T> &y, const Array<T> &x, const double alpha)
+{
+    const Array<T> a  = createValueArray<T>(y.dims(), scalar<T>(alpha));
+    const Array<T> ax = arithOp<T, af_mul_t>(a, x, y.dims());
+    copyArray<T, T>(y, arithOp<T, af_add_t>(y, ax, y.dims()));
+}
+
+template<typename T>
+void scal(Array<T> &x, const double alpha)
+{
+    const Array<T> a = createValueArray<T>(x.dims(), scalar<T>(alpha));
+    copyArray<T, T>(x, arithOp<T, af_mul_t>(x, a, x.dims()));
+}
+
+template<typename T>
+double nrm2(const Array<T> &in)
+{
+    typedef typename af::dtype_traits<T>::base_type BT;
+
+    const Array<BT> mag    = abs<BT, T>(in);
+    const Array<BT> mag_sq = arithOp<BT, af_mul_t>(mag, mag, mag.dims());
+    return std::sqrt(reduce_all<af_add_t, BT, BT>(mag_sq));
 }
 
 #define INSTANTIATE_BLAS(TYPE)                                                          \
@@ -202,7 +241,14 @@ INSTANTIATE_BLAS(cdouble)
 
 #define INSTANTIATE_DOT(TYPE)                                                       \
     template Array<TYPE> dot<TYPE>(const Array<TYPE> &lhs, const Array<TYPE> &rhs,  \
-                                   af_mat_prop optLhs, af_mat_prop optRhs);
+                                   af_mat_prop optLhs, af_mat_prop optRhs);         \
+    template Array<TYPE> dot<TYPE>(const Array<TYPE> &lhs, const Array<TYPE> &rhs,  \
+                                   const int dim,                                   \
+                                   af_mat_prop optLhs, af_mat_prop optRhs);         \
+    template void axpy<TYPE>(Array<TYPE> &y, const Array<TYPE> &x,                  \
+                             const double alpha);                                   \
+    template void scal<TYPE>(Array<TYPE> &x, const double alpha);                   \
+    template double nrm2<TYPE>(const Array<TYPE> &in);
 
 INSTANTIATE_DOT(float)
 INSTANTIATE_DOT(double)
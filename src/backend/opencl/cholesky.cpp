@@ -25,6 +25,10 @@ namespace opencl
 template<typename T>
 int cholesky_inplace(Array<T> &in, const bool is_upper)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("cholesky can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::cholesky_inplace(in, is_upper);
@@ -51,6 +55,10 @@ int cholesky_inplace(Array<T> &in, const bool is_upper)
 template<typename T>
 Array<T> cholesky(int *info, const Array<T> &in, const bool is_upper)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("cholesky can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::cholesky(info, in, is_upper);
@@ -21,6 +21,10 @@ namespace opencl
 template<typename T>
 Array<T> inverse(const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("inverse can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     if(OpenCLCPUOffload()) {
         if (in.dims()[0] == in.dims()[1])
             return cpu::inverse(in);
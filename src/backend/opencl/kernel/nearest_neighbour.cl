@@ -9,14 +9,12 @@
 
 // OpenCL < 1.2 compatibility
 #if !defined(__OPENCL_VERSION__) || __OPENCL_VERSION__ < 120
-__inline unsigned popcount(unsigned x)
+__inline unsigned popcount(ulong x)
 {
-    x = x - ((x >> 1) & 0x55555555);
-    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
-    x = (x + (x >> 4)) & 0x0F0F0F0F;
-    x = x + (x >> 8);
-    x = x + (x >> 16);
-    return x & 0x0000003F;
+    x = x - ((x >> 1) & 0x5555555555555555UL);
+    x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FUL;
+    return (unsigned)((x * 0x0101010101010101UL) >> 56);
 }
 #endif
 
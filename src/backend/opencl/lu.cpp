@@ -43,6 +43,10 @@ Array<int> convertPivot(int *ipiv, int in_sz, int out_sz)
 template<typename T>
 void lu(Array<T> &lower, Array<T> &upper, Array<int> &pivot, const Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("lu can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::lu(lower, upper, pivot, in);
@@ -71,6 +75,10 @@ void lu(Array<T> &lower, Array<T> &upper, Array<int> &pivot, const Array<T> &in)
 template<typename T>
 Array<int> lu_inplace(Array<T> &in, const bool convert_pivot)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("lu can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::lu_inplace(in, convert_pivot);
@@ -0,0 +1,133 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <af/dim4.hpp>
+#include <Array.hpp>
+#include <meanvar.hpp>
+#include <arith.hpp>
+#include <cast.hpp>
+#include <math.hpp>
+#include <reduce.hpp>
+#include <tile.hpp>
+#include <err_opencl.hpp>
+
+using af::dim4;
+
+namespace opencl
+{
+
+template<typename T>
+static Array<T> deviations(const Array<T> &in, const Array<T> &mean, const int dim)
+{
+    dim4 iDims = in.dims();
+    dim4 tileDims(1);
+    tileDims[dim] = iDims[dim];
+    return arithOp<T, af_sub_t>(in, tile<T>(mean, tileDims), iDims);
+}
+
+template<typename T>
+static Array<T> sumOfProducts(const Array<T> &x, const Array<T> &y, const int dim)
+{
+    return reduce<af_add_t, T, T>(arithOp<T, af_mul_t>(x, y, x.dims()), dim);
+}
+
+template<typename Ti, typename To>
+void meanvar(Array<To> &mean, Array<To> &var, const Array<Ti> &in,
+             const bool isbiased, const int dim)
+{
+    Array<To> input = cast<To, Ti>(in);
+    dim_t n = input.dims()[dim];
+
+    Array<To> sum = reduce<af_add_t, To, To>(input, dim);
+    dim4 oDims = sum.dims();
+    mean = arithOp<To, af_div_t>(sum, createValueArray<To>(oDims, scalar<To>(n)), oDims);
+
+    Array<To> diff  = deviations<To>(input, mean, dim);
+    Array<To> sumSq = sumOfProducts<To>(diff, diff, dim);
+    var = arithOp<To, af_div_t>(sumSq, createValueArray<To>(oDims, scalar<To>(isbiased ? n : n - 1)), oDims);
+}
+
+template<typename Ti, typename To, typename Tw>
+void meanvar(Array<To> &mean, Array<To> &var, const Array<Ti> &in,
+             const Array<Tw> &weights, const int dim)
+{
+    Array<To> input = cast<To, Ti>(in);
+    Array<To> wts   = cast<To, Tw>(weights);
+
+    Array<To> wtsSum = reduce<af_add_t, To, To>(wts, dim);
+    Array<To> wtdSum = sumOfProducts<To>(input, wts, dim);
+    dim4 oDims = wtsSum.dims();
+    mean = arithOp<To, af_div_t>(wtdSum, wtsSum, oDims);
+
+    Array<To> diff   = deviations<To>(input, mean, dim);
+    Array<To> diffSq = arithOp<To, af_mul_t>(diff, diff, diff.dims());
+    Array<To> wtdSq  = sumOfProducts<To>(diffSq, wts, dim);
+    var = arithOp<To, af_div_t>(wtdSq, wtsSum, oDims);
+}
+
+template<typename Ti, typename To>
+void comoments(Array<To> &mx, Array<To> &my, Array<To> &cxx, Array<To> &cyy,
+               Array<To> &cxy, const Array<Ti> &x, const Array<Ti> &y)
+{
+    Array<To> xIn = cast<To, Ti>(x);
+    Array<To> yIn = cast<To, Ti>(y);
+
+    Array<To> xSum = reduce<af_add_t, To, To>(xIn, 0);
+    Array<To> ySum = reduce<af_add_t, To, To>(yIn, 0);
+    dim4 oDims = xSum.dims();
+    Array<To> rows = createValueArray<To>(oDims, scalar<To>(xIn.dims()[0]));
+    mx = arithOp<To, af_div_t>(xSum, rows, oDims);
+    my = arithOp<To, af_div_t>(ySum, rows, oDims);
+
+    Array<To> dx = deviations<To>(xIn, mx, 0);
+    Array<To> dy = deviations<To>(yIn, my, 0);
+    cxx = sumOfProducts<To>(dx, dx, 0);
+    cyy = sumOfProducts<To>(dy, dy, 0);
+    cxy = sumOfProducts<To>(dx, dy, 0);
+}
+
+#define INSTANTIATE_MEANVAR(Ti, To, Tw)                                         \
+    template void meanvar<Ti, To>(Array<To> &mean, Array<To> &var,              \
+                                  const Array<Ti> &in, const bool isbiased,     \
+                                  const int dim);                               \
+    template void meanvar<Ti, To, Tw>(Array<To> &mean, Array<To> &var,          \
+                                      const Array<Ti> &in,                      \
+                                      const Array<Tw> &weights, const int dim);
+
+INSTANTIATE_MEANVAR(float  , float  , float )
+INSTANTIATE_MEANVAR(double , double , double)
+INSTANTIATE_MEANVAR(cfloat , cfloat , float )
+INSTANTIATE_MEANVAR(cdouble, cdouble, double)
+INSTANTIATE_MEANVAR(int    , float  , float )
+INSTANTIATE_MEANVAR(uint   , float  , float )
+INSTANTIATE_MEANVAR(intl   , double , double)
+INSTANTIATE_MEANVAR(uintl  , double , double)
+INSTANTIATE_MEANVAR(short  , float  , float )
+INSTANTIATE_MEANVAR(ushort , float  , float )
+INSTANTIATE_MEANVAR(uchar  , float  , float )
+INSTANTIATE_MEANVAR(char   , float  , float )
+
+#define INSTANTIATE_COMOMENTS(Ti, To)                                           \
+    template void comoments<Ti, To>(Array<To> &mx, Array<To> &my,               \
+                                    Array<To> &cxx, Array<To> &cyy,             \
+                                    Array<To> &cxy, const Array<Ti> &x,         \
+                                    const Array<Ti> &y);
+
+INSTANTIATE_COMOMENTS(float  , float )
+INSTANTIATE_COMOMENTS(double , double)
+INSTANTIATE_COMOMENTS(int    , float )
+INSTANTIATE_COMOMENTS(uint   , float )
+INSTANTIATE_COMOMENTS(intl   , double)
+INSTANTIATE_COMOMENTS(uintl  , double)
+INSTANTIATE_COMOMENTS(short  , float )
+INSTANTIATE_COMOMENTS(ushort , float )
+INSTANTIATE_COMOMENTS(uchar  , float )
+INSTANTIATE_COMOMENTS(char   , float )
+
+}
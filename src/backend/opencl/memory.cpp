@@ -252,6 +252,13 @@ void deviceMemoryInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                                   lock_bytes,  lock_buffers);
 }
 
+void deviceMemoryStats(size_t *alloc_hits, size_t *alloc_misses,
+                       size_t *peak_bytes, size_t *requested_bytes)
+{
+    getMemoryManager().bufferStats(alloc_hits, alloc_misses,
+                                   peak_bytes, requested_bytes);
+}
+
 template<typename T>
 T* pinnedAlloc(const size_t &elements)
 {
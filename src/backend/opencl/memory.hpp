@@ -37,6 +37,8 @@ namespace opencl
 
     void deviceMemoryInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                           size_t *lock_bytes,  size_t *lock_buffers);
+    void deviceMemoryStats(size_t *alloc_hits, size_t *alloc_misses,
+                           size_t *peak_bytes, size_t *requested_bytes);
     void garbageCollect();
     void pinnedGarbageCollect();
 
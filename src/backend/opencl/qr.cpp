@@ -29,6 +29,10 @@ namespace opencl
 template<typename T>
 void qr(Array<T> &q, Array<T> &r, Array<T> &t, const Array<T> &orig)
 {
+    if (orig.dims()[2] * orig.dims()[3] > 1) {
+        AF_ERROR("qr can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::qr(q, r, t, orig);
@@ -87,6 +91,10 @@ void qr(Array<T> &q, Array<T> &r, Array<T> &t, const Array<T> &orig)
 template<typename T>
 Array<T> qr_inplace(Array<T> &in)
 {
+    if (in.dims()[2] * in.dims()[3] > 1) {
+        AF_ERROR("qr can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::qr_inplace(in);
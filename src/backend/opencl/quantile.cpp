@@ -0,0 +1,83 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <af/dim4.hpp>
+#include <Array.hpp>
+#include <quantile.hpp>
+#include <arith.hpp>
+#include <cast.hpp>
+#include <lookup.hpp>
+#include <select.hpp>
+#include <sort.hpp>
+#include <tile.hpp>
+#include <err_opencl.hpp>
+#include <algorithm>
+#include <cmath>
+
+using af::dim4;
+
+namespace opencl
+{
+
+template<typename T, typename To>
+Array<To> quantile(const Array<T> &input, const std::vector<double> &probs, const int dim)
+{
+    // Sort once and read both neighbouring ranks of every quantile
+    const dim_t len = input.dims()[dim];
+    const dim_t nprobs = probs.size();
+
+    // Every quantile is read from the ranks lo and hi with weight frac for hi
+    std::vector<uint> lo(nprobs), hi(nprobs);
+    std::vector<To> frac(nprobs), rest(nprobs);
+    std::vector<char> exact(nprobs);
+    for (dim_t k = 0; k < nprobs; k++) {
+        double h = probs[k] * (len - 1);
+        lo[k]    = std::min<dim_t>((dim_t)std::floor(h), len - 1);
+        frac[k]  = To(h - lo[k]);
+        rest[k]  = To(1) - frac[k];
+        exact[k] = frac[k] == To(0);
+        hi[k]    = exact[k] ? lo[k] : std::min<dim_t>(lo[k] + 1, len - 1);
+    }
+
+    dim4 pdims(1, 1, 1, 1);
+    pdims[dim] = nprobs;
+    dim4 tdims = input.dims();
+    tdims[dim] = 1;
+
+    Array<To> sorted = cast<To, T>(sort<T>(input, dim, true));
+    Array<To> left   = lookup<To, uint>(sorted, createHostDataArray<uint>(dim4(nprobs), lo.data()), dim);
+    Array<To> right  = lookup<To, uint>(sorted, createHostDataArray<uint>(dim4(nprobs), hi.data()), dim);
+
+    dim4 odims = left.dims();
+    Array<To> wright = tile<To>(createHostDataArray<To>(pdims, frac.data()), tdims);
+    Array<To> wleft  = tile<To>(createHostDataArray<To>(pdims, rest.data()), tdims);
+    Array<To> mixed  = arithOp<To, af_add_t>(arithOp<To, af_mul_t>(left, wleft, odims),
+                                             arithOp<To, af_mul_t>(right, wright, odims), odims);
+
+    // Exact ranks skip the interpolation, which is not finite for infinities
+    Array<char> cond = tile<char>(createHostDataArray<char>(pdims, exact.data()), tdims);
+    Array<To> out = createEmptyArray<To>(odims);
+    select<To>(out, cond, left, mixed);
+    return out;
+}
+
+#define INSTANTIATE(T, To)                                              \
+    template Array<To> quantile<T, To>(const Array<T> &in, const std::vector<double> &probs, const int dim);
+
+INSTANTIATE(float , float )
+INSTANTIATE(double, double)
+INSTANTIATE(int   , float )
+INSTANTIATE(uint  , float )
+INSTANTIATE(int   , double)
+INSTANTIATE(uint  , double)
+INSTANTIATE(short , float )
+INSTANTIATE(ushort, float )
+INSTANTIATE(uchar , float )
+
+}
@@ -36,6 +36,11 @@ template<typename T>
 Array<T> solveLU(const Array<T> &A, const Array<int> &pivot,
                  const Array<T> &b, const af_mat_prop options)
 {
+    if (A.dims()[2] * A.dims()[3] > 1 ||
+        b.dims()[2] * b.dims()[3] > 1) {
+        AF_ERROR("solveLU can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     if(OpenCLCPUOffload()) {
         return cpu::solveLU(A, pivot, b, options);
     }
@@ -300,6 +305,11 @@ Array<T> triangleSolve(const Array<T> &A, const Array<T> &b, const af_mat_prop o
 template<typename T>
 Array<T> solve(const Array<T> &a, const Array<T> &b, const af_mat_prop options)
 {
+    if (a.dims()[2] * a.dims()[3] > 1 ||
+        b.dims()[2] * b.dims()[3] > 1) {
+        AF_ERROR("solve can not be used in batch mode", AF_ERR_BATCH);
+    }
+
     try {
         if(OpenCLCPUOffload()) {
             return cpu::solve(a, b, options);
@@ -11,23 +11,65 @@
 #include <Array.hpp>
 #include <err_opencl.hpp>
 #include <where.hpp>
+#include <arith.hpp>
+#include <cast.hpp>
+#include <copy.hpp>
+#include <join.hpp>
+#include <algorithm>
+#include <climits>
 #include <complex>
+#include <vector>
 #include <kernel/where.hpp>
 
+using af::dim4;
+
 namespace opencl
 {
     template<typename T>
     Array<uint> where(const Array<T> &in)
     {
+        if (in.elements() > UINT_MAX) {
+            AF_ERROR("Too many elements for 32 bit indices", AF_ERR_SIZE);
+        }
+
         Param Out;
         Param In = in;
         kernel::where<T>(Out, In);
         return createParamArray<uint>(Out);
     }
 
+    template<typename T>
+    Array<uintl> where64(const Array<T> &in)
+    {
+        // The kernel counts in 32 bits, so run it on linear chunks of the
+        // input and move the indices of each chunk by its offset
+        const dim_t chunk = (dim_t)1 << 31;
+
+        Array<T> flat = copyArray<T>(in);
+        flat.modDims(dim4(in.elements()));
+
+        Array<uintl> out = createEmptyArray<uintl>(dim4(0));
+        for (dim_t begin = 0; begin < flat.elements(); begin += chunk) {
+            dim_t end = std::min(begin + chunk, flat.elements()) - 1;
+
+            std::vector<af_seq> index(4, af_span);
+            index[0] = {(double)begin, (double)end, 1};
+
+            Array<uint> idx = where<T>(createSubArray<T>(flat, index, false));
+            if (idx.elements() == 0) continue;
+
+            Array<uintl> off = createValueArray<uintl>(idx.dims(), (uintl)begin);
+            Array<uintl> res = arithOp<uintl, af_add_t>(cast<uintl, uint>(idx), off, idx.dims());
+
+            out = out.elements() == 0 ? res : join<uintl, uintl>(0, out, res);
+        }
+
+        return out;
+    }
 
 #define INSTANTIATE(T)                                  \
-    template Array<uint> where<T>(const Array<T> &in);  \
+    template Array<uint > where  <T>(const Array<T> &in); \
+    template Array<uintl> where64<T>(const Array<T> &in); \
 
     INSTANTIATE(float  )
     INSTANTIATE(cfloat )
@@ -13,4 +13,8 @@ namespace opencl
 {
     template<typename T>
     Array<uint> where(const Array<T>& in);
+
+    /// where with 64 bit indices, for arrays of more than 2^32 elements
+    template<typename T>
+    Array<uintl> where64(const Array<T>& in);
 }
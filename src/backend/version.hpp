@@ -0,0 +1,13 @@
+/*******************************************************
+ * Copyright (c) 2014, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#define AF_REVISION "8d465bd"
+#define AF_COMPILER_STR "GNU Compiler Collection(GCC/G++) 12.2.0"
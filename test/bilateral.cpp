@@ -203,3 +203,31 @@ TEST(bilateral, GFOR)
         ASSERT_EQ(max<double>(abs(c_ii - b_ii)) < 1E-5, true);
     }
 }
+
+TEST(bilateral, GridApproximation)
+{
+    using af::array;
+
+    // Two flat regions with deterministic noise
+    const int nx = 160, ny = 120;
+    vector<float> in(nx * ny);
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            in[i + j * nx] = (i < nx / 2 ? 50.f : 200.f) + ((i * 7 + j * 13) % 21 - 10);
+        }
+    }
+
+    array a(nx, ny, &in.front());
+    array exact  = af::bilateral(a, 8.f, 30.f);
+    array approx = af::bilateralGrid(a, 8.f, 30.f);
+
+    ASSERT_EQ(exact.dims(), approx.dims());
+    float rms = std::sqrt(af::mean<float>((exact - approx) * (exact - approx)));
+    ASSERT_LT(rms, 2.f);
+
+    // The edge must be preserved
+    vector<float> out(nx * ny);
+    approx.host(&out.front());
+    ASSERT_NEAR(50.f,  out[nx / 4 + (ny / 2) * nx], 5.f);
+    ASSERT_NEAR(200.f, out[3 * nx / 4 + (ny / 2) * nx], 5.f);
+}
@@ -245,3 +245,55 @@ TYPED_TEST(MatrixMultiply, MultiGPURectangleVector_CPP)
 }
 
 #undef DEVICE_ITERATE
+
+TEST(MatrixMultiply, Batched)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    af::array a = af::randu(8, 5, 3, 2);
+    af::array b = af::randu(5, 6, 3, 2);
+    af::array c = af::matmul(a, b);
+
+    ASSERT_EQ(af::dim4(8, 6, 3, 2), c.dims());
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 3; i++) {
+            af::array gold = af::matmul(a(af::span, af::span, i, j),
+                                        b(af::span, af::span, i, j));
+            ASSERT_NEAR(0, af::max<float>(af::abs(c(af::span, af::span, i, j) - gold)), 1e-5);
+        }
+    }
+}
+
+TEST(MatrixMultiply, BatchedBroadcast)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    af::array a = af::randu(4, 7);
+    af::array b = af::randu(4, 9, 5);
+    af::array x = af::randu(7, 1, 1, 3);
+
+    af::array c = af::matmul(a, b, AF_MAT_TRANS, AF_MAT_NONE);
+    af::array y = af::matmul(a, x);
+
+    ASSERT_EQ(af::dim4(7, 9, 5), c.dims());
+    ASSERT_EQ(af::dim4(4, 1, 1, 3), y.dims());
+    for (int i = 0; i < 5; i++) {
+        af::array gold = af::matmul(a, b(af::span, af::span, i), AF_MAT_TRANS, AF_MAT_NONE);
+        ASSERT_NEAR(0, af::max<float>(af::abs(c(af::span, af::span, i) - gold)), 1e-5);
+    }
+    for (int i = 0; i < 3; i++) {
+        af::array gold = af::matmul(a, x(af::span, af::span, 0, i));
+        ASSERT_NEAR(0, af::max<float>(af::abs(y(af::span, af::span, 0, i) - gold)), 1e-5);
+    }
+}
+
+TEST(MatrixMultiply, BatchedMismatch)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    af::array a = af::randu(4, 4, 2);
+    af::array b = af::randu(4, 4, 3);
+
+    af_array out = 0;
+    ASSERT_EQ(AF_ERR_SIZE, af_matmul(&out, a.get(), b.get(), AF_MAT_NONE, AF_MAT_NONE));
+}
@@ -87,3 +87,28 @@ CHOLESKY_BIG_TESTS(float, 0.05)
 CHOLESKY_BIG_TESTS(double, 1E-8)
 CHOLESKY_BIG_TESTS(cfloat, 0.05)
 CHOLESKY_BIG_TESTS(cdouble, 1E-8)
+
+TEST(Cholesky, Batched)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+    if (noDoubleTests<double>()) return;
+    if (noLAPACKTests()) return;
+
+    // The first size is factored without LAPACK
+    const int sizes[] = {4, 32};
+    for (int n : sizes) {
+        af::dim4 dims(n, n, 6, 2);
+        af::array a  = af::randu(dims, f64);
+        af::array in = af::matmul(a, a, AF_MAT_TRANS, AF_MAT_NONE) + n * af::identity(dims, f64);
+
+        af::array out;
+        ASSERT_EQ(0, af::cholesky(out, in, true));
+
+        af::array re = af::matmul(out, out, AF_MAT_TRANS, AF_MAT_NONE);
+        ASSERT_NEAR(0, af::max<double>(af::abs(in - re)), 1E-8);
+
+        // The failure of a single matrix is reported
+        in(n - 1, n - 1, 3, 1) = -1;
+        ASSERT_EQ(n, af::cholesky(out, in, false));
+    }
+}
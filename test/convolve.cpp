@@ -668,3 +668,60 @@ TEST(GFOR, convolve2_MM)
         ASSERT_EQ(max<double>(abs(c_ii - b_ii)) < 1E-5, true);
     }
 }
+
+TEST(Convolve2, SeparableFilter)
+{
+    array A = randu(200, 150, 2);
+    array c = randu(5);
+    array r = randu(5);
+    array K = matmul(c, r.T());
+
+    array gold = convolve(c, r, A);
+    array out  = convolve2(A, K, AF_CONV_DEFAULT, AF_CONV_SPATIAL);
+    ASSERT_EQ(gold.dims(), out.dims());
+    ASSERT_LT(max<double>(abs(out - gold)), 1E-4);
+
+    gold = convolve(c, r, A, AF_CONV_EXPAND);
+    out  = convolve2(A, K, AF_CONV_EXPAND, AF_CONV_SPATIAL);
+    ASSERT_EQ(gold.dims(), out.dims());
+    ASSERT_LT(max<double>(abs(out - gold)), 1E-4);
+}
+
+TEST(Convolve2, SeparableFilterNonSquare)
+{
+    // Only the CPU spatial kernels take filters of any size
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    array A = randu(200, 150, 2);
+    array c = randu(9);
+    array r = randu(7);
+    array K = matmul(c, r.T());
+
+    array gold = convolve(c, r, A);
+    array out  = convolve2(A, K, AF_CONV_DEFAULT, AF_CONV_SPATIAL);
+    ASSERT_EQ(gold.dims(), out.dims());
+    ASSERT_LT(max<double>(abs(out - gold)), 1E-4);
+
+    gold = convolve(c, r, A, AF_CONV_EXPAND);
+    out  = convolve2(A, K, AF_CONV_EXPAND, AF_CONV_SPATIAL);
+    ASSERT_EQ(gold.dims(), out.dims());
+    ASSERT_LT(max<double>(abs(out - gold)), 1E-4);
+}
+
+TEST(Convolve2, LargeFilterAuto)
+{
+    // Only the CPU spatial kernels take filters of any size
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    array A = randu(300, 200);
+    array K = randu(41, 35) - 0.5;
+
+    array gold = convolve2(A, K, AF_CONV_DEFAULT, AF_CONV_SPATIAL);
+    array out  = convolve2(A, K);
+    ASSERT_LT(max<double>(abs(out - gold)), 1E-3);
+
+    K = randu(3, 3);
+    gold = convolve2(A, K, AF_CONV_DEFAULT, AF_CONV_FREQ);
+    out  = convolve2(A, K);
+    ASSERT_LT(max<double>(abs(out - gold)), 1E-4);
+}
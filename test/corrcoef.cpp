@@ -16,6 +16,7 @@
 #include <ctime>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 #include <testHelpers.hpp>
 
 using namespace af;
@@ -92,3 +93,33 @@ TYPED_TEST(CorrelationCoefficient, All)
     ASSERT_NEAR(::real(currGoldBar[0]), ::real(c), 1.0e-3);
     ASSERT_NEAR(::imag(currGoldBar[0]), ::imag(c), 1.0e-3);
 }
+
+TEST(CorrelationCoefficient, LargeOffset)
+{
+    const int n = 100000;
+    std::vector<float> h_x(n), h_y(n);
+    for (int i = 0; i < n; i++) {
+        h_x[i] = 1.0e4f + (i * 7919 % 1000) / 100.0f;
+        h_y[i] = 2.0e4f - h_x[i] + (i % 17) / 10.0f;
+    }
+
+    double mx = 0, my = 0;
+    for (int i = 0; i < n; i++) {
+        mx += h_x[i];
+        my += h_y[i];
+    }
+    mx /= n;
+    my /= n;
+
+    double sxx = 0, syy = 0, sxy = 0;
+    for (int i = 0; i < n; i++) {
+        sxx += (h_x[i] - mx) * (h_x[i] - mx);
+        syy += (h_y[i] - my) * (h_y[i] - my);
+        sxy += (h_x[i] - mx) * (h_y[i] - my);
+    }
+
+    array x(n, &h_x.front());
+    array y(n, &h_y.front());
+
+    ASSERT_NEAR(sxy / std::sqrt(sxx * syy), corrcoef<float>(x, y), 1.0e-4);
+}
@@ -186,3 +186,120 @@ TEST(DotCCU, CPP)
 
     delete[] outData;
 }
+
+TEST(Dot, Batched)
+{
+    af::array a = af::randu(37, 5, 3);
+    af::array b = af::randu(37, 5, 3);
+
+    af::array c0 = af::dotBatched(a, b);
+    af::array c1 = af::dotBatched(a, b, 1);
+    af::array c2 = af::dotBatched(a, b, 2);
+
+    ASSERT_EQ(af::dim4(1, 5, 3), c0.dims());
+    ASSERT_EQ(af::dim4(37, 1, 3), c1.dims());
+    ASSERT_EQ(af::dim4(37, 5, 1), c2.dims());
+
+    ASSERT_NEAR(0, af::max<float>(af::abs(c0 - af::sum(a * b, 0))), 1e-4);
+    ASSERT_NEAR(0, af::max<float>(af::abs(c1 - af::sum(a * b, 1))), 1e-4);
+    ASSERT_NEAR(0, af::max<float>(af::abs(c2 - af::sum(a * b, 2))), 1e-4);
+}
+
+TEST(Dot, BatchedConjugate)
+{
+    af::array a = af::randu(50, 4, c32);
+    af::array b = af::randu(50, 4, c32);
+
+    af::array cu = af::dotBatched(a, b, 0, AF_MAT_CONJ, AF_MAT_NONE);
+    af::array uc = af::dotBatched(a, b, 0, AF_MAT_NONE, AF_MAT_CONJ);
+    af::array cc = af::dotBatched(a, b, 0, AF_MAT_CONJ, AF_MAT_CONJ);
+
+    ASSERT_NEAR(0, af::max<float>(af::abs(cu - af::sum(af::conjg(a) * b, 0))), 1e-4);
+    ASSERT_NEAR(0, af::max<float>(af::abs(uc - af::sum(a * af::conjg(b), 0))), 1e-4);
+    ASSERT_NEAR(0, af::max<float>(af::abs(cc - af::conjg(af::sum(a * b, 0)))), 1e-4);
+}
+
+TEST(Dot, BatchedMismatch)
+{
+    af::array a = af::randu(10, 3);
+    af::array b = af::randu(10, 4);
+
+    af_array out = 0;
+    ASSERT_EQ(AF_ERR_SIZE, af_dot_batched(&out, a.get(), b.get(), 0, AF_MAT_NONE, AF_MAT_NONE));
+}
+
+TEST(Dot, LongStrided)
+{
+    if (noDoubleTests<double>()) return;
+
+    af::array a = af::randu(300001, f64);
+    af::array b = af::randu(300001, f64);
+    ASSERT_NEAR(af::sum<double>(a * b), af::dot(a, b).scalar<double>(), 1e-6);
+
+    // The rows of a matrix are read with a stride of 3
+    af::array m = af::randu(3, 100001, f64);
+    af::array n = af::randu(3, 100001, f64);
+    af::array x = m.row(1);
+    af::array y = n.row(1);
+
+    ASSERT_NEAR(af::sum<double>(x * y), af::dotBatched(x, y, 1).scalar<double>(), 1e-6);
+    ASSERT_NEAR(0, af::max<double>(af::abs(af::sum(m * n, 1) - af::dotBatched(m, n, 1))), 1e-6);
+}
+
+TEST(Blas1, AxpyScal)
+{
+    af::array x = af::randu(1000, 3);
+    af::array y = af::randu(1000, 3);
+    af::array gold = 2.5 * x + y;
+    gold.eval();
+
+    af::axpyInPlace(y, 2.5, x);
+    ASSERT_NEAR(0, af::max<float>(af::abs(y - gold)), 1e-5);
+
+    af::scalInPlace(y, -0.5);
+    ASSERT_NEAR(0, af::max<float>(af::abs(y + 0.5 * gold)), 1e-5);
+}
+
+TEST(Blas1, AxpyScalShared)
+{
+    af::array x = af::randu(1000, 3);
+    af::array y = af::randu(1000, 3);
+    af::array orig = y.copy();
+
+    // Shares the buffer of y, which the updates must leave untouched
+    af::array ycopy = y;
+    af::array ycol = y(af::span, 1);
+    af::array ylazy = y + 0;
+
+    af::axpyInPlace(y, 2.5, x);
+    af::scalInPlace(y, -0.5);
+
+    ASSERT_NEAR(0, af::max<float>(af::abs(y + 0.5 * (2.5 * x + orig))), 1e-5);
+    ASSERT_EQ(0, af::max<float>(af::abs(ycopy - orig)));
+    ASSERT_EQ(0, af::max<float>(af::abs(ycol - orig(af::span, 1))));
+    ASSERT_EQ(0, af::max<float>(af::abs(ylazy - orig)));
+}
+
+TEST(Blas1, AxpyMismatch)
+{
+    af::array x = af::randu(10);
+    af::array y = af::randu(11);
+
+    ASSERT_EQ(AF_ERR_SIZE, af_axpy_inplace(y.get(), 1.0, x.get()));
+}
+
+TEST(Blas1, Norm)
+{
+    if (noDoubleTests<double>()) return;
+
+    af::array a = af::randu(1000, 7, f64);
+    ASSERT_NEAR(std::sqrt(af::sum<double>(a * a)), af::norm(a), 1e-10);
+
+    // The squares of these overflow and underflow double precision, which
+    // only the CPU backend rescales
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+    double big[] = {3e200, 4e200};
+    double tiny[] = {3e-200, 4e-200};
+    ASSERT_NEAR(5e200, af::norm(af::array(2, big)), 1e188);
+    ASSERT_NEAR(5e-200, af::norm(af::array(2, tiny)), 1e-212);
+}
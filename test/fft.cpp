@@ -684,6 +684,25 @@ TEST(ifft3, InPlace)
     }
 }
 
+TEST(fft, PlanCache)
+{
+    af::array a = af::randu(100, 10, c32);
+    af::array b = af::randu(64, 30, c32);
+
+    af::array ra = af::fft(a);
+    af::array rb = af::fft(b);
+
+    // Alternating sizes with a single cached plan replaces the plan each time
+    af_set_fft_plan_cache_size(1);
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_NEAR(0, af::max<float>(af::abs(af::fft(a) - ra)), 1e-3);
+        ASSERT_NEAR(0, af::max<float>(af::abs(af::fft(b) - rb)), 1e-3);
+    }
+
+    af_set_fft_plan_cache_size(5);
+}
+
 void fft2InPlaceFunc()
 {
     af::array a = af::randu(1024, 1024, c32);
@@ -11,6 +11,7 @@
 #include <arrayfire.h>
 #include <af/dim4.hpp>
 #include <af/traits.hpp>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -275,3 +276,42 @@ TEST(histogram, IndexedArray)
     ASSERT_EQ(true, out[2] ==  8);
     ASSERT_EQ(true, out[3] ==  8);
 }
+
+TEST(histogram, LargeImage)
+{
+    using namespace af;
+
+    // Large enough for the per thread bins and the u8 table
+    const dim_t W = 1024, H = 768;
+    const unsigned nbins = 100;
+    array A = randu(W, H, 2, u8);
+    array B = A.as(f32);
+
+    vector<uchar> h_in(A.elements());
+    A.host((void*)h_in.data());
+
+    vector<unsigned> gold(nbins * 2, 0);
+    float step = 255.0 / (float)nbins;
+    for (size_t i = 0; i < h_in.size(); ++i) {
+        int bin = (int)((double)h_in[i] / step);
+        bin = std::min(std::max(bin, 0), (int)nbins - 1);
+        gold[bin + nbins * (i / (W * H))]++;
+    }
+
+    vector<unsigned> h_out(nbins * 2);
+    histogram(A, nbins, 0, 255).host((void*)h_out.data());
+    ASSERT_EQ(gold, h_out);
+
+    // Same bins for values that fall exactly on the bin edges
+    histogram(B, nbins, 0, 255).host((void*)h_out.data());
+    ASSERT_EQ(gold, h_out);
+
+    histogram(B(seq(W - 1), span, span), nbins, 0, 255).host((void*)h_out.data());
+    for (size_t i = 0; i < h_in.size(); ++i) {
+        if (i % W != W - 1) continue;
+        int bin = (int)((double)h_in[i] / step);
+        bin = std::min(std::max(bin, 0), (int)nbins - 1);
+        gold[bin + nbins * (i / (W * H))]--;
+    }
+    ASSERT_EQ(gold, h_out);
+}
@@ -65,3 +65,22 @@ INVERSE_TESTS(float, 0.01)
 INVERSE_TESTS(double, 1E-5)
 INVERSE_TESTS(cfloat, 0.01)
 INVERSE_TESTS(cdouble, 1E-5)
+
+TEST(INVERSE, Batched)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+    if (noDoubleTests<double>()) return;
+    if (noLAPACKTests()) return;
+
+    // The first size is inverted without LAPACK
+    const int sizes[] = {5, 16};
+    for (int n : sizes) {
+        af::dim4 dims(n, n, 4, 3);
+        af::array A  = af::randu(dims, f64) + n * af::identity(dims, f64);
+        af::array IA = af::inverse(A);
+        af::array I  = af::matmul(A, IA);
+
+        ASSERT_EQ(dims, IA.dims());
+        ASSERT_NEAR(0, af::max<double>(af::abs(I - af::identity(dims, f64))), 1E-10);
+    }
+}
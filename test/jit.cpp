@@ -267,3 +267,75 @@ TEST(JIT, CPP_common_node)
         }
     }
 }
+
+TEST(JIT, CPP_block_boundaries)
+{
+    using af::array;
+
+    const int nx = 2049;
+    const int ny = 3;
+    array a = af::randu(nx, ny);
+    array b = af::randu(nx, ny);
+
+    // Linear evaluation with a partial last block and a shared node
+    array c = a * b;
+    array x = exp(c) + c + 2;
+
+    // Strided evaluation of a sub-array with a partial last block
+    array s = a(af::seq(1, nx - 1), af::span);
+    array y = s * 2 + 1;
+
+    std::vector<float> ha(nx * ny);
+    std::vector<float> hb(nx * ny);
+    std::vector<float> hx(nx * ny);
+    std::vector<float> hy((nx - 1) * ny);
+
+    a.host(&ha[0]);
+    b.host(&hb[0]);
+    x.host(&hx[0]);
+    y.host(&hy[0]);
+
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            float hc = ha[j * nx + i] * hb[j * nx + i];
+            ASSERT_NEAR(std::exp(hc) + hc + 2, hx[j * nx + i], 1e-5);
+        }
+
+        for (int i = 1; i < nx; i++) {
+            ASSERT_EQ(ha[j * nx + i] * 2 + 1, hy[j * (nx - 1) + i - 1]);
+        }
+    }
+}
+
+TEST(JIT, CPP_Multi_dependent)
+{
+    using af::array;
+
+    const int num = 1 << 16;
+    af::array a = af::randu(num, s32);
+    af::array b = af::randu(num, s32);
+    af::array x = a + b;
+    af::array y = x * a;
+    af::array z = x;
+
+    // x is both an output and a child of y, z shares the tree of x
+    af::eval(x, y, z);
+
+    std::vector<int> ha(num);
+    std::vector<int> hb(num);
+    std::vector<int> hx(num);
+    std::vector<int> hy(num);
+    std::vector<int> hz(num);
+
+    a.host(&ha[0]);
+    b.host(&hb[0]);
+    x.host(&hx[0]);
+    y.host(&hy[0]);
+    z.host(&hz[0]);
+
+    for (int i = 0; i < num; i++) {
+        ASSERT_EQ((ha[i] + hb[i]), hx[i]);
+        ASSERT_EQ((ha[i] + hb[i]) * ha[i], hy[i]);
+        ASSERT_EQ(hx[i], hz[i]);
+    }
+}
@@ -197,3 +197,27 @@ LU_BIG_TESTS(float, 1E-3)
 LU_BIG_TESTS(double, 1E-8)
 LU_BIG_TESTS(cfloat, 1E-3)
 LU_BIG_TESTS(cdouble, 1E-8)
+
+TEST(LU, Batched)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+    if (noDoubleTests<double>()) return;
+    if (noLAPACKTests()) return;
+
+    // The first size is factored without LAPACK
+    const int sizes[] = {6, 24};
+    for (int n : sizes) {
+        af::array a_orig = af::randu(n, n, 8, f64);
+
+        af::array l, u, pivot;
+        af::lu(l, u, pivot, a_orig);
+        ASSERT_EQ(af::dim4(n, 1, 8), pivot.dims());
+
+        af::array a_recon = af::matmul(l, u);
+        for (int i = 0; i < 8; i++) {
+            af::array p = pivot(af::span, 0, i);
+            af::array a_perm = a_orig(p, af::span, i);
+            ASSERT_NEAR(0, af::max<double>(af::abs(a_recon(af::span, af::span, i) - a_perm)), 1E-10);
+        }
+    }
+}
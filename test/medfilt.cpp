@@ -12,6 +12,7 @@
 #include <af/dim4.hpp>
 #include <af/traits.hpp>
 #include <string>
+#include <algorithm>
 #include <vector>
 #include <testHelpers.hpp>
 
@@ -480,3 +481,84 @@ TEST(MedianFilter1d, GFOR)
         ASSERT_EQ(max<double>(abs(c_ii - b_ii)) < 1E-5, true);
     }
 }
+
+TEST(MedianFilter1d, CPP_Columns)
+{
+    const dim_t w_wid = 5;
+    const int nrows = 100;
+    const int ncols = 7;
+
+    af::array input  = af::randu(nrows, ncols);
+    af::array output = af::medfilt1(input, w_wid, AF_PAD_ZERO);
+
+    // Every column is filtered independently
+    for (int c = 0; c < ncols; c++) {
+        af::array gold = af::medfilt1(input(af::span, c), w_wid, AF_PAD_ZERO);
+        ASSERT_EQ(0, af::count<int>(gold != output(af::span, c)));
+    }
+}
+
+template<typename T>
+void medfiltLargeWindowTest(int maxVal)
+{
+    const int nx = 70, ny = 50, wx = 13, wy = 9;
+
+    vector<T> in(nx * ny);
+    for (int i = 0; i < nx * ny; i++) in[i] = (T)((i * 7919) % (maxVal + 1));
+
+    array a(nx, ny, &in.front());
+    vector<T> out(nx * ny);
+    medfilt2(a, wx, wy, AF_PAD_SYM).host(&out.front());
+
+    vector<T> wind;
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            wind.clear();
+            for (int wj = 0; wj < wy; wj++) {
+                for (int wi = 0; wi < wx; wi++) {
+                    int x = abs(i + wi - wx / 2), y = abs(j + wj - wy / 2);
+                    if (x >= nx) x = 2 * (nx - 1) - x;
+                    if (y >= ny) y = 2 * (ny - 1) - y;
+                    wind.push_back(in[x + y * nx]);
+                }
+            }
+            std::nth_element(wind.begin(), wind.begin() + wind.size() / 2, wind.end());
+            ASSERT_EQ(wind[wind.size() / 2], out[i + j * nx]) << "at: " << i << ", " << j;
+        }
+    }
+}
+
+TEST(MedianFilter, LargeWindowU8)
+{
+    medfiltLargeWindowTest<uchar>(255);
+}
+
+TEST(MedianFilter, LargeWindowU16)
+{
+    medfiltLargeWindowTest<ushort>(65535);
+}
+
+TEST(MedianFilter, SmallWindowNetwork)
+{
+    array a = randu(64, 48);
+    array b = medfilt2(a, 5, 5, AF_PAD_ZERO);
+
+    vector<float> in(64 * 48), out(64 * 48);
+    a.host(&in.front());
+    b.host(&out.front());
+
+    for (int j = 0; j < 48; j++) {
+        for (int i = 0; i < 64; i++) {
+            vector<float> wind;
+            for (int wj = -2; wj <= 2; wj++) {
+                for (int wi = -2; wi <= 2; wi++) {
+                    int x = i + wi, y = j + wj;
+                    bool inside = x >= 0 && y >= 0 && x < 64 && y < 48;
+                    wind.push_back(inside ? in[x + y * 64] : 0.f);
+                }
+            }
+            std::nth_element(wind.begin(), wind.begin() + 12, wind.end());
+            ASSERT_EQ(wind[12], out[i + j * 64]) << "at: " << i << ", " << j;
+        }
+    }
+}
@@ -12,6 +12,8 @@
 #include <af/arith.h>
 #include <af/data.h>
 #include <testHelpers.hpp>
+#include <algorithm>
+#include <cmath>
 
 using namespace af;
 using std::vector;
@@ -176,3 +178,101 @@ MEDIAN(float, uchar)
 MEDIAN(float, short)
 MEDIAN(float, ushort)
 MEDIAN(double, double)
+
+template<typename To, typename Ti, int dim>
+void quantile_test(int nx, int ny=1, int nz=1, int nw=1)
+{
+    if (noDoubleTests<Ti>()) return;
+
+    array a = generateArray<Ti>(nx, ny, nz, nw);
+
+    const float h_probs[] = {0.f, 0.25f, 0.5f, 0.95f, 0.99f, 1.f};
+    const int nprobs = sizeof(h_probs) / sizeof(h_probs[0]);
+    array probs(nprobs, h_probs);
+
+    // Verification
+    array sa = sort(a, dim).as((af_dtype)af::dtype_traits<To>::af_type);
+    const double len = a.dims(dim);
+
+    // Test Part
+    array out = quantile(a, probs, dim);
+
+    dim4 odims = a.dims();
+    odims[dim] = nprobs;
+    ASSERT_EQ(odims, out.dims());
+
+    for (int k = 0; k < nprobs; k++) {
+        double h = h_probs[k] * (len - 1);
+        double lo = std::floor(h);
+        double hi = std::min(lo + 1, len - 1);
+
+        af::seq lSeq[4] = {span, span, span, span};
+        af::seq hSeq[4] = {span, span, span, span};
+        af::seq oSeq[4] = {span, span, span, span};
+        lSeq[dim] = af::seq(lo, lo, 1.0);
+        hSeq[dim] = af::seq(hi, hi, 1.0);
+        oSeq[dim] = af::seq(k, k, 1.0);
+
+        array left  = sa(lSeq[0], lSeq[1], lSeq[2], lSeq[3]);
+        array right = sa(hSeq[0], hSeq[1], hSeq[2], hSeq[3]);
+        array verify = left + (h - lo) * (right - left);
+
+        array res = out(oSeq[0], oSeq[1], oSeq[2], oSeq[3]);
+        ASSERT_NEAR(0, max<double>(af::abs(res - verify) / (1 + af::abs(verify))), 1e-5);
+    }
+}
+
+TEST(Quantile, float_1D)
+{
+    quantile_test<float, float, 0>(1000);
+}
+
+TEST(Quantile, float_2D_1)
+{
+    quantile_test<float, float, 1>(100, 251);
+}
+
+TEST(Quantile, int_3D_2)
+{
+    quantile_test<float, int, 2>(20, 5, 37);
+}
+
+TEST(Quantile, double_4D_3)
+{
+    quantile_test<double, double, 3>(10, 5, 3, 41);
+}
+
+TEST(Quantile, MatchesMedian)
+{
+    array a = generateArray<unsigned int>(1000, 7, 1, 1);
+    array out = quantile(a, constant(0.5, 1), 0);
+
+    ASSERT_EQ(f32, out.type());
+    ASSERT_EQ(0, max<double>(af::abs(out - median(a, 0))));
+}
+
+TEST(Quantile, InvalidProbability)
+{
+    const float h_probs[] = {0.5f, 1.5f};
+    array a = randu(100);
+    array probs(2, h_probs);
+
+    af_array out = 0;
+    ASSERT_EQ(AF_ERR_ARG, af_quantile(&out, a.get(), probs.get(), 0));
+}
+
+TEST(Median, LargeIntegers)
+{
+    if (noDoubleTests<double>()) return;
+
+    // Above 2^24 neighbouring integers are not representable in float
+    const int base = 1 << 30;
+    const int h_s32[] = {base + 4, base + 1, base, base + 3};
+    const unsigned h_u32[] = {3000000005u, 3000000001u, 3000000002u};
+
+    array a(4, h_s32);
+    array b(3, h_u32);
+
+    ASSERT_EQ(base + 2.0, median<double>(a));
+    ASSERT_EQ(3000000002.0, median<double>(b));
+}
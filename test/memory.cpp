@@ -611,6 +611,40 @@ TEST(Memory, device)
     ASSERT_EQ(lock_bytes, 0u);
 }
 
+TEST(Memory, stats)
+{
+    size_t hits, misses, peak_bytes, requested_bytes;
+    size_t hits_new, misses_new;
+
+    cleanSlate(); // Clean up everything done so far
+
+    af::deviceMemStats(&hits, &misses, &peak_bytes, &requested_bytes);
+    ASSERT_EQ(requested_bytes, 0u);
+
+    {
+        af::array a = af::randu(5, 5);
+
+        af::deviceMemStats(&hits_new, &misses_new, &peak_bytes, &requested_bytes);
+        ASSERT_EQ(hits_new, hits);
+        ASSERT_EQ(misses_new, misses + 1);
+        ASSERT_GE(peak_bytes, step_bytes);
+        ASSERT_EQ(requested_bytes, 25 * sizeof(float));
+    }
+
+    {
+        // Should reuse the buffer released above
+        af::array a = af::randu(5, 5);
+
+        af::deviceMemStats(&hits_new, &misses_new, &peak_bytes, &requested_bytes);
+        ASSERT_EQ(hits_new, hits + 1);
+        ASSERT_EQ(misses_new, misses + 1);
+        ASSERT_EQ(requested_bytes, 25 * sizeof(float));
+    }
+
+    af::deviceMemStats(&hits_new, &misses_new, &peak_bytes, &requested_bytes);
+    ASSERT_EQ(requested_bytes, 0u);
+}
+
 TEST(Memory, unlock)
 {
 
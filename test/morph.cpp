@@ -459,3 +459,34 @@ TEST(Morph, EdgeIssue1564)
         ASSERT_EQ((int)outData[i], goldData[i]);
     }
 }
+
+TEST(Morph, FlatMaskLargeWindow)
+{
+    const int nx = 120, ny = 90, wx = 15, wy = 8;
+
+    vector<float> in(nx * ny);
+    for (int i = 0; i < nx * ny; i++) in[i] = (float)((i * 7919) % 1009);
+
+    array A(nx, ny, &in.front());
+    array mask = constant(1, wx, wy);
+
+    vector<float> dil(nx * ny), ero(nx * ny);
+    dilate(A, mask).host(&dil.front());
+    erode(A, mask).host(&ero.front());
+
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            float mx = -1, mn = 1e6;
+            for (int wj = 0; wj < wy; wj++) {
+                for (int wi = 0; wi < wx; wi++) {
+                    int x = i + wi - wx / 2, y = j + wj - wy / 2;
+                    if (x < 0 || y < 0 || x >= nx || y >= ny) continue;
+                    mx = std::max(mx, in[x + y * nx]);
+                    mn = std::min(mn, in[x + y * nx]);
+                }
+            }
+            ASSERT_EQ(mx, dil[i + j * nx]) << "at: " << i << ", " << j;
+            ASSERT_EQ(mn, ero[i + j * nx]) << "at: " << i << ", " << j;
+        }
+    }
+}
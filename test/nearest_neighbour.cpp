@@ -11,6 +11,7 @@
 #include <arrayfire.h>
 #include <af/dim4.hpp>
 #include <af/traits.hpp>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <testHelpers.hpp>
@@ -228,3 +229,77 @@ TEST(NearestNeighbourSAD, CPP)
     delete[] outIdx;
     delete[] outDist;
 }
+
+TEST(NearestNeighbour, TopK)
+{
+    using af::array;
+
+    const int feat_len = 32, n_query = 40, n_train = 3000;
+    const uint k = 6;
+
+    // Integer valued, so every backend gets exact distances
+    array query = af::floor(16 * af::randu(feat_len, n_query));
+    array train = af::floor(16 * af::randu(feat_len, n_train));
+
+    array idx, dist;
+    nearestNeighbour(idx, dist, query, train, 0, k, AF_SSD);
+    ASSERT_EQ(k, idx.dims(0));
+    ASSERT_EQ(n_query, idx.dims(1));
+
+    vector<float> h_query(query.elements()), h_train(train.elements());
+    query.host(&h_query.front());
+    train.host(&h_train.front());
+
+    vector<uint>  h_idx(idx.elements());
+    vector<float> h_dist(dist.elements());
+    idx.host(&h_idx.front());
+    dist.host(&h_dist.front());
+
+    for (int q = 0; q < n_query; ++q) {
+        vector<float> all(n_train);
+        for (int t = 0; t < n_train; ++t) {
+            float s = 0;
+            for (int f = 0; f < feat_len; ++f) {
+                float d = h_query[q * feat_len + f] - h_train[t * feat_len + f];
+                s += d * d;
+            }
+            all[t] = s;
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+
+        for (uint r = 0; r < k; ++r) {
+            ASSERT_EQ(all[r], h_dist[q * k + r]) << "query " << q << " rank " << r;
+
+            float s = 0;
+            for (int f = 0; f < feat_len; ++f) {
+                float d = h_query[q * feat_len + f] - h_train[h_idx[q * k + r] * feat_len + f];
+                s += d * d;
+            }
+            ASSERT_EQ(all[r], s) << "query " << q << " rank " << r;
+        }
+    }
+}
+
+TEST(NearestNeighbour, HammingU64)
+{
+    using af::array;
+
+    // Bits above the low 32 of every word count as well
+    uintl h_query[] = {0xFFFFFFFF00000000ULL, 0x1ULL};
+    uintl h_train[] = {0x0ULL, 0xFFFF000000000000ULL, 0x1ULL, 0x1ULL};
+
+    array query(1, 2, h_query);
+    array train(2, 2, h_train);
+
+    array idx, dist;
+    nearestNeighbour(idx, dist, query, train, 1, 2, AF_SHD);
+
+    uint h_idx[2], h_dist[2];
+    idx.host(h_idx);
+    dist.host(h_dist);
+
+    ASSERT_EQ(1u,  h_idx[0]);
+    ASSERT_EQ(16u, h_dist[0]);
+    ASSERT_EQ(0u,  h_idx[1]);
+    ASSERT_EQ(32u, h_dist[1]);
+}
@@ -168,3 +168,21 @@ QR_BIG_TESTS(cdouble, 1E-5)
 #endif
 
 #undef QR_BIG_TESTS
+
+TEST(QR, Batched)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+    if (noDoubleTests<double>()) return;
+    if (noLAPACKTests()) return;
+
+    af::array in = af::randu(12, 7, 5, 2, f64);
+
+    af::array q, r, tau;
+    af::qr(q, r, tau, in);
+
+    ASSERT_EQ(af::dim4(12, 12, 5, 2), q.dims());
+    ASSERT_EQ(af::dim4(12, 7, 5, 2), r.dims());
+
+    af::array re = af::matmul(q, r);
+    ASSERT_NEAR(0, af::max<double>(af::abs(re - in)), 1E-10);
+}
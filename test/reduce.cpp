@@ -578,3 +578,48 @@ TEST(Reduce, AllSmallIndexed)
     array b = a(af::seq(LEN/2), af::span);
     ASSERT_EQ(af::max<float>(b), LEN/2-1);
 }
+
+TEST(Sum, LargeAccuracy)
+{
+    // Summing 2^24 copies of 0.1f sequentially loses most digits
+    const int num = 1 << 24;
+    array a = af::constant(0.1f, num);
+    ASSERT_NEAR(0.1 * num, af::sum<float>(a), 0.1 * num * 1e-5);
+
+    array b = af::moddims(a, 4096, 4096);
+    array c = af::sum(af::sum(b, 1), 0);
+    ASSERT_NEAR(0.1 * num, c.scalar<float>(), 0.1 * num * 1e-5);
+}
+
+TEST(Sum, StridedDims)
+{
+    if (noDoubleTests<double>()) return;
+
+    const int nx = 33, ny = 1000, nz = 7;
+    array a = af::randu(nx, ny, nz, f64);
+    array b = a(af::seq(1, nx - 2), af::span, af::span);
+
+    vector<double> h(b.elements());
+    b.host(&h[0]);
+    const int mx = nx - 2;
+
+    for (int d = 0; d < 3; d++) {
+        array s = af::sum(b, d);
+        vector<double> hs(s.elements());
+        s.host(&hs[0]);
+
+        af::dim4 od = b.dims();
+        od[d] = 1;
+        for (int k = 0; k < nz; k++) {
+            for (int j = 0; j < ny; j++) {
+                for (int i = 0; i < mx; i++) {
+                    int o = (d == 0 ? 0 : i) + od[0] * ((d == 1 ? 0 : j) + od[1] * (d == 2 ? 0 : k));
+                    hs[o] -= h[i + mx * (j + ny * k)];
+                }
+            }
+        }
+        for (size_t i = 0; i < hs.size(); i++) {
+            ASSERT_NEAR(0, hs[i], 1e-9) << "at " << i << " for dim " << d;
+        }
+    }
+}
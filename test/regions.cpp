@@ -250,3 +250,75 @@ TEST(Regions, Docs_4)
         ASSERT_EQ(gold[i], output[i])<<" mismatch at i="<<i<<std::endl;
     }
 }
+
+// Labels regions with a flood fill, numbering them in scan order
+static vector<float> floodLabels(const vector<char> &in, int nx, int ny, bool full)
+{
+    vector<float> out(in.size(), 0);
+    vector<int> stack;
+    float next = 1;
+    for (int p = 0; p < nx * ny; p++) {
+        if (!in[p] || out[p] != 0) continue;
+        out[p] = next;
+        stack.push_back(p);
+        while (!stack.empty()) {
+            int q = stack.back();
+            stack.pop_back();
+            int x = q % nx, y = q / nx;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (!full && dx != 0 && dy != 0) continue;
+                    int u = x + dx, v = y + dy;
+                    if (u < 0 || v < 0 || u >= nx || v >= ny) continue;
+                    int r = u + v * nx;
+                    if (in[r] && out[r] == 0) {
+                        out[r] = next;
+                        stack.push_back(r);
+                    }
+                }
+            }
+        }
+        next++;
+    }
+    return out;
+}
+
+TEST(Regions, LargeRandom)
+{
+    const int nx = 300, ny = 400;
+    vector<char> in(nx * ny);
+    for (int i = 0; i < nx * ny; i++) in[i] = ((i * 7919) % 23) < 12;
+
+    af::array a(nx, ny, &in.front());
+    for (int full = 0; full < 2; full++) {
+        af::connectivity conn = full ? AF_CONNECTIVITY_8 : AF_CONNECTIVITY_4;
+        vector<float> gold = floodLabels(in, nx, ny, full == 1);
+        vector<float> out(nx * ny);
+        af::regions(a, conn).host(&out.front());
+        for (int i = 0; i < nx * ny; i++) {
+            ASSERT_EQ(gold[i], out[i]) << "at: " << i;
+        }
+    }
+}
+
+TEST(Regions, Batch)
+{
+    // Only the CPU backend labels every image of a volume
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    const int nx = 40, ny = 30, nz = 3;
+    vector<char> in(nx * ny * nz);
+    for (int i = 0; i < nx * ny * nz; i++) in[i] = ((i * 31) % 7) < 3;
+
+    af::array a(nx, ny, nz, &in.front());
+    vector<float> out(nx * ny * nz);
+    af::regions(a, AF_CONNECTIVITY_8).host(&out.front());
+
+    for (int z = 0; z < nz; z++) {
+        vector<char> slice(in.begin() + z * nx * ny, in.begin() + (z + 1) * nx * ny);
+        vector<float> gold = floodLabels(slice, nx, ny, true);
+        for (int i = 0; i < nx * ny; i++) {
+            ASSERT_EQ(gold[i], out[i + z * nx * ny]) << "at: " << i << " in slice " << z;
+        }
+    }
+}
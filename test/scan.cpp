@@ -338,3 +338,48 @@ TEST(Accum, CPP)
         delete[] outData;
     }
 }
+
+TEST(Accum, LongColumn)
+{
+    // Long enough to be split into several chunks
+    const int num = 1000003;
+    vector<int> in(num);
+    for (int i = 0; i < num; i++) in[i] = (i % 7) - 3;
+
+    const int dims[] = {0, 1, 3};
+    for (int k = 0; k < 3; k++) {
+        af::dim4 d(1, 1, 1, 1);
+        d[dims[k]] = num;
+        af::array a(d, &in.front());
+
+        vector<int> out(num);
+        af::accum(a, dims[k]).host(&out.front());
+
+        int gold = 0;
+        for (int i = 0; i < num; i++) {
+            gold += in[i];
+            ASSERT_EQ(gold, out[i]) << "at: " << i << " for dim " << dims[k];
+        }
+    }
+}
+
+TEST(Accum, RowSweep)
+{
+    const int nx = 300, ny = 500;
+    vector<int> in(nx * ny);
+    for (int i = 0; i < nx * ny; i++) in[i] = (i % 11) - 5;
+
+    af::array a(nx, ny, &in.front());
+    af::array b = a(af::seq(1, nx - 2), af::span);
+
+    vector<int> out((nx - 2) * ny);
+    af::accum(b, 1).host(&out.front());
+
+    for (int i = 1; i < nx - 1; i++) {
+        int gold = 0;
+        for (int j = 0; j < ny; j++) {
+            gold += in[i + j * nx];
+            ASSERT_EQ(gold, out[(i - 1) + j * (nx - 2)]) << "at: " << i << ", " << j;
+        }
+    }
+}
@@ -200,3 +200,33 @@ SOLVE_TESTS(cfloat, 0.01)
 SOLVE_TESTS(cdouble, 1E-5)
 
 #undef SOLVE_TESTS
+
+TEST(SOLVE, Batched)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+    if (noDoubleTests<double>()) return;
+    if (noLAPACKTests()) return;
+
+    // The first size is solved without LAPACK
+    const int sizes[] = {6, 20};
+    for (int n : sizes) {
+        af::dim4 dims(n, n, 50, 2);
+        af::array A  = af::randu(dims, f64) + n * af::identity(dims, f64);
+        af::array X0 = af::randu(n, 3, 50, 2, f64);
+        af::array B0 = af::matmul(A, X0);
+
+        af::array X1 = af::solve(A, B0);
+        ASSERT_EQ(X0.dims(), X1.dims());
+        ASSERT_NEAR(0, af::max<double>(af::abs(X1 - X0)), 1E-8);
+
+        af::array U  = af::upper(A);
+        af::array X2 = af::solve(U, af::matmul(U, X0), AF_MAT_UPPER);
+        ASSERT_NEAR(0, af::max<double>(af::abs(X2 - X0)), 1E-8);
+
+        af::array LU = A.copy();
+        af::array pivot;
+        af::luInPlace(pivot, LU);
+        af::array X3 = af::solveLU(LU, pivot, B0);
+        ASSERT_NEAR(0, af::max<double>(af::abs(X3 - X0)), 1E-8);
+    }
+}
@@ -12,6 +12,8 @@
 #include <af/dim4.hpp>
 #include <af/defines.h>
 #include <af/traits.hpp>
+#include <algorithm>
+#include <limits>
 #include <vector>
 #include <iostream>
 #include <complex>
@@ -265,3 +267,47 @@ TEST(SortIndex, CPPDim2)
     delete[] sxData;
     delete[] ixData;
 }
+
+TEST(SortIndex, LargeStable)
+{
+    // Long enough to be sorted across threads, with many repeated keys
+    const int num = 1 << 20;
+    vector<int> in(num);
+    for (int i = 0; i < num; i++) in[i] = (i * 7919) % 1001 - 500;
+
+    for (int dir = 0; dir < 2; dir++) {
+        af::array input(num, &in.front());
+        af::array outValues, outIndices;
+        af::sort(outValues, outIndices, input, 0, dir == 1);
+
+        vector<unsigned> gold(num);
+        for (int i = 0; i < num; i++) gold[i] = i;
+        std::stable_sort(gold.begin(), gold.end(), [&](unsigned a, unsigned b) {
+            return dir ? in[a] < in[b] : in[a] > in[b];
+        });
+
+        vector<int> values(num);
+        vector<unsigned> indices(num);
+        outValues.host(&values.front());
+        outIndices.host(&indices.front());
+
+        for (int i = 0; i < num; i++) {
+            ASSERT_EQ(gold[i], indices[i]) << "at: " << i;
+            ASSERT_EQ(in[gold[i]], values[i]) << "at: " << i;
+        }
+    }
+}
+
+TEST(SortIndex, FloatSpecialValues)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    float in[]   = {3.5f, -inf, 0.0f, -2.25f, inf, -1e-30f, 1e-30f};
+    float gold[] = {-inf, -2.25f, -1e-30f, 0.0f, 1e-30f, 3.5f, inf};
+
+    af::array values, indices;
+    af::sort(values, indices, af::array(7, in), 0, true);
+
+    float out[7];
+    values.host(out);
+    for (int i = 0; i < 7; i++) ASSERT_EQ(gold[i], out[i]) << "at: " << i;
+}
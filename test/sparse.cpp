@@ -169,6 +169,10 @@ void convertCSR(const int M, const int N, const float ratio)
     {                                                       \
         sparseTester<T>(625, 1331, 1, 2, eps);              \
     }                                                       \
+    TEST(SPARSE, T##RectFewColumns)                         \
+    {                                                       \
+        sparseTester<T>(1543, 873, 13, 9, eps);             \
+    }                                                       \
     TEST(SPARSE_TRANSPOSE, T##MatVec)                       \
     {                                                       \
         sparseTransposeTester<T>(625, 1331, 1, 2, eps);     \
@@ -185,6 +189,10 @@ void convertCSR(const int M, const int N, const float ratio)
     {                                                       \
         sparseTransposeTester<T>(453, 751, 397, 1, eps);    \
     }                                                       \
+    TEST(SPARSE_TRANSPOSE, T##RectFewColumns)               \
+    {                                                       \
+        sparseTransposeTester<T>(1543, 873, 13, 9, eps);    \
+    }                                                       \
     TEST(SPARSE, T##ConvertCSR)                             \
     {                                                       \
         convertCSR<T>(2345, 5678, 0.5);                     \
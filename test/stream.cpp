@@ -0,0 +1,138 @@
+/*******************************************************
+ * Copyright (c) 2016, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <gtest/gtest.h>
+#include <arrayfire.h>
+#include <cstdio>
+#include <testHelpers.hpp>
+
+static const char *stream_file = "stream_test.af";
+
+TEST(Stream, SaveReadIndexKey)
+{
+    af::array a = af::randu(10, 20);
+    af::array b = af::randu(7, 3, 2, s32);
+    af::array c = af::randu(1000, c64);
+
+    ASSERT_EQ(0, af::saveArray("a", a, stream_file));
+    ASSERT_EQ(1, af::saveArray("b", b, stream_file, true));
+    ASSERT_EQ(2, af::saveArray("c", c, stream_file, true));
+
+    ASSERT_EQ(1, af::readArrayCheck(stream_file, "b"));
+    ASSERT_EQ(-1, af::readArrayCheck(stream_file, "d"));
+
+    af::array ra = af::readArray(stream_file, 0u);
+    af::array rb = af::readArray(stream_file, "b");
+    af::array rc = af::readArray(stream_file, 2u);
+
+    ASSERT_EQ(a.dims(), ra.dims());
+    ASSERT_EQ(b.dims(), rb.dims());
+    ASSERT_EQ(c.dims(), rc.dims());
+    ASSERT_EQ(b.type(), rb.type());
+    ASSERT_EQ(c.type(), rc.type());
+
+    ASSERT_EQ(0, af::max<double>(af::abs(a - ra)));
+    ASSERT_EQ(0, af::max<double>(af::abs(b - rb)));
+    ASSERT_EQ(0, af::max<double>(af::abs(c - rc)));
+
+    std::remove(stream_file);
+}
+
+TEST(Stream, ReadMapped)
+{
+    af::array a = af::randu(100, 10);
+    af::array b = af::randu(33, u8);
+
+    af::saveArray("a", a, stream_file);
+    af::saveArray("b", b, stream_file, true);
+
+    {
+        af::array ra = af::readArrayMapped(stream_file, "a");
+        af::array rb = af::readArrayMapped(stream_file, 1u);
+
+        ASSERT_EQ(a.dims(), ra.dims());
+        ASSERT_EQ(b.type(), rb.type());
+        ASSERT_EQ(0, af::max<double>(af::abs(a - ra)));
+        ASSERT_EQ(0, af::max<double>(af::abs(b - rb)));
+
+        // Writing to a mapped array must not change the file
+        ra(0) = -1;
+        ASSERT_EQ(-1, ra.scalar<float>());
+    }
+
+    af::array ra = af::readArray(stream_file, "a");
+    ASSERT_EQ(0, af::max<double>(af::abs(a - ra)));
+
+    std::remove(stream_file);
+}
+
+TEST(Stream, LockMapped)
+{
+    af::array a = af::randu(100, 10);
+    af::saveArray("a", a, stream_file);
+
+    size_t alloc_bytes, alloc_buffers, lock_bytes, lock_buffers;
+    af::deviceGC();
+    af::deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+
+    {
+        // Locking a mapped array must lock a buffer owned by the memory
+        // manager, not the mapping
+        af::array ra = af::readArrayMapped(stream_file, "a");
+        ra.lock();
+        ASSERT_TRUE(ra.isLocked());
+
+        size_t alloc_locked, buffers_locked, bytes_locked, locked;
+        af::deviceMemInfo(&alloc_locked, &buffers_locked, &bytes_locked, &locked);
+        ASSERT_EQ(lock_buffers + 1, locked);
+
+        ra.unlock();
+        ASSERT_FALSE(ra.isLocked());
+        ASSERT_EQ(0, af::max<double>(af::abs(a - ra)));
+
+        // Unlocking a mapped array that was never locked must not free it
+        af::array rb = af::readArrayMapped(stream_file, "a");
+        rb.unlock();
+        ASSERT_EQ(0, af::max<double>(af::abs(a - rb)));
+    }
+
+    af::deviceGC();
+    size_t alloc_after, buffers_after, bytes_after, locked_after;
+    af::deviceMemInfo(&alloc_after, &buffers_after, &bytes_after, &locked_after);
+    ASSERT_EQ(lock_buffers, locked_after);
+    ASSERT_EQ(lock_bytes, bytes_after);
+
+    std::remove(stream_file);
+}
+
+TEST(Stream, ReadTruncated)
+{
+    af::array a = af::randu(100, 10);
+    af::saveArray("a", a, stream_file);
+
+    // Drop the end of the index
+    FILE *f = fopen(stream_file, "rb");
+    fseek(f, 0, SEEK_END);
+    long bytes = ftell(f) - 8;
+    fseek(f, 0, SEEK_SET);
+    char *buf = new char[bytes];
+    ASSERT_EQ((size_t)bytes, fread(buf, 1, bytes, f));
+    fclose(f);
+
+    f = fopen(stream_file, "wb");
+    fwrite(buf, 1, bytes, f);
+    fclose(f);
+    delete[] buf;
+
+    af_array out = 0;
+    ASSERT_EQ(AF_ERR_ARG, af_read_array_index(&out, stream_file, 0));
+    ASSERT_EQ(AF_ERR_ARG, af_read_array_index_mapped(&out, stream_file, 0));
+
+    std::remove(stream_file);
+}
@@ -105,3 +105,15 @@ void transposeInPlaceCPPTest()
     // cleanup
     delete[] outData;
 }
+
+TEST(Transpose, InPlaceConjugate)
+{
+    if (af::getActiveBackend() != AF_BACKEND_CPU) return;
+
+    // Covers full and partial blocks on and off the diagonal
+    af::array input  = af::randu(45, 45, 2, c32);
+    af::array output = af::transpose(input, true);
+    transposeInPlace(input, true);
+
+    ASSERT_EQ(0, af::max<float>(af::abs(input - output)));
+}
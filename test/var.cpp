@@ -154,3 +154,41 @@ TYPED_TEST(Var, DimCPPSmall)
         }
     }
 }
+
+TEST(Var, WeightedDimLargeOffset)
+{
+    const int nx = 300, ny = 700;
+
+    vector<float> h_in(nx * ny), h_wts(nx * ny);
+    for (int i = 0; i < nx * ny; i++) {
+        h_in[i]  = 1.0e4f + (i * 7919 % 1000) / 100.0f;
+        h_wts[i] = 1.0f + (i % 13);
+    }
+
+    array in(nx, ny, &h_in.front());
+    array wts(nx, ny, &h_wts.front());
+
+    for (int dim = 0; dim < 2; dim++) {
+        array out = af::var(in, wts, dim);
+
+        const int len   = dim == 0 ? nx : ny;
+        const int other = dim == 0 ? ny : nx;
+        vector<float> h_out(other);
+        out.host(&h_out.front());
+
+        for (int o = 0; o < other; o++) {
+            double sw = 0, swx = 0;
+            for (int k = 0; k < len; k++) {
+                int idx = dim == 0 ? o * nx + k : k * nx + o;
+                sw  += h_wts[idx];
+                swx += h_wts[idx] * h_in[idx];
+            }
+            double mean = swx / sw, m2 = 0;
+            for (int k = 0; k < len; k++) {
+                int idx = dim == 0 ? o * nx + k : k * nx + o;
+                m2 += h_wts[idx] * (h_in[idx] - mean) * (h_in[idx] - mean);
+            }
+            ASSERT_NEAR(m2 / sw, h_out[o], 1e-3 * m2 / sw) << "dim " << dim << " at " << o;
+        }
+    }
+}
@@ -128,3 +128,27 @@ TEST(Where, ISSUE_1259)
     af::array indices = af::where(a > 2);
     ASSERT_EQ(indices.elements(), 0);
 }
+
+TEST(Where, LargeStrided)
+{
+    // Spans many chunks, some empty, some full and some mixed
+    af::array a = af::randu(700, 2500, 3) > 0.5;
+    a(af::seq(100), af::span, 0) = 0;
+    a(af::span, af::seq(300), 1) = 1;
+    af::array b = a(af::seq(5, 650), af::seq(1, 2400), af::span);
+
+    af::array indices = af::where(b);
+    ASSERT_EQ(u32, indices.type());
+
+    vector<char> h_b(b.elements());
+    b.host(&h_b.front());
+    vector<uint> gold;
+    for (size_t i = 0; i < h_b.size(); ++i) {
+        if (h_b[i]) gold.push_back(i);
+    }
+
+    ASSERT_EQ((dim_t)gold.size(), indices.elements());
+    vector<uint> h_idx(gold.size());
+    indices.host(&h_idx.front());
+    ASSERT_EQ(gold, h_idx);
+}